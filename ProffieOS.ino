@@ -126,14 +126,6 @@
 // did not work with that define.
 
 
-#ifdef PROFFIEBOARD
-  #include "common/crc.h"
-#endif
-
-#ifdef ARDUINO_ARCH_ESP32   // ESP architecture
-  #include "common/espSTCRC.h"
-#endif
-
 #include <Arduino.h>
 
 #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
@@ -184,6 +176,7 @@ const char install_time[] = __DATE__ " " __TIME__;
 #include "common/state_machine.h"
 #include "common/stdout.h"
 #include "common/errors.h"  // Include just the base class, unless PROFFIEOS_DEFINE_FUNCTION_STAGE is defined (see EOF)
+#include "common/crc32.h"
 
 
 
@@ -213,6 +206,7 @@ void PrintQuotedValue(const char *name, const char* str) {
 }
 
 #include "common/Probe.h"   // LoopCounter and ScopedCycleCounter redefined here
+#include "common/trace.h"
 CPUprobe audio_dma_interrupt_cycles;
 CPUprobe pixel_dma_interrupt_cycles;
 CPUprobe motion_interrupt_cycles;
@@ -236,9 +230,18 @@ CPUprobe wav_interrupt_cycles;
 #define PROFFIEOS_STARTUP_DELAY CONFIG_STARTUP_DELAY
 #endif
 
+// Staged boot: only the current preset is checked in setup(), the others from the loop
+#ifdef NO_FAST_BOOT
+#define BOOT_DEFER_PRESET_CHECKS false
+#else
+#define BOOT_DEFER_PRESET_CHECKS true
+#endif
+
 #include "common/linked_list.h"
 #include "common/looper.h"
 #include "common/command_parser.h"
+#include "common/telemetry.h"
+#include "common/boot_profile.h"
 
 
 CommandParser* parsers = NULL;
@@ -300,6 +303,8 @@ void EnableAmplifier();
   bool AmplifierIsActive();   // need this because there's no power manager (yet) for ProffieBoard
 #endif
 void MountSDCard();
+bool MountSDCardSync();
+bool SDCardMountPending();
 const char* GetSaveDir();
 
 #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
@@ -314,6 +319,25 @@ void SilentEnableAmplifier(bool on);
 // Double-zero terminated array of search paths.
 // No trailing slashes!
 char current_directory[128];
+
+// "font;common" -> search path list in 'dest' (sizeof(current_directory))
+void split_directories(char* dest, const char* dir) {
+  char *b = dest;
+  for (const char *a = dir; *a; a++) {
+    // Skip trailing slash
+    if (*a == '/' && (a[1] == 0 || a[1] == ';'))
+      continue;
+    if (*a == ';') {
+      *(b++) = 0;
+      continue;
+    }
+    *(b++) = *a;
+  }
+  // Two zeroes at end!
+  *(b++) = 0;
+  *(b++) = 0;
+}
+
 const char* next_current_directory(const char* dir) {
   dir += strlen(dir);
   dir ++;
@@ -344,6 +368,7 @@ uint16_t xChargerGetLimit();
 #endif
 
 #include "sound/sound.h"
+#include "common/flash_cache.h"
 
 
 #include "common/battery_monitor.h"
@@ -924,6 +949,33 @@ class Commands : public CommandParser {
       }
 
 
+      // Binary dump of all probe histograms, for host-side percentiles:
+      // "PRB1" | u8 buckets | u8 duration min log2 | u8 period min log2 | u32 cpu MHz | u32 millis | records (see CPUprobe::Dump) | u8 0
+      if (!strcmp(cmd, "probes")) {
+        uint8_t hdr[3] = { PROBE_HIST_BUCKETS, 6, 2 };
+        uint32_t mhz = _SYSTEM_CORE_CLOCK_MHZ_, now = millis();
+        STDOUT.write((const uint8_t*)"PRB1", 4);
+        STDOUT.write(hdr, 3);
+        STDOUT.write((const uint8_t*)&mhz, 4);
+        STDOUT.write((const uint8_t*)&now, 4);
+        audio_dma_interrupt_cycles.Dump("Audio DMA ISR");
+        wav_interrupt_cycles.Dump("WAV Reader ISR");
+        pixel_dma_interrupt_cycles.Dump("Pixel ISR");
+        motion_interrupt_cycles.Dump("Motion ISR");
+        Looper::DoProbe(DoWhatToProbe::dump_probe);
+        STDOUT.write((uint8_t)0);
+        if (arg && !strcmp(arg, "reset")) {
+          noInterrupts();
+          Looper::DoProbe(DoWhatToProbe::reset_window);
+          audio_dma_interrupt_cycles.ResetWindow();
+          wav_interrupt_cycles.ResetWindow();
+          pixel_dma_interrupt_cycles.ResetWindow();
+          motion_interrupt_cycles.ResetWindow();
+          interrupts();
+        }
+        return true;
+      }
+
       if (!strcmp(cmd, "top")) {
         // 1. Enable cycle counter if it's not
         if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
@@ -1011,6 +1063,23 @@ class Commands : public CommandParser {
 
   #endif // X_PROBECPU
 
+  #ifndef DISABLE_DIAGNOSTIC_COMMANDS
+  if (!strcmp(cmd, "trace")) {    // event trace, see common/trace.h
+    if (arg && !strncmp(arg, "on", 2)) {
+      uint8_t mask = strtol(arg + 2, nullptr, 0);
+      EventTrace::Start(mask ? mask : trc_default);
+    } else if (arg && !strcmp(arg, "off")) {
+      EventTrace::Stop();
+    } else if (arg && !strcmp(arg, "dump")) {
+      EventTrace::Dump(STDOUT);
+      Looper::DumpNames(STDOUT);
+    } else {
+      STDOUT.print("trace mask: "); STDOUT.println(EventTrace::mask);
+    }
+    return true;
+  }
+  #endif
+
   if (!strcmp(cmd, "alive")) {
     STDOUT.println("alive-START");
     if (prop.IsOn()) STDOUT.println("propstate: on");
@@ -1020,12 +1089,6 @@ class Commands : public CommandParser {
     return true;
   }
 
-  #ifdef X_BROADCAST // Enable binary streaming
-    if (!strcmp(cmd, "broadcast")) {
-        STDOUT.StartBroadcast();    // reset board to turn off, unless it gets stopped in code
-    return true;
-    }
-  #endif // X_BROADCAST
 
 
 
@@ -1340,11 +1403,10 @@ class Commands : public CommandParser {
   #endif
   #ifdef X_PROBECPU
     STDOUT.println(" top - report CPU usage and execution times");
-  #endif
-  #ifdef X_BROADCAST
-    STDOUT.println(" broadcast on/off - enable/disable binary broadcasting");
+    STDOUT.println(" probes [reset] - binary dump of probe histograms");
   #endif
   #ifndef DISABLE_DIAGNOSTIC_COMMANDS
+    STDOUT.println(" trace on [mask] / off / dump - event trace");
     STDOUT.println(" cod <filename> - list all entries in a .COD file");
   #endif
 #else // COMMANDS_HELP
@@ -1495,6 +1557,7 @@ bool BootInSafeMode()
 #endif
 
 void setup() {
+  BootProfile::Begin();
 #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
 #define SAVE_RCC(X) startup_##X = RCC->X
   SAVE_RCC(AHB1ENR);
@@ -1563,6 +1626,8 @@ if (Serial) {
   }
 
 
+  BOOT_MARK(boot_serial);
+
   // Wait for all voltages to settle.
   // Accumulate some entrypy while we wait.
   uint32_t now = millis();
@@ -1574,6 +1639,7 @@ if (Serial) {
 
 
   }
+  BOOT_MARK(boot_settle);
 
   // 1. Init memory
 #ifdef ENABLE_SERIALFLASH
@@ -1617,9 +1683,8 @@ if (Serial) {
   }
 #endif // ENABLE_SD
 
-#ifdef PROFFIEBOARD
-  ProffieBoard_InitCRC();   // Ugly patch, we need to get all board packages under the same JSON to get rid of this...
-#endif
+  CRC32::Begin();
+  BOOT_MARK(boot_storage);
 
   // 2. Install configuration
   #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
@@ -1639,17 +1704,19 @@ if (Serial) {
       else STDOUT.println("FAILED!");
     #endif
   }
+  BOOT_MARK(boot_install);
 
 
   // 3. User Profile
   if(!skip) {
     #ifdef DIAGNOSE_BOOT
-        SetUserProfile(PROFILE_FILE);
+        SetUserProfile(PROFILE_FILE, BOOT_DEFER_PRESET_CHECKS);
     #else // DIAGNOSE_BOOT
       STDOUT.print("Running xProfile ... ");
-      if (SetUserProfile(PROFILE_FILE)) STDOUT.println("Success.");
+      if (SetUserProfile(PROFILE_FILE, BOOT_DEFER_PRESET_CHECKS)) STDOUT.println("Success.");
       else STDOUT.println("FAILED!");
     #endif // DIAGNOSE_BOOT
+    BOOT_MARK(boot_profile);
 
     // 4. Publish content
     #if defined(ULTRAPROFFIE) && ULTRAPROFFIE_VERSION == 'L'  
@@ -1663,16 +1730,19 @@ if (Serial) {
         else STDOUT.println("FAILED!");
       #endif
     #endif // ULTRAPROFFIE_VERSION
+    BOOT_MARK(boot_publish);
 
     STDOUT.println("");
     prop.ActivateBlades();
     prop.SetPreset(userProfile.preset, false);
+    BOOT_MARK(boot_blades);
   }     
     
       
 
   // 5. Setup
   Looper::DoSetup();    
+  BOOT_MARK(boot_setup);
 
 
   // 6. Signal boot
@@ -1680,7 +1750,7 @@ if (Serial) {
 #if defined(ENABLE_SD) && defined(ENABLE_AUDIO)
   if (!sd_card_found) ProffieOSErrors::sd_card_not_found();
 #endif // ENABLE_AUDIO && ENABLE_SD
-  
+  BOOT_MARK(boot_ready);
 }
 
 
@@ -1688,6 +1758,9 @@ if (Serial) {
 
 void loop() {
   Looper::DoLoop();
+#ifdef ULTRAPROFFIE
+  powerman.Idle();    // sleep while only the CPU is powered and loopers have nothing to do
+#endif
 }
 
 #ifdef ARDUINO_ARCH_ESP32   // ESP architecture
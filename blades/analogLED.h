@@ -22,6 +22,9 @@
 
 #define ALED_MAXCH      4   // Maximum number of channels an analog LED suppports
 #define ALED_MAXEM      3   // Maximum number of emitters an analog LED channel supports
+#ifndef ALED_TF_TABLE_BYTES
+#define ALED_TF_TABLE_BYTES 512 // Largest dense table (bytes) an enhancer's transfer function may be resampled to
+#endif
 
 
 
@@ -42,6 +45,9 @@ using namespace std;
 #define pPWL_NVP_MAX    7   // Maximum number of voltage points (normally there are 7: 3.0, 3.2, 3.4, 3.6, 3.8, 4.0 and 4.2)
 #define pPWL_VBAT_MIN   3   // Minimum battery voltage used for optical calibration. Don't change this unless you're me...
 #define pPWL_VBAT_MAX  4.2  // Maximum battery voltage used for optical calibration. Don't change this unless you're me...
+#ifndef ALED_VBAT_HYSTERESIS
+#define ALED_VBAT_HYSTERESIS 0.01   // Battery voltage change [V] that triggers recalculation of the drivers' compensation
+#endif
 
 
 // -----------------------------------------------------------
@@ -57,21 +63,23 @@ protected:
 public:
     virtual bool Init(void* data) { return false; } // initialize from internal memory
     virtual bool Init(const char* filename, uint16_t ID) { return false; } // initialize from external memory
-    virtual uint16_t Get_regVal(uint16_t bright) = 0; // Calculates the register value (0-32767) based on desired brightness (0-65535) and battery voltage
+    virtual void SetVoltage(uint16_t iVoltage, float volts) { }   // Recalculates battery compensation. iVoltage = multiple of battery monitor's LSB, volts = same in [V]
+    virtual uint16_t Get_regVal(uint16_t bright) = 0; // Calculates the register value (0-32767) based on desired brightness (0-65535) and last voltage set
 };
 
 
 // Direct drive: use only if the LED can withstand the full battery voltage or an external PWM-driven current regulator is used
 class AnalogLED_Driver_Direct : public AnalogLED_DriverInterface {
 private:
-    float scale;            // register value = scale * brightness
+    uint32_t scale;         // register value = scale * brightness / 65536
 public:
     // Init driver. Data = scale (float*)
     bool Init(void* data) override { 
-        if (data)
-            scale = *((float*)data);
-        else
-            scale = 0.5;      // default scale if no data provided
+        float fScale = 0.5;   // default scale if no data provided
+        if (data) fScale = *((float*)data);
+        if (fScale <= 0) return false;
+        if (fScale > 32767) fScale = 32767;
+        scale = fScale * 65536;
         if (!scale) return false;
         brightness = 0;      
         // STDOUT.print("[AnalogLED_Driver_Direct.Init] Initialized direct driver with scale "); STDOUT.println(scale); 
@@ -80,7 +88,7 @@ public:
 
     // Calculate register value
     uint16_t Get_regVal(uint16_t bright) override {
-        float retval = scale * (float)bright;
+        uint64_t retval = ((uint64_t)scale * bright) >> 16;
         if (retval>32767) retval=32767;
         brightness = bright;    // store latest brightness
         #ifdef X_LIGHTTEST 
@@ -123,6 +131,7 @@ void GetLegacyLEDSpecs(LegacyLED* dest) {
 class AnalogLED_Driver_Legacy : public AnalogLED_DriverInterface {
 private:
     LegacyLED ledSpecs;        // Legacy LED specifications
+    uint32_t multiplier;       // a / (batVolt + b) for the last voltage set, scaled with 65536
 public:
     // Initialization from internal memory:
     /* To initialize from a LED structure as defined in leds.h, use the following template:
@@ -134,6 +143,7 @@ public:
         ledSpecs = *((LegacyLED*)data);
         if (!ledSpecs.a && !ledSpecs.b) return false;           // LegacyLED not initialized
         // STDOUT.print("Initialized Legacy LED driver with a="); STDOUT.print(ledSpecs.a); STDOUT.print(" and b="); STDOUT.println(ledSpecs.b);
+        SetVoltage(0, 3.7);     // until the LED gets the actual voltage
         brightness = 0;      
         return true;
      } 
@@ -172,14 +182,22 @@ public:
 
         // STDOUT.print("[AnalogLED_Driver_Legacy::Init] initialized a "); STDOUT.print(ledSpecs.Red); STDOUT.print("-"); STDOUT.print(ledSpecs.Green); STDOUT.print("-"); STDOUT.print(ledSpecs.Blue);
         // STDOUT.print(" LED with a ="); STDOUT.print(ledSpecs.a); STDOUT.print(" and b = "); STDOUT.println(ledSpecs.b);
+        SetVoltage(0, 3.7);     // until the LED gets the actual voltage
         brightness = 0;      
         return true;
     }
 
+    // The only float division left, once per voltage change
+    void SetVoltage(uint16_t iVoltage, float volts) override {
+        float tmp = volts + ledSpecs.b;
+        if (tmp <= 0) { multiplier = 0xFFFFFFFF; return; }    // voltage below LED's model: full output
+        tmp = ledSpecs.a / tmp;
+        if (tmp >= 65535) multiplier = 0xFFFFFFFF;
+        else multiplier = tmp * 65536;
+    }
+
     uint16_t Get_regVal(uint16_t bright) override {
-        float batVolt = battery_monitor.battery();
-        float tmp = ledSpecs.a / (batVolt + ledSpecs.b);     // multiplier
-        tmp *= bright;                                      // register value
+        uint64_t tmp = ((uint64_t)multiplier * bright) >> 16;   // register value
         if (tmp>32767) tmp=32767;
         brightness = bright;    // store latest brightness
         #ifdef X_LIGHTTEST
@@ -272,11 +290,14 @@ public:
         return true;
     }
 
+    // Recalculate references for a new voltage
+    void SetVoltage(uint16_t iVoltage, float volts) override {
+        if (iVoltage != refVoltage) UpdateReferences(iVoltage);
+    }
+
     // Calculate register value = f(brightness)
     // uint16_t Get_regVal(uint16_t bright, float batVolt) override {
     uint16_t Get_regVal(uint16_t bright) override {
-        uint16_t iVoltage = battery_monitor.iBattery();
-        if (iVoltage != refVoltage) UpdateReferences(iVoltage);         // Recalculate references only if voltage changed with at least battery monitor's LSB
         uint16_t retval = lutCtrl.Get(bright);
         if (retval>32767) retval=32767;                     // clamp to range
         brightness = bright;    // store latest brightness
@@ -376,6 +397,7 @@ private:
     uint16_t tR, tG, tB;    // target R, G, B to enhance (only used by H enhacer)
     TF<uint8_t, uint16_t>* enhancer;    // pointer to enhancer's tranfer function (specialization that gets 256*output)
     vector<uint8_t> enhRef;             // reference points for enhancer's transfer function
+    vector<uint16_t> enhTable;          // enhancer's transfer function resampled on every input, if small enough
     #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
     inline static uint16_t Cmin, Cmax;    // min and max of last {R, G, B}, for S and L calculations. Those are static so can reuse Cmin and Cmax across successive renderers
     inline static uint32_t last_ctrlVal;  // ... to know when to recalculate Cmin and Cmax
@@ -397,6 +419,7 @@ public:
         scale = IntegerScaleFromFloatGain((float*)data, channelBrightness);      // first 4 bytes
         if (enhancer) delete enhancer;    // delete transfer function, if exists
         enhRef.resize(0);                 // no need to keep transfer function references for proportional engancer 
+        enhTable.resize(0);
         enhancer = 0;
         if (type=='h') {
             tR = *(((char*)data)+5); 
@@ -431,6 +454,7 @@ public:
         // brightness.resize(0);   // assume failure
         if (enhancer) delete enhancer;    // delete transfer function, if already exists
         enhancer = 0;
+        enhTable.resize(0);
         if (!reader.Open(filename)) return false;          // file not found
         numBytes = reader.ReadEntry(ID, (void*)&codData, sizeof(codData));      // Attempt to read a structure with the requested ID. We can safely do this without checking the properties first,
         reader.Close();                                                         // because even if the reader puts rubbish at destination, it won't exceed the specified size.
@@ -465,6 +489,11 @@ public:
                 return false;   
             }
             enhancer->Start();
+            uint32_t tableBytes = enhancer->TableBytes();
+            if (tableBytes && tableBytes <= ALED_TF_TABLE_BYTES) {    // resample, so Get() is a single load
+                enhTable.resize(tableBytes / sizeof(uint16_t));
+                enhancer->Tabulate(enhTable.data(), tableBytes);
+            }
         }
         // nEm = 1; 
         last_ctrlVal = 0;
@@ -556,7 +585,7 @@ uint16_t ColorRenderer_HSLe::Cmin = 0;
 class ColorRenderer_CRM : public ColorRenderer_Interface {
 private:
     uint8_t nOuts;                                  // number of outpus (comes from CRM size)
-    vector<float> crm;                              // Color Rendering Matrix (vector of 3-column rows)
+    int32_t crm[3*ALED_MAXEM];                      // Color Rendering Matrix (3-column rows), scaled with 256
     TF<uint16_t, uint16_t>* gammaTF[ALED_MAXEM];      // pointers to tranfer functions for gamma correction for each output 
     vector<uint8_t> gammaRef;                       // reference points for gamma transfer function
 public:
@@ -577,13 +606,17 @@ public:
         if (reader.codProperties.table.Rows < 1 || reader.codProperties.table.Rows > ALED_MAXEM || reader.codProperties.table.Columns != 3)  { 
             reader.Close(); return false; } // Must have 3 columns (RGB input) and nEm=[1, ALED_MAXEM] rows (output channels).
         nOuts = reader.codProperties.table.Rows;    // number of renderer outputs comes from CRM size
-        crm.resize(3*nOuts);        // row-by-row, 3 elements/row         
-        nrOfBytes = reader.ReadEntry(ID, (void*)crm.data(), 12*nOuts);   // Read table and copy data to crm
+        float fCrm[3*ALED_MAXEM];                   // row-by-row, 3 elements/row         
+        nrOfBytes = reader.ReadEntry(ID, (void*)fCrm, 12*nOuts);   // Read table and copy data to fCrm
         reader.Close();  
-        if (!nrOfBytes) return false;        // could not read or fit data...   
-        // Scale CRM with channel brightness
-        for (uint8_t i=0; i<nOuts; i++) 
-            crm[i] *= channelBrightness;    
+        if (!nrOfBytes) { nOuts = 0; return false; }        // could not read or fit data...   
+        // Scale CRM with channel brightness and convert to fixed point, once
+        for (uint8_t i=0; i<3*nOuts; i++) {
+            float c = fCrm[i] * channelBrightness * 256;
+            if (c > 2000000) c = 2000000;           // |crm| * 3 * 255 must fit int32
+            if (c < -2000000) c = -2000000;
+            crm[i] = c < 0 ? c - 0.5f : c + 0.5f;
+        }
         // Set initial state
         ctrlVal = 0;
         for (uint8_t i=0; i<ALED_MAXEM; i++) {
@@ -657,11 +690,16 @@ public:
     */
     bool UpdateBrightness(uint32_t ctrlval)  { // __attribute__((optimize("Og"))) {
         if (!nOuts) return false;   // renderer not initialized
-        float R = (float)HEXRGB_GET8b(ctrlVal, 0);
-        float G = (float)HEXRGB_GET8b(ctrlVal, 1);
-        float B = (float)HEXRGB_GET8b(ctrlVal, 2); 
-        for (uint8_t ch=0; ch<nOuts; ch++) {
-            brightness[ch] = (uint16_t) (crm[ch]*R + crm[ch+1]*G + crm[ch+2]*B);
+        ctrlVal = ctrlval;
+        int32_t R = HEXRGB_GET8b(ctrlVal, 0);
+        int32_t G = HEXRGB_GET8b(ctrlVal, 1);
+        int32_t B = HEXRGB_GET8b(ctrlVal, 2); 
+        const int32_t* row = crm;
+        for (uint8_t ch=0; ch<nOuts; ch++, row+=3) {
+            int32_t bright = (row[0]*R + row[1]*G + row[2]*B) >> 8;
+            if (bright < 0) bright = 0;
+            if (bright > 65535) bright = 65535;
+            brightness[ch] = bright;
             if (gammaTF[ch])    // Apply gamma correction on each emitter, if transfer function assigned
                 brightness[ch] = gammaTF[ch]->Get(brightness[ch]);
         }
@@ -691,6 +729,7 @@ public: xAnalogLED_Channel() {  //
         nEm = 0;
         renderer = 0;
         active = false;
+        written = false;
         for (uint8_t i=0; i<ALED_MAXEM; i++) {
             pins[i] = NO_PIN;
             drivers[i] = 0;
@@ -715,6 +754,8 @@ private:
     AnalogLED_DriverInterface* drivers[ALED_MAXEM];     // Drivers
     ColorRenderer_Interface* renderer;         // Color renderer
     bool active;                                //
+    bool written;                               // pins hold the output for lastRGB
+    uint32_t lastRGB;                           // last color set
 
     // Get the index of the first emitter with unassigned driver. Returns [0,3] or -1 if all emitters have drivers
     int8_t nextEmitter() {
@@ -1021,6 +1062,7 @@ public:
             LSanalogWrite(pins[i], 0);  // make it black
         }
         // STDOUT.println("Activating LED channel");
+        written = false;
         active = true;
     }
 
@@ -1032,18 +1074,28 @@ public:
             LSanalogWriteTeardown(pins[i]);
         }
         // STDOUT.println("Deactivating LED channel");
+        written = false;
         active = false;
 
     }
 
+    // Pass a new battery voltage to all drivers
+    void SetVoltage(uint16_t iVoltage, float volts) {
+        for (uint8_t i=0; i<nEm; i++) 
+            drivers[i]->SetVoltage(iVoltage, volts);
+        written = false;    // register values must be recalculated
+    }
+
     // Set color
     void Set(uint32_t hexRGB) { // __attribute__((optimize("Og"))) {
         if (!renderer) return;          // LED channel not initialized
         if (!active) return;            // LED channel not activated
         // STDOUT.print("[AnalogLED_Channel.Set]: Set hexRGB = "); STDOUT.println(hexRGB);
 
-        // if (renderer->ctrlVal == hexRGB) return;        // Color already set
+        if (written && lastRGB == hexRGB) return;        // Color already set, at the same voltage
         if (!renderer->UpdateBrightness(hexRGB)) return;      // Renderer failure
+        lastRGB = hexRGB;
+        written = true;
         // STDOUT.print("[AnalogLED_Channel.Set]: Set hexRGB = "); STDOUT.print(hexRGB);
         // STDOUT.print(" on channel with "); STDOUT.print(nEm); STDOUT.print(" emitters, at pins: "); 
         // STDOUT.print(pins[0]); STDOUT.print(", "); STDOUT.print(pins[1]); STDOUT.print(", "); STDOUT.print(pins[2]); STDOUT.print(": "); 
@@ -1083,6 +1135,7 @@ public:
             token = strtok(NULL, ",");
             uint16_t bri= atoi(token);   // Extract brightness        
             // 3. Set and report   
+            SetVoltage(battery_monitor.iBattery(), battery_monitor.battery());     // at the current voltage
             uint16_t regVal = drivers[targetEm]->Get_regVal(bri);          // Get PWM register value (0-32767)
             Activate();         
             LSanalogWrite(pins[targetEm], regVal);
@@ -1111,12 +1164,18 @@ class xAnalogLED {
 private: 
     bool activated;     // we need to activate the LED on serial command, but only once
 #endif
+private:
+    int32_t vRef;       // battery voltage the drivers compensate for, as multiple of battery monitor's LSB. -1 = not set yet
+    int32_t vHyst;      // ALED_VBAT_HYSTERESIS, same unit
 public:
     uint8_t nCh;        // number of channels = 1 ... ALED_MAXCH
     xAnalogLED_Channel* channels[ALED_MAXCH];
 
     xAnalogLED() {
         nCh = 0; 
+        vRef = -1;
+        vHyst = ALED_VBAT_HYSTERESIS / battery_monitor.voltageLSB();
+        if (vHyst < 1) vHyst = 1;
         for (uint8_t i=0; i<ALED_MAXCH; i++) 
             channels[i] = 0;
         #ifdef X_LIGHTTEST
@@ -1144,9 +1203,17 @@ public:
             if (channels[i]) channels[i]->Deactivate();
     }
 
-    // Set color on all channels
+    // Set color on all channels. Battery is read once for all of them and compensation is recalculated 
+    // only when the voltage leaves the hysteresis band around the last one used.
     void Set(uint32_t hexRGB) {
         // STDOUT.print("Set AnalogLED to "); STDOUT.println(hexRGB);
+        int32_t iVoltage = battery_monitor.iBattery();
+        if (vRef < 0 || iVoltage >= vRef + vHyst || iVoltage <= vRef - vHyst) {
+            vRef = iVoltage;
+            float volts = battery_monitor.battery();
+            for (uint8_t i=0; i<ALED_MAXCH; i++) 
+                if (channels[i]) channels[i]->SetVoltage(iVoltage, volts);
+        }
         for (uint8_t i=0; i<ALED_MAXCH; i++) 
             if (channels[i]) channels[i]->Set(hexRGB);
     }
@@ -3,6 +3,58 @@
 
 #include "button_base.h"
 
+// Pin buttons are interrupt driven: the pin ISR timestamps every edge into
+// the DebouncedButton queue and Loop() only has work to do on transitions
+// or while a hold/double-click timeout is pending.
+// #define BUTTON_POLLING to read the pins from Loop() instead.
+#if defined(BUTTON_POLLING) || !(defined(ARDUINO_ARCH_STM32L4) || defined(ARDUINO_ARCH_ESP32))
+class InterruptButton : public ButtonBase {
+public:
+  InterruptButton(enum BUTTON button, int pin, const char* name) : ButtonBase(name, button), pin_(pin) {}
+protected:
+  uint8_t pin_;
+};
+#else
+#ifdef ULTRAPROFFIE
+// Deep sleep hands the power button EXTI line to the wake-up handler,
+// so the ISR is attached again whenever the CPU domain comes back on.
+class InterruptButton : public ButtonBase, public PowerSubscriber {
+public:
+  InterruptButton(enum BUTTON button, int pin, const char* name) : ButtonBase(name, button), PowerSubscriber(pwr4_CPU), pin_(pin) {}
+  const char* name() override { return ButtonBase::name(); }
+  void PwrOn_Callback() override { AttachEdgeInterrupt(); }
+#else
+class InterruptButton : public ButtonBase {
+public:
+  InterruptButton(enum BUTTON button, int pin, const char* name) : ButtonBase(name, button), pin_(pin) {}
+#endif
+  void Setup() override { AttachEdgeInterrupt(); }
+
+protected:
+  uint8_t pin_;
+
+  void AttachEdgeInterrupt() {
+    noInterrupts();
+#ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+    stm32l4_exti_notify(&stm32l4_exti, g_APinDescription[pin_].pin,
+                        EXTI_CONTROL_BOTH_EDGES, &EdgeISR, this);
+#else
+    attachInterruptArg(digitalPinToInterrupt(pin_), &EdgeISR, this, CHANGE);
+#endif
+    EnableEdgeInterrupts();
+    interrupts();
+  }
+
+#ifdef ARDUINO_ARCH_ESP32
+  IRAM_ATTR
+#endif
+  static void EdgeISR(void* context) {
+    InterruptButton* b = (InterruptButton*)context;
+    b->PushEdge(b->Read(), millis());
+  }
+};
+#endif // BUTTON_POLLING
+
 // For all setups following the wiring diagram (V2) described on https://fredrik.hubbe.net/lightsaber/v5/
 // 
 // momentary buttons are expected to be connected to gnd and 1 of the Proffieboard/Teensy input pins
@@ -11,17 +63,15 @@
 // Button PowerButton(BUTTON_POWER, powerButtonPin, "pow");  
 //
 
-class Button : public ButtonBase {
+class Button : public InterruptButton {
 public:
 
-  Button(enum BUTTON button, int pin, const char* name) : ButtonBase(name, button), pin_(pin) {
+  Button(enum BUTTON button, int pin, const char* name) : InterruptButton(button, pin, name) {
     pinMode(pin, INPUT_PULLUP);
 
   }
 
 protected:
-  uint8_t pin_;
-
   bool Read() override {
     return digitalRead(pin_) == LOW;
   }
@@ -37,15 +87,13 @@ protected:
 // PullDownButton PowerButton(BUTTON_POWER, powerButtonPin, "pow");  
 //
 
-class PullDownButton : public ButtonBase{
+class PullDownButton : public InterruptButton {
 public:
-  PullDownButton(enum BUTTON button, int pin, const char* name) : ButtonBase(name, button), pin_(pin) {
+  PullDownButton(enum BUTTON button, int pin, const char* name) : InterruptButton(button, pin, name) {
     pinMode(pin, INPUT_PULLDOWN);
 
   }
 protected:
-  uint8_t pin_;
-
   bool Read() override {
 	return digitalRead(pin_) == HIGH;
   }
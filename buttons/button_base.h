@@ -42,6 +42,15 @@ public:
 
   const char* name() override { return name_; }
 
+  // Run at once on a new edge, then idle until the next one or until a saved click is due
+  uint32_t IdleMicros() override {
+    if (EdgeQueued()) return 0;
+    if (!WaitingForEdge()) return Looper::IdleMicros();
+    if (!saved_event_) return LOOPER_IDLE_FOREVER;
+    uint32_t elapsed = millis() - push_millis_;
+    return elapsed > BUTTON_DOUBLE_CLICK_TIMEOUT ? 0 : (BUTTON_DOUBLE_CLICK_TIMEOUT + 1 - elapsed) * 1000;
+  }
+
 protected:
   // We send two events:
   // the event itself, and the event with a count, dependinging on how
@@ -55,6 +64,9 @@ protected:
     return true;
   }
 
+  // Timing below runs on edge timestamps (EdgeMillis) and on Now(), which
+  // never gets ahead of a queued edge, rather than on when Loop() runs.
+
   // We send the click immediately, but we also hold a "saved" event
   // which is sent a little bit later unless a double-click occurs.
   void SendClick(uint32_t event) {
@@ -69,29 +81,29 @@ protected:
     while (true) {
       while (!DebouncedRead()) {
 	if (saved_event_ &&
-	    millis() - push_millis_ > BUTTON_DOUBLE_CLICK_TIMEOUT) {
+	    Now() - push_millis_ > BUTTON_DOUBLE_CLICK_TIMEOUT) {
 	  Send(saved_event_);
 	  saved_event_ = 0;;
 	}
 	YIELD();
       }
       saved_event_ = 0;
-      if (millis() - push_millis_ < BUTTON_DOUBLE_CLICK_TIMEOUT) {
+      if (EdgeMillis() - push_millis_ < BUTTON_DOUBLE_CLICK_TIMEOUT) {
 	if (press_count_ < 4) press_count_++;
       } else {
 	press_count_ = 1;
       }
       Send(EVENT_PRESSED);
-      push_millis_ = millis();
+      push_millis_ = EdgeMillis();
       current_modifiers |= button_;
       while (DebouncedRead() && (current_modifiers & button_)) {
-        if (millis() - push_millis_ > BUTTON_HELD_TIMEOUT) {
+        if (Now() - push_millis_ > BUTTON_HELD_TIMEOUT) {
           Send(EVENT_HELD);
           while (DebouncedRead() && (current_modifiers & button_)) {
-            if (millis() - push_millis_ > BUTTON_HELD_MEDIUM_TIMEOUT){
+            if (Now() - push_millis_ > BUTTON_HELD_MEDIUM_TIMEOUT){
               Send(EVENT_HELD_MEDIUM);
 	      while (DebouncedRead() && (current_modifiers & button_)) {
-                if (millis() - push_millis_ > BUTTON_HELD_LONG_TIMEOUT) {
+                if (Now() - push_millis_ > BUTTON_HELD_LONG_TIMEOUT) {
                   Send(EVENT_HELD_LONG);
 		  while (DebouncedRead() && (current_modifiers & button_)) YIELD();
                 }
@@ -107,21 +119,22 @@ protected:
       Send(EVENT_RELEASED);
       if (current_modifiers & button_) {
         current_modifiers &=~ button_;
-        if (millis() - push_millis_ < BUTTON_SHORT_CLICK_TIMEOUT) {
+        uint32_t duration = EdgeMillis() - push_millis_;
+        if (duration < BUTTON_SHORT_CLICK_TIMEOUT) {
           SendClick(EVENT_CLICK_SHORT);
         }
         #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
-        else if(millis() - push_millis_ < 1500) {
+        else if(duration < 1500) {
           SendClick(EVENT_CLICK_MEDIUM);
         }
         #endif 
-        else if (millis() - push_millis_ < 2500) {
+        else if (duration < 2500) {
 	  // Long clicks cannot be "saved", so just emit immediately.
           Send(EVENT_CLICK_LONG);
         }
       } else {
         // someone ate our clicks
-        push_millis_ = millis() - 10000; // disable double click
+        push_millis_ = EdgeMillis() - 10000; // disable double click
       }
     }
     STATE_MACHINE_END();
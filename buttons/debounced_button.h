@@ -4,38 +4,113 @@
 // Abstract class which de-bounces a potentially noisy
 // Read() function by waiting a certain number of ms
 // before letting it switch again.
+//
+// Raw edges go through a small queue, each with the millis() it happened at.
+// By default Update() polls Read() and queues the changes it sees; an
+// interrupt backend calls PushEdge() from the pin ISR instead (see
+// EnableEdgeInterrupts()), so timing no longer depends on how often
+// the loop gets to run.
+
+#ifndef BUTTON_EDGE_QUEUE
+#define BUTTON_EDGE_QUEUE 16    // must be a power of 2
+#endif
 
 class DebouncedButton {
 public:
+  // Consume queued edges up to the next debounced transition.
   void Update() {
-    STATE_MACHINE_BEGIN();
+    if (!irq_) {
+      bool r = Read();
+      if (r != raw_) PushEdge(r, millis());
+    }
     while (true) {
-      pushed_ = false;
-      last_off_ = millis();
-      YIELD();
-      if (!Read()) continue;
-      YIELD();
-      while (Read()) {
-	pushed_ = millis() - last_off_ > timeout();
-	YIELD();
+      if (raw_ && !pushed_ && Now() - raw_since_ > timeout()) {
+        pushed_ = true;
+        edge_millis_ = raw_since_;
+        return;
+      }
+      uint8_t tail = tail_;
+      if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE)) return;
+      Edge e = edges_[tail & (BUTTON_EDGE_QUEUE - 1)];
+      __atomic_store_n(&tail_, (uint8_t)(tail + 1), __ATOMIC_RELEASE);
+      if (e.pressed == raw_) continue;
+      raw_ = e.pressed;
+      raw_since_ = e.millis;
+      if (!raw_ && pushed_) {
+        pushed_ = false;
+        edge_millis_ = e.millis;
+        return;
       }
     }
-    STATE_MACHINE_END();
   }
   bool DebouncedRead() {
     Update();
     return pushed_;
   }
+  // Time of the last debounced transition (press: when the contact closed).
+  uint32_t EdgeMillis() { return edge_millis_; }
+  // Time base for the button logic: the time of the next queued edge if
+  // there is one, otherwise now. Timeouts are measured against the edges,
+  // so a late loop can't turn a click into a hold.
+  uint32_t Now() {
+    uint8_t tail = tail_;
+    if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE)) return millis();
+    return edges_[tail & (BUTTON_EDGE_QUEUE - 1)].millis;
+  }
+
+  // An edge came in and Update() hasn't consumed it yet.
+  bool EdgeQueued() {
+    return tail_ != __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  }
+
+  // Interrupt fed, released and nothing queued: no work until the next edge.
+  bool WaitingForEdge() {
+    return irq_ && !raw_ && !pushed_ && tail_ == __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  }
 
 protected:
   // virtual uint32_t timeout() { return 10; }
   virtual uint32_t timeout() { return 20; }
   virtual bool Read() = 0;
 
+  // Producer side: the polling Update() or the pin ISR, never both.
+  // When the queue is full the newest edge is overwritten, which only
+  // merges contact bounces.
+  void PushEdge(bool pressed, uint32_t t) {
+    uint8_t head = head_;
+    bool full = (uint8_t)(head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE)) >= BUTTON_EDGE_QUEUE;
+    Edge& e = edges_[(full ? head - 1 : head) & (BUTTON_EDGE_QUEUE - 1)];
+    e.millis = t;
+    e.pressed = pressed;
+    if (!full) __atomic_store_n(&head_, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+  }
+
+  // Switch to interrupt-fed edges. Call with interrupts disabled, right
+  // after (re)attaching the ISR: drops the queue and restarts from the
+  // current pin level.
+  void EnableEdgeInterrupts() {
+    tail_ = head_;
+    bool r = Read();
+    if (r != raw_) {
+      raw_ = r;
+      raw_since_ = millis();
+    }
+    irq_ = true;
+  }
+
 private:
-  uint32_t last_off_;
+  struct Edge {
+    uint32_t millis;
+    bool pressed;
+  };
+  Edge edges_[BUTTON_EDGE_QUEUE];
+  volatile uint8_t head_ = 0;
+  volatile uint8_t tail_ = 0;
+  bool irq_ = false;
+  bool raw_ = false;            // level after the last consumed edge
+  uint32_t raw_since_ = 0;      // ... and when it got there
+  uint32_t edge_millis_ = 0;
   bool pushed_ = false;
-  StateMachineState state_machine_;
 };
 
 #endif
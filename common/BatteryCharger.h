@@ -50,6 +50,11 @@
     *   @param  : 
     *   @retval : 
     */
+    uint32_t IdleMicros() override {
+        uint32_t elapsed = millis() - last_millis_;
+        return elapsed >= 5 ? 0 : (5 - elapsed) * 1000;
+    }
+
     void Loop() override {
         uint32_t now_millis = millis();
         if (now_millis - last_millis_ < 5) return;
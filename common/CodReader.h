@@ -12,6 +12,7 @@
  ********************************************************************/
 #include "lsfs.h"
 #include "codids.h"
+#include "crc32.h"
 
 #define COD_HEADER_LEN       8       // header len 
 #define COD_ENTYPE_TABLE     1       // table entry type 
@@ -206,17 +207,9 @@ public:
         toRead = bytesAvalable - 4;
         if(!toRead) return 0;
 
-        for(uint32_t indx = 0 ; indx < toRead; indx += 4)
-        {
-            pFile->read((uint8_t*)&localStorVar[0], 4);
-            #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-            	 // TODO ADD CRC FOR CODReDER FOR ESP
-            if(indx == 0)
-                crcCalculated = HAL_CRC_Calculate(&stm32l4_crc, (uint32_t*)&localStorVar[0], 4); // reset crc and calculate      4 
-            else
-                crcCalculated = HAL_CRC_Accumulate(&stm32l4_crc, (uint32_t*)&localStorVar[0], 4); // accumulate       4 
-            #endif
-        }
+        CRC32 crc;
+        crc.UpdateFromFile(pFile, toRead);
+        crcCalculated = crc.Value();
         if(crcRead) {
             pFile->read((uint8_t*)&localStorVar[0], 4);
             *crcRead = (localStorVar[3] << 24) | (localStorVar[2] << 16) | (localStorVar[1] << 8) | localStorVar[0];
@@ -716,17 +709,9 @@ class CodInterpreter_V3 : public CodInterpreter_V2 {
         if(!bytesAvalable || (bytesAvalable < size))        // make after position we have the available bytes 
             return 0;
         // Calculate CRC32
-        for(uint32_t indx = 0 ; indx < size; indx += 4)
-        {
-            pFile->read((uint8_t*)&localStorVar[0], 4);
-            #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-            // TODO add crc for ESP
-            if(indx == 0)
-                crcCalculated = HAL_CRC_Calculate(&stm32l4_crc, (uint32_t*)&localStorVar[0], 4); // reset crc and calculate      4 
-            else
-                crcCalculated = HAL_CRC_Accumulate(&stm32l4_crc, (uint32_t*)&localStorVar[0], 4); // accumulate       4 
-            #endif
-        }
+        CRC32 crc;
+        crc.UpdateFromFile(pFile, size);
+        crcCalculated = crc.Value();
         pFile->seek(curPos);       // reset file position at find position  
         // result = this->ReadHeader(); TODO check out this
 
@@ -748,6 +733,7 @@ private:
 
     char headerName[COD_HEADER_LEN];
     uint8_t openMode;
+    bool checkCRC;          // check the file CRC at Open()
 public:
     /* @brief   :   class constructor , initialize members to default values 
     *  @param   : void 
@@ -765,6 +751,7 @@ public:
         codProperties.table.DataType = 0;
         codProperties.table.Handler = 0;
         openMode = 0;
+        checkCRC = true;
     }
 
     /* @brief   : class destructor, dealloc created obj interpreter
@@ -783,10 +770,11 @@ public:
     *   @param  : filename - name of file want to open 
                   0 - read 
                   1 - read + overwrite 
+                  crc - false: skip the whole-file CRC check, for a caller that checked it already 
     *   @retval : true - all good 
     *             false - something went wrong 
     */
-    bool Open(const char* filename, uint8_t openFor = 0) // __attribute__((optimize("Og")))
+    bool Open(const char* filename, uint8_t openFor = 0, bool crc = true) // __attribute__((optimize("Og")))
     {
         // if (!strstr(filename, ".dat"))      // check if the extention of file is lut specific   
         //     return false;
@@ -805,6 +793,7 @@ public:
         if(!file)                    // check if 
             {LOCK_SD(true); return false;}   
         openMode = openFor;
+        checkCRC = crc;
         if(!this->ReadHeader()) 
             {LOCK_SD(true); return false;}   
 
@@ -917,6 +906,25 @@ public:
         return 0;    // failed
     }
 
+    /*  @brief  : Read data at a known file offset, e.g. codInterpreter->currentCodOffset saved after FindEntry().
+                  Skips the entry search, for entries that are read again later.
+    *   @param  : offset - file offset of the data
+                  dest - pointer to dest bfr
+                  bytes - number of bytes to read
+    *   @retval : number of bytes transferred to destination
+    */
+    uint32_t ReadAt(uint32_t offset, void* dest, uint32_t bytes)
+    {
+        uint32_t bytesRead = 0;
+        if(!file)
+            return 0;
+        LOCK_SD(true);
+        if(file.seek(offset))
+            bytesRead = file.read((uint8_t*)dest, bytes);
+        LOCK_SD(false);
+        return bytesRead;
+    }
+
     // Read an entry, check handler and size, then close file
     bool CheckAndReadEntryThenClose(uint16_t ID, uint16_t handler, void* dest, uint32_t destBytes) 
     {   uint32_t readResult = ReadEntry(ID, dest, destBytes);           // attempt to read
@@ -1031,6 +1039,7 @@ private:
         {   
             codInterpreter = new CodInterpreter_V2(&file, &codProperties, &entryType);
             if(!codInterpreter) return false;   // allocation failed
+            if(!checkCRC) return true;
             uint32_t readCRC, calcCRC;
             calcCRC = codInterpreter->GetFileCrC(&readCRC);
             if(calcCRC != readCRC)
@@ -1045,6 +1054,7 @@ private:
         {
             codInterpreter = new CodInterpreter_V3(&file, &codProperties, &entryType);
             if(!codInterpreter) return false;   // allocation failed
+            if(!checkCRC) return true;
             uint32_t readCRC, calcCRC;
             calcCRC = codInterpreter->GetFileCrC(&readCRC);
             if(calcCRC != readCRC)
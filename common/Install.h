@@ -436,6 +436,7 @@ struct {
         float maxVolume;        // Scale factory-default maximum audio volume between 0.5 and 1.5 
         float charge;           // Set battery charger current (0 = disable)
         uint16_t APOtime;       // Auto Power Off time [sec]
+        uint8_t audioLatency;   // 0 = normal, 1 = low latency. Optional: older install files end before it
     } __attribute__((packed)) installData;   // install configuration
 
 
@@ -481,9 +482,10 @@ bool Install(const char* filename)  {
 
     // 2. Read install data from file
     uint32_t numBytes;
+    installData.audioLatency = 0;
     numBytes = reader.ReadEntry(id, (void*)&installData, sizeof(installData));      // Attempt to read a structure with the requested ID. 
     reader.Close();     
-    if (numBytes != sizeof(installData)) {
+    if (numBytes != sizeof(installData) && numBytes != sizeof(installData) - sizeof(installData.audioLatency)) {
         #ifdef DIAGNOSE_BOOT
             STDOUT.print("FAILED TO INSTALL: failed to read install data from "); STDOUT.print(filename);
             STDOUT.print(", ID = "); STDOUT.println(id);
@@ -546,6 +548,11 @@ bool Install(const char* filename)  {
         #ifdef DIAGNOSE_BOOT
             STDOUT.print("* Setting auto power off time to "); STDOUT.print(installData.APOtime); STDOUT.println(" seconds.");
         #endif
+        installConfig.audioLatency = installData.audioLatency;
+        audio_latency.Set((AudioLatency)installConfig.audioLatency);
+        #ifdef DIAGNOSE_BOOT
+            if (installConfig.audioLatency) STDOUT.println("* Setting low latency audio.");
+        #endif
 
     // STDOUT.println("");
     #ifdef DIAGNOSE_BOOT
@@ -6,6 +6,11 @@
  *  Base class Interpolator provides a common interface for        *
  *  multiple interpolators:                                         *
  *  - LUT (look-up table): Linear, uni-dimensional, on constant grid
+ *  - TF (transfer function): Linear, uni-dimensional, on any grid.
+ *    Start() picks how segments are found: direct index for evenly
+ *    spaced X, binary search for longer irregular tables, linear
+ *    search for short ones. Tabulate() can add a dense table of all
+ *    integer inputs, when there's RAM for it.
  ********************************************************************/
 
 #ifndef XINTERPOLATOR_H
@@ -18,6 +23,10 @@
 #include <type_traits>
 
 
+#ifndef TF_LINEAR_SEARCH_MAX
+#define TF_LINEAR_SEARCH_MAX 6     // reference points up to which a linear search beats the binary one
+#endif
+
 enum InterpolatorState {
     interpolator_not_initialized=0,   
     interpolator_ready,
@@ -289,6 +298,7 @@ uint16_t LUT<uint16_t, uint16_t>::Get(uint16_t x) {
     if (state != interpolator_running) return 0;   // interpolator should be initialized and started before Get()
     if (x<xMin)  x=xMin; 
     uint16_t k = (x-xMin) / xStep;              // index of segment in refData
+    if (k > refSize-2) k = refSize-2;           // above xMax: extend last segment
     uint16_t xk = xMin + k*xStep;
     int32_t retval = x - xk;           // we'll calculate in int32 to avoid overflowing 
     // STDOUT.print("DeltaX = "); STDOUT.println(retval);
@@ -301,7 +311,7 @@ uint16_t LUT<uint16_t, uint16_t>::Get(uint16_t x) {
     retval += refData[k];
     uint16_t retval16;
     if (retval>65535) {   
-        retval = 65535;     // clamp to uint16
+        retval16 = 65535;     // clamp to uint16
         // STDOUT.print("[LUT<uint16, uint16>.Get] Overflow, retval is "); STDOUT.print(retval); STDOUT.println(", clamped to 65535 !!!"); 
     }
     else retval16 = (uint16_t)retval;
@@ -325,14 +335,62 @@ class TF  : public Interpolator<REFT, WORKT> {
 protected:
     uint16_t N;      // number of reference points = refSize / 2
 
-    // Find index of the leftmost reference X (=Xk), for a specified x. No protection at ends.
+    enum Lookup : uint8_t { tf_linear, tf_binary, tf_uniform };
+    Lookup lookup;      // how FindK() finds the segment, chosen by Start()
+    WORKT xStep;        // X spacing, for tf_uniform
+    WORKT* table = 0;   // Get() of every integer x from X[0] to X[N-1], set by Tabulate()
+    uint32_t tableSize = 0;
+
+    // Pick the fastest way to find segments for the current references
+    void SelectLookup() {
+        lookup = N > TF_LINEAR_SEARCH_MAX ? tf_binary : tf_linear;
+        WORKT step = (WORKT)refData[1] - (WORKT)refData[0];
+        if (!(step > 0)) return;
+        for (uint16_t i=1; i<N-1; i++) {
+            WORKT d = (WORKT)refData[i+1] - (WORKT)refData[i];
+            if (std::is_floating_point<WORKT>::value) { if (d - step > step / 10000 || step - d > step / 10000) return; }
+            else if (d != step) return;
+        }
+        xStep = step;
+        lookup = tf_uniform;
+    }
+
+    // Find index of the segment for a specified x: x[k] < x <= x[k+1]. 
+    // Outside the reference range, the first / last segment is extended.
     uint16_t FindK(WORKT x) {
-        uint16_t k = 1;
-        while(k <= N-1) {
-            if (x <= (WORKT)refData[k]) return k-1;
-            k++;
+        uint16_t k;
+        switch (lookup) {
+            case tf_uniform:
+                if (x <= (WORKT)refData[0]) return 0;
+                k = (x - (WORKT)refData[0]) / xStep;
+                if (k > N-2) k = N-2;
+                // X exactly on a reference belongs to the segment on its left, float spacing may be slightly off
+                while (k && x <= (WORKT)refData[k]) k--;
+                while (k < N-2 && x > (WORKT)refData[k+1]) k++;
+                return k;
+            case tf_binary: {
+                uint16_t lo = 1, hi = N-1;
+                while (lo < hi) {
+                    uint16_t mid = (lo + hi) / 2;
+                    if (x <= (WORKT)refData[mid]) hi = mid;
+                    else lo = mid + 1;
+                }
+                return lo-1;
+            }
+            default:
+                for (k = 1; k < N-1; k++)
+                    if (x <= (WORKT)refData[k]) break;
+                return k-1;
         }
-        return k-1;
+    }
+
+    // Tabulated value, if x is in the table
+    bool FromTable(WORKT x, WORKT* y) {
+        if (!table || x < (WORKT)refData[0]) return false;
+        uint32_t i = (uint32_t)(x - (WORKT)refData[0]);
+        if (i >= tableSize) return false;
+        *y = table[i];
+        return true;
     }
 
  public:   
@@ -368,16 +426,36 @@ protected:
     void  Start() override { 
         if (state != interpolator_ready) return;
         N = refSize / 2;
+        table = 0;
+        SelectLookup();
         state = interpolator_running;       
     }
 
+    // Bytes needed by Tabulate(), 0 if it doesn't apply (float input)
+    uint32_t TableBytes() {
+        if (std::is_floating_point<WORKT>::value || state != interpolator_running) return 0;
+        return ((uint32_t)((WORKT)refData[N-1] - (WORKT)refData[0]) + 1) * sizeof(WORKT);
+    }
 
+    // Resample to a dense table: one value for every integer input in the reference range,
+    // so Get() there is a single load. RAM is reserved externally, as for SpeedUp().
+    bool Tabulate(WORKT* ram, uint32_t ramSize) {
+        uint32_t bytes = TableBytes();
+        table = 0;                      // Get() below must interpolate
+        if (!bytes || !ram || ramSize < bytes) return false;
+        uint32_t n = bytes / sizeof(WORKT);
+        for (uint32_t i=0; i<n; i++)
+            ram[i] = Get((WORKT)((WORKT)refData[0] + i));
+        table = ram;
+        tableSize = n;
+        return true;
+    }
 
     // Run the interpolator on input x and return output
     WORKT Get(WORKT x = 0) override {   
         if (state != interpolator_running) return 0;   // interpolator should be initialized and started before Get()
-        // if (x<=xMin) return refData[0];                // outside range extend first / last value 
-        // if (x>=xMax) return refData[refSize-1];        
+        WORKT y;
+        if (FromTable(x, &y)) return y;
         uint16_t k = FindK(x);              // index of segment in refData
         WORKT slope;
         if (precalcData) {
@@ -418,6 +496,8 @@ bool TF<uint8_t, int16_t>::SpeedUp(int16_t* ram, uint32_t ramSize)  {
 template<>
 int16_t TF<uint8_t, int16_t>::Get(int16_t x) {
     if (state != interpolator_running) return 0;   // interpolator should be initialized and started before Get() 
+    int16_t y;
+    if (FromTable(x, &y)) return y;
     uint16_t k = FindK(x);              // index of segment in refData
     int16_t slope;
     if (precalcData) 
@@ -440,6 +520,8 @@ int16_t TF<uint8_t, int16_t>::Get(int16_t x) {
 template<>
 uint16_t TF<uint8_t, uint16_t>::Get(uint16_t x) {
     if (state != interpolator_running) return 0;   // interpolator should be initialized and started before Get() 
+    uint16_t y;
+    if (FromTable(x, &y)) return y;
     uint16_t k = FindK(x);              // index of segment in refData
     int32_t slope;
     slope = refData[N+k+1] - refData[N+k];  // y[k+1] - y[k]
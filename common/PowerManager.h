@@ -13,6 +13,11 @@
 #ifdef ULTRAPROFFIE_CHARGER
     #include "RTC.h"
 #endif
+#if defined(ARDUINO_ARCH_ESP32) && defined(PWRMAN_ESP_LIGHTSLEEP)
+    #include "esp_sleep.h"
+    #include "driver/gpio.h"
+    #include "driver/uart.h"
+#endif
 
     //#define DIAGNOSE_POWER_PORT
     // Timeouts
@@ -24,6 +29,26 @@
     #define PWRMAN_SDMOUNTTIMEOUT 5000      // SD mount timeout - allow longer for pre-loop initializations
     #define PWRMAN_STARTON  pwr4_CPU        // Binary map of PDType flags of domains that will turn ON at startup
 
+    // Idle
+    #ifndef PWRMAN_IDLE_MINSLEEP
+    #define PWRMAN_IDLE_MINSLEEP    200     // [us] don't bother sleeping for less
+    #endif
+    #ifndef PWRMAN_IDLE_MAXSLEEP
+    #define PWRMAN_IDLE_MAXSLEEP    100000  // [us] wake up at least this often, whatever loopers say
+    #endif
+    #define PWRMAN_LIGHTSLEEP_MIN   20000   // [us] ESP32 light sleep only pays off for longer waits
+
+    // Warm-up timeouts, in millis: how long anticipated domains stay on if the action doesn't come
+    #ifndef PWRMAN_INTENT_IGNITE
+    #define PWRMAN_INTENT_IGNITE    1500    // power button pressed while off
+    #endif
+    #ifndef PWRMAN_INTENT_MOTION
+    #define PWRMAN_INTENT_MOTION    1000    // first stroke of an ignition gesture
+    #endif
+    #ifndef PWRMAN_INTENT_MENU
+    #define PWRMAN_INTENT_MENU      3000    // menu entered
+    #endif
+
     // Stop entry type 
     #define PWR_STOPENTRY_WFI               ((uint8_t)0x01)       //Wait For Interruption instruction to enter Stop mode
     #define PWR_STOPENTRY_WFE               ((uint8_t)0x02)       //Wait For Event instruction to enter Stop mode
@@ -50,6 +75,14 @@
 #endif
     };
 
+    // Intent hints, see PowerManager::Anticipate()
+    enum PowerIntent {
+        intent_ignite = 0,  // power button pressed while off: blade, audio and SD
+        intent_motion,      // ignition gesture started: SD (slowest to get ready)
+        intent_menu,        // menu entered: audio prompts and SD
+        intent_numIntents
+    };
+
     class PowerDomain;        
     class PowerSubscriber;
 
@@ -78,6 +111,18 @@
         // Turn ON power domains 
         bool Activate(PDType_base startUpDomains = PWRMAN_STARTON);            // delayed implementation, see end of file.
 
+        // Warm up the domains the likely next action needs, to hide their wake-up latency.
+        // They power down again on their own if nobody requests them within the intent's timeout.
+        void Anticipate(PowerIntent intent);                                    // delayed implementation, see end of file.
+
+        // Sleep until the earliest looper deadline or an interrupt, if nothing but the CPU is powered.
+        // Call once per main loop pass.
+        void Idle();                                                            // delayed implementation, see end of file.
+        bool idleEnabled = true;
+        uint64_t idleMicros = 0;        // total time slept in Idle()
+        uint32_t idleCount = 0;         // number of sleeps
+        uint32_t idleStatsStart = 0;    // millis() when the counters were reset
+
 //        #ifdef DIAGNOSE_POWER
         void Help() override {}
         bool Parse(const char* cmd, const char* arg) override;   // delayed implementation, see end of file.
@@ -585,6 +630,7 @@
         virtual bool HoldPower() { return false; }   // Override to pause timeout
         virtual void PwrOn_Callback() {}          // Subscriber-specific code to be executed when subscriber power goes ON
         virtual void PwrOff_Callback() {}         // Subscriber-specific code to be executed when subscriber power goes OFF
+        virtual void Anticipate_Callback(uint32_t timeout) {}   // Subscriber domains were warmed up for 'timeout' millis, get ready if it takes long
 
     public:    
         // Constructor lists subscriber in powerman.subscribers
@@ -749,6 +795,84 @@
     }           
 
 
+    void PowerManager::Anticipate(PowerIntent intent) {
+        static const struct { PDType_base domains; uint16_t timeout; } intents[intent_numIntents] = {
+            { pwr4_SD | pwr4_Amplif | pwr4_Booster | pwr4_Pixel,    PWRMAN_INTENT_IGNITE },
+            { pwr4_SD,                                              PWRMAN_INTENT_MOTION },
+            { pwr4_SD | pwr4_Amplif | pwr4_Booster,                 PWRMAN_INTENT_MENU }
+        };
+        if (!domains || intent >= intent_numIntents) return;
+        PDType_base wanted = intents[intent].domains;
+        uint32_t timeout = intents[intent].timeout;
+        #ifdef DIAGNOSE_POWER
+            STDOUT.print("Anticipate domains: "); STDOUT.println(wanted);
+        #endif
+
+        // Request the wanted domains through the subscribers that use only those (DAC, SD, pixel
+        // blades), with the usual timeout bookkeeping, then let them get ready. ResetTimeout()
+        // only ever extends a countdown, so a longer request already pending is kept.
+        uint32_t timeouts[8];       // one per subscribed domain, see RequestPower()
+        for (uint8_t i = 0; i < NELEM(timeouts); i++) timeouts[i] = timeout;
+        PDType_base before = powerState;
+        for (PowerSubscriber *ps = subscribers; ps; ps = ps->next) {
+            if (!(ps->subscribedDomains & wanted) || (ps->subscribedDomains & ~wanted)) continue;
+            bool wasOn = (before & ps->subscribedDomains) == ps->subscribedDomains;
+            // RequestPower() runs PwrOn_Callback() only if it switched a domain on itself
+            if (!ps->RequestPower(timeouts) && !wasOn) ps->PwrOn_Callback();
+            ps->Anticipate_Callback(timeout);
+        }
+    }
+
+    void PowerManager::Idle() {
+        if (!idleEnabled || !domains) return;
+        if (powerState & ~pwr4_CPU) return;         // blade, audio or SD still powered: keep running flat out
+        if (subscribers)
+            for (PowerSubscriber *ps = subscribers; ps; ps = ps->next)
+                if (ps->HoldPower()) return;        // pending subscriber request
+
+        uint32_t sleepMicros = Looper::DoIdleMicros();
+        if (sleepMicros < PWRMAN_IDLE_MINSLEEP) return;
+        if (sleepMicros > PWRMAN_IDLE_MAXSLEEP) sleepMicros = PWRMAN_IDLE_MAXSLEEP;
+        uint32_t start = micros();
+
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        // Sleep mode: peripherals, DMA and SysTick keep running, so millis() stays right and every
+        // interrupt wakes us. SysTick does so each millisecond; go back to sleep unless the
+        // interrupt brought work (button edge, serial byte, motion data) or the deadline came.
+        while (true) {
+            __disable_irq();                        // an interrupt between check and WFI still ends the WFI
+            uint32_t left = Looper::DoIdleMicros();
+            uint32_t slept = micros() - start;
+            if (slept >= sleepMicros || left < PWRMAN_IDLE_MINSLEEP) {
+                __enable_irq();
+                break;
+            }
+            __DSB();
+            __WFI();
+            __enable_irq();                         // run the ISR that woke us
+        }
+    #else   // ESP architecture
+        #ifdef PWRMAN_ESP_LIGHTSLEEP
+        // Light sleep drops the UART bytes that wake it, so it's left for long waits only
+        // (Parser keeps waits short while a host session is active).
+        if (sleepMicros >= PWRMAN_LIGHTSLEEP_MIN) {
+            esp_sleep_enable_timer_wakeup(sleepMicros);
+            gpio_wakeup_enable((gpio_num_t)powerButtonPin, GPIO_INTR_LOW_LEVEL);
+            esp_sleep_enable_gpio_wakeup();
+            uart_set_wakeup_threshold(UART_NUM_0, 3);
+            esp_sleep_enable_uart_wakeup(UART_NUM_0);
+            esp_light_sleep_start();
+            gpio_wakeup_disable((gpio_num_t)powerButtonPin);
+            gpio_set_intr_type((gpio_num_t)powerButtonPin, GPIO_INTR_ANYEDGE);    // back to the button's edge interrupt
+        } else
+        #endif
+        // Block the loop task: the idle task parks the core (waiti) until the next interrupt/tick
+        vTaskDelay(sleepMicros / (1000 * portTICK_PERIOD_MS) ? sleepMicros / (1000 * portTICK_PERIOD_MS) : 1);
+    #endif
+        idleMicros += micros() - start;
+        idleCount++;
+    }
+
     bool PowerManager::Parse(const char* cmd, const char* arg) {
 #ifdef DIAGNOSE_POWER
         // "pwr-domains" - report status of all power domain objects
@@ -848,6 +972,22 @@
             return true;
         }
 #endif // DIAGNOSE_POWER
+        // "idle [on|off|reset]" - enable/disable idle sleep, report time slept
+        if (!strcmp(cmd, "idle")) {
+            if (arg) {
+                if (!strcmp(arg, "on")) idleEnabled = true;
+                else if (!strcmp(arg, "off")) idleEnabled = false;
+                else if (!strcmp(arg, "reset")) { idleMicros = 0; idleCount = 0; idleStatsStart = millis(); }
+                return true;
+            }
+            uint32_t window = millis() - idleStatsStart;
+            STDOUT.print("Idle "); STDOUT.print(idleEnabled ? "on" : "off");
+            STDOUT.print(": slept "); STDOUT.print((uint32_t)(idleMicros / 1000)); STDOUT.print(" of "); STDOUT.print(window);
+            STDOUT.print(" [ms] ("); STDOUT.print(window ? (float)idleMicros / 10.f / window : 0); STDOUT.print("%) in ");
+            STDOUT.print(idleCount); STDOUT.println(" sleeps.");
+            return true;
+        }
+
         // "deepsleep"
         if (!strcmp(cmd, "deepsleep")) {
 
@@ -9,6 +9,8 @@
  *  - enabled by #define X_PROBECPU                                *
  *  - overwrites ScopedCycleCounter and LoopCounter                 *
  *  - adds CPUprobe and RangeStats                                        *
+ *  - each probe also keeps log histograms of duration and period,  *
+ *    plus worst cases with timestamps, dumped in binary by "probes"*
  ********************************************************************/
 
 
@@ -22,9 +24,44 @@ enum DoWhatToProbe {
     print_frequency,
     print_duration,
     print_cpu_usage,
-    reset_probe
+    reset_probe,
+    dump_probe,
+    reset_window
 };
 
+#ifdef X_PROBECPU
+/** -----------------------------------------------------------
+ * Log histogram with 2 buckets per octave, 16-bit saturating counters.
+ * Bucket k >= 1 holds values in [L, L*1.5) for even k-1 and [L*1.5, 2L) for odd k-1, 
+ * where L = 2 ^ ((k-1)/2 + MIN_LOG2). Bucket 0 holds everything below 2^MIN_LOG2.
+ * Last bucket also holds everything above.
+ */
+#define PROBE_HIST_BUCKETS  32
+template<uint8_t MIN_LOG2>
+class LogHistogram {
+public:
+    uint16_t count[PROBE_HIST_BUCKETS];
+    uint32_t max;           // largest value in window
+    uint32_t maxMillis;     // millis() when max was recorded
+
+    LogHistogram() { Reset(); }
+    void Reset() { memset(count, 0, sizeof(count)); max = 0; maxMillis = 0; }
+
+    void Add(uint32_t value) {
+        uint8_t k = 0;
+        if (value >> MIN_LOG2) {
+            uint8_t msb = 31 - __builtin_clz(value);
+            k = 1 + 2 * (msb - MIN_LOG2) + (msb ? (value >> (msb - 1)) & 1 : 0);
+            if (k >= PROBE_HIST_BUCKETS) k = PROBE_HIST_BUCKETS - 1;
+        }
+        if (count[k] != 0xFFFF) count[k]++;
+        if (value > max) { max = value; maxMillis = millis(); }
+    }
+};
+typedef LogHistogram<6> xDurationHist;      // machine cycles, from 64
+typedef LogHistogram<2> xPeriodHist;        // microseconds, from 4
+#endif // X_PROBECPU
+
 /** -----------------------------------------------------------
  * CPU Probe: destination for ScopedCycleCounter
  * Holds statistics for duration of runs and time between runs
@@ -55,9 +92,16 @@ public:
     xCCRange duration;      // duration of last run, in machine cycles (based on CCYCNT)
     xCCRange cpu100;        // 100 * cpu_usage[%] (holding 2 decimals in the integer). cpu_usage[%] = 100 * run time / run period
                             // We keep this in a distinct range because we want the min and max of cpu_usage decoupled of period's and duration's min and max
+    xDurationHist durationHist; // distribution of durations, since windowStart
+    xPeriodHist periodHist;     // distribution of periods, since windowStart
+    uint32_t windowStart;       // millis() at last reset
 #endif // X_PROBECPU
     
-    CPUprobe() {   micros = 0;  }    // make sure it initializes empty; RangeStats constructors already called...
+    CPUprobe() {   micros = 0;  
+    #ifdef X_PROBECPU
+        windowStart = 0;
+    #endif
+    }    // make sure it initializes empty; RangeStats constructors already called...
     
     // reset stream and  microsecond counter 
     void Reset() {
@@ -66,9 +110,34 @@ public:
         period.Reset();
         duration.Reset();
         cpu100.Reset();
+        ResetWindow();
     #endif // X_PROBECPU
     }
 
+#ifdef X_PROBECPU
+    // Start a new histogram window, keep averages
+    void ResetWindow() {
+        durationHist.Reset();
+        periodHist.Reset();
+        windowStart = millis();
+    }
+
+    // Binary record: name length, name, window start, then duration and period histograms with their max & timestamps.
+    // All little endian: u8 len | name | u32 windowStart | u32 maxDur | u32 maxDurMillis | u16 durHist[] | u32 maxPer | u32 maxPerMillis | u16 perHist[]
+    void Dump(const char* name) {
+        uint8_t len = strlen(name);
+        STDOUT.write(len);
+        STDOUT.write((const uint8_t*)name, len);
+        STDOUT.write((const uint8_t*)&windowStart, 4);
+        STDOUT.write((const uint8_t*)&durationHist.max, 4);
+        STDOUT.write((const uint8_t*)&durationHist.maxMillis, 4);
+        STDOUT.write((const uint8_t*)durationHist.count, sizeof(durationHist.count));
+        STDOUT.write((const uint8_t*)&periodHist.max, 4);
+        STDOUT.write((const uint8_t*)&periodHist.maxMillis, 4);
+        STDOUT.write((const uint8_t*)periodHist.count, sizeof(periodHist.count));
+    }
+#endif // X_PROBECPU
+
     // Print various reports at STDOUT (no CR/LF!)
     void Print(DoWhatToProbe whattoprint) {
         #ifdef X_PROBECPU
@@ -128,21 +197,44 @@ class ScopedCycleCounter {
 private: 
     uint32_t cycles_;               // cycle counter @ constructor call
     CPUprobe& dest_;                // destination probe
+#ifdef X_PROBECPU
+    uint32_t nestedStart_;          // nested_ @ constructor call
+    static uint32_t nested_[2];     // per core: total cycles of all completed scopes, nested ones included. 
+                                    // Difference between destructor and constructor = cycles spent in scopes nested in this one
+  #ifdef ARDUINO_ARCH_ESP32   // ESP architecture
+    static portMUX_TYPE mux_;
+  #endif
+
+    // Scopes only nest on the core they run on: each core has its own nested_ count
+    static inline uint32_t& Nested() {
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        return nested_[0];
+    #else
+        return nested_[xPortGetCoreID()];
+    #endif
+    }
+#endif
+
+    static inline uint32_t CycleCount() {
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        return DWT->CYCCNT;
+    #else
+        return xthal_get_ccount();
+    #endif
+    }
 
 public:
     // Constructor calculates period and usage
     ScopedCycleCounter(CPUprobe& dest) : dest_(dest) {
         uint32_t microsNow = micros();      // we store micros() of last call even if CPU probes are disabled, we need this for the looper's scheduler
     #ifdef X_PROBECPU
-        #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-        cycles_ = DWT->CYCCNT;              // store machine cycle counter
-        #else
-        cycles_ = xthal_get_ccount();
-        #endif   
+        cycles_ = CycleCount();             // store machine cycle counter
+        nestedStart_ = Nested();
         // PRINT_TIMESTAMP STDOUT.print("ScopedCycleCounter constructor. Calculating frequency. Store micros = "); STDOUT.println(microsNow);
         if (dest_.micros) { // If the destination probe is not initialized ignore this iteration, we don't have enough data for calculations
             dest_.period.Add(microsNow-dest_.micros);   // Update period range  
                                                         // micros() is also a free running counter just like CCYCNT, but it resets at 71 minutes so we don't really need to guard
+            dest_.periodHist.Add(microsNow-dest_.micros);
             uint64_t temp = dest_.duration.val;         // cpu100 = 100 * cpu_usage[%]
             temp *= 10000;   // cpu_usage[%] = 100 * execution time / call period
             temp /= dest_.period.val;                   
@@ -161,32 +253,28 @@ public:
     // Destructor calculates duration 
     ~ScopedCycleCounter() {
     #ifdef X_PROBECPU
-        // PRINT_TIMESTAMP STDOUT.println("ScopedCycleCounter destructor. Calculating duration. "); 
-        uint64_t dCycles;
-        uint32_t cyclesNow;                               // we need to add two uint32's here
-       #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-        cyclesNow = DWT->CYCCNT;              // store machine cycle counter
+        // Duration excludes nested scopes (interrupts, inner probes), as it did when CYCCNT was rewound.
+        // The cycle counter itself is left alone so it keeps real time, on both architectures.
+        // An interrupt between reading the counter and nested_ would be counted twice
+        #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
         #else
-        cyclesNow = xthal_get_ccount();
-        #endif  
-        
-        // PRINT_TIMESTAMP STDOUT.print("cycles_since("); STDOUT.print(previous_CYCCNT); STDOUT.print(") = ");        
-        if (cycles_ < cyclesNow)              // DWT->CYCCNT is a free running counter so it resets every 
-            dCycles = cyclesNow - cycles_;    // 2^32 * cycletime (~53sec @ 80MHz). 
-        else
-            dCycles = (std::numeric_limits<uint32_t>::max() - cycles_) + cyclesNow;     // ... CYCCNT overrun
-
-        dest_.duration.Add((uint32_t)dCycles);      // Update duration range.
-        // STDOUT.print(" Added duration "); STDOUT.print(dest_.duration.val/80000.0f); STDOUT.println("[ms]");
-        // PRINT_TIMESTAMP
-
+        portENTER_CRITICAL(&mux_);
+        #endif
+        uint32_t& nested = Nested();
+        uint32_t total = CycleCount() - cycles_;            // unsigned difference handles the counter overrun
+        uint32_t own = total - (nested - nestedStart_);     // minus cycles spent in nested scopes
+        nested = nestedStart_ + total;                      // our parent will see this whole scope as nested
         #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-        DWT->CYCCNT = cycles_;  // Restore CYCCNT to its state at the constructor call
-                                // With this CCYCNT loses the sense of real time, but we need it to make the objects reentrant
+        __set_PRIMASK(primask);
         #else
-        // tODO add restore 
-        #endif  
-        // STDOUT.print("Restore CYCCNT = "); STDOUT.println(cycles);
+        portEXIT_CRITICAL(&mux_);
+        #endif
+
+        dest_.duration.Add((uint32_t)own);      // Update duration range.
+        dest_.durationHist.Add(own);
+        // STDOUT.print(" Added duration "); STDOUT.print(dest_.duration.val/80000.0f); STDOUT.println("[ms]");
     #endif // X_PROBECPU
     }
 
@@ -194,6 +282,13 @@ public:
 
 };
 
+#ifdef X_PROBECPU
+uint32_t ScopedCycleCounter::nested_[2] = { 0, 0 };
+  #ifdef ARDUINO_ARCH_ESP32   // ESP architecture
+portMUX_TYPE ScopedCycleCounter::mux_ = portMUX_INITIALIZER_UNLOCKED;
+  #endif
+#endif
+
 
 /*---------------------------------------------------------------------------
  *  Delegates everything to CPUprobe (still here for backward compatibility)
@@ -18,6 +18,17 @@
 #define STEALTH_MAX_VOLUME      21000   // ~32%
 #define STEALTH_MAX_BRIGHTNESS  21000   // ~32%
 
+#ifndef PROFILE_JOURNAL_FILE
+#define PROFILE_JOURNAL_FILE    "_osx_/profile.jnl"    // Journal of settings changes, shadows PROFILE_FILE
+#endif
+#ifndef PROFILE_JOURNAL_COMPACT
+#define PROFILE_JOURNAL_COMPACT 2048    // Journal size [bytes] above which it gets folded into PROFILE_FILE
+#endif
+#define PROFILE_JOURNAL_MAX_RECORD  256     // Largest record payload [bytes]
+#define PROFILE_JOURNAL_POLL    500000      // How often the journal checks if it can compact [us]
+#define PROFILE_JOURNAL_MAGIC   0x4A        // 'J'
+#define PROFILE_JOURNAL_HEAD    512         // COD bytes checked at run time to tell if it was replaced
+
 
 // Data structure to read/write profile to COD files
 struct profileData_t {
@@ -40,6 +51,314 @@ struct profileData_t {
 
 
 
+// Write profile and active presets entries of a COD file. 
+// apPairs = { ID, variation } for each active preset, in order.
+// __attribute__((optimize("Og")))
+bool WriteProfileCOD(const char* filename, uint16_t ID, const profileData_t& profileData, const vector<uint16_t>& apPairs) {
+    CodReader reader;
+    // 1. Overwrite profile entry in COD
+    if (!reader.Open(filename, true)) return false;     // open for overwrite
+    int32_t retVal = reader.OverwriteEntry(ID, (void*)&profileData, sizeof(profileData));
+    if (retVal != sizeof(profileData)) {
+        // STDOUT.print("[WriteUserProfile] Error writing struct, error="); STDOUT.println(retVal);
+        reader.Close();
+        return false;       // could not overwrite
+    }
+    // 2. Prepare active presets table
+    retVal = reader.FindEntry(profileData.activePresets_id); // this sets the codProperties so we can get the real table size - we might have fewer presets in RAM, if some were not good
+    if (retVal != COD_ENTYPE_TABLE) { reader.Close(); return false; }   // active presets table not found
+    uint8_t tableSize = 2*reader.codProperties.table.Columns;
+    vector<uint16_t> apData(tableSize, 0);    // active presets data - initialized everyting with 0
+    for (uint8_t i=0; i<apPairs.size()/2 && i<tableSize/2; i++) {
+        apData[i] = apPairs[2*i];
+        apData[tableSize/2+i] = apPairs[2*i+1];
+    }
+
+    // 3. Overwrite active presets entry in COD
+    retVal = reader.OverwriteEntry(profileData.activePresets_id, apData.data(), 2*tableSize);
+
+    // STDOUT.println("[WriteUserProfile] will write active presets table:");
+    // for (uint8_t i=0; i<apData.size(); i++) {
+    //     STDOUT.print(apData[i]); STDOUT.print(" ");
+    // }
+    // STDOUT.println("");        
+
+    reader.Close();
+    if (retVal != 2*tableSize) return false;
+
+    return true;
+}
+
+
+// -----------------------------------------------------------
+// PROFILE JOURNAL
+// Settings changes are appended to PROFILE_JOURNAL_FILE rather than overwriting the entries of PROFILE_FILE.
+// Record: { magic, type, size } | payload | CRC32 of header and payload. Record types:
+//  - jr_base:    CRC32 of PROFILE_FILE when the journal was started. If it doesn't match at boot, PROFILE_FILE 
+//                was replaced (e.g. by the PC app) and the journal is dropped.
+//  - jr_profile: profileData_t snapshot. The last valid one wins.
+//  - jr_presets: { ID, variation } of all active presets. The last valid one wins.
+//  - jr_compact: PROFILE_FILE is being rewritten from the journal, so it may be torn. Replay regardless of jr_base.
+// A record cut by power loss fails its CRC and replay stops there; the next record overwrites it.
+// The full CRC32 of PROFILE_FILE is only computed at boot and after compaction (blade off, no sound);
+// at run time, size and CRC32 of the first PROFILE_JOURNAL_HEAD bytes tell if it was replaced.
+// Once past PROFILE_JOURNAL_COMPACT, the journal is folded into PROFILE_FILE while the blade is off and 
+// no sound plays, so the larger write never competes with audio streaming.
+enum JournalRecordType : uint8_t {
+    jr_base = 1,
+    jr_profile,
+    jr_presets,
+    jr_compact
+};
+
+struct journalHeader_t {
+    uint8_t magic;
+    uint8_t type;
+    uint16_t size;
+} __attribute__((packed));
+
+class ProfileJournal : public Looper {
+public:
+    ProfileJournal() : Looper(PROFILE_JOURNAL_POLL) { 
+        end_ = 0;
+        codID_ = 0;
+        profileKnown_ = false;
+        presetsKnown_ = false;
+        compact_ = false;
+        compacting_ = false;
+        baseKnown_ = false;
+    }
+    const char* name() override { return "ProfileJournal"; }
+
+    // Read the journal of 'filename' (COD) and keep the latest records. Call before reading the COD.
+    void Replay(const char* filename, uint16_t ID) {
+        codFile_ = filename;
+        codID_ = ID;
+        end_ = 0;
+        profileKnown_ = false;
+        presetsKnown_ = false;
+        compact_ = false;
+        LOCK_SD(true);
+        Rebase();       // the one full read of the COD, at boot
+        File f = LSFS::Open(PROFILE_JOURNAL_FILE);
+        if (!f) { LOCK_SD(false); return; }   // no journal
+        journalHeader_t header;
+        uint8_t payload[PROFILE_JOURNAL_MAX_RECORD];
+        uint32_t crc, baseCRC = 0, pos = 0;
+        bool base = false, compacting = false;
+        while (f.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) {
+            if (header.magic != PROFILE_JOURNAL_MAGIC || header.size > PROFILE_JOURNAL_MAX_RECORD) break;
+            if ((uint32_t)f.read(payload, header.size) != header.size) break;
+            if (f.read((uint8_t*)&crc, 4) != 4) break;
+            CRC32 check;
+            check.Update(&header, sizeof(header));
+            check.Update(payload, header.size);
+            if (check.Value() != crc) break;        // torn or corrupted: ignore from here on
+            pos += sizeof(header) + header.size + 4;
+            switch (header.type) {
+                case jr_base: 
+                    if (header.size == 4) { memcpy(&baseCRC, payload, 4); base = true; }
+                    break;
+                case jr_profile:
+                    if (header.size == sizeof(profile_)) { memcpy(&profile_, payload, sizeof(profile_)); profileKnown_ = true; }
+                    break;
+                case jr_presets:
+                    presets_.assign((uint16_t*)payload, (uint16_t*)(payload + (header.size & ~3)));
+                    presetsKnown_ = true;
+                    break;
+                case jr_compact:
+                    compacting = true;
+                    break;
+            }
+        }
+        f.close();
+        if (!base || (!compacting && baseCRC != baseCRC_)) Discard();    // not started properly or COD replaced
+        else {
+            end_ = pos;
+            compacting_ = compacting;
+            compact_ = compacting || end_ >= PROFILE_JOURNAL_COMPACT;   // finish an interrupted compaction
+        }
+        LOCK_SD(false);
+    }
+
+    // Latest profile in the journal, if any
+    bool GetProfile(profileData_t* profileData) {
+        if (!end_ || !profileKnown_) return false;
+        *profileData = profile_;
+        return true;
+    }
+
+    // Set the variations of the loaded presets from the latest journal record, if any
+    void ApplyPresets() {
+        if (!end_ || !presetsKnown_) return;
+        for (uint8_t i=0; i<presets.size(); i++)
+            for (uint16_t j=0; j+1<presets_.size(); j+=2)
+                if (presets_[j] == presets[i].id) { presets[i].variation = presets_[j+1]; break; }
+    }
+
+    // What the COD holds, when the journal has no newer record
+    void Persisted(const profileData_t& profileData, const vector<uint16_t>& apPairs) {
+        if (!profileKnown_) { profile_ = profileData; profileKnown_ = true; }
+        if (!presetsKnown_) { presets_ = apPairs; presetsKnown_ = true; }
+    }
+
+    // Append records for whatever changed since last time. Returns false if the journal could not be written.
+    bool Save(const char* filename, uint16_t ID, const profileData_t& profileData, const vector<uint16_t>& apPairs) {
+        if (codID_ && (ID != codID_ || strcmp(filename, codFile_))) return false;  // journal belongs to another COD
+        codFile_ = filename;
+        codID_ = ID;
+        bool newProfile = !profileKnown_ || memcmp(&profile_, &profileData, sizeof(profile_));
+        bool newPresets = !presetsKnown_ || presets_ != apPairs;
+        if (!newProfile && !newPresets) return true;        // nothing changed
+        if (2*apPairs.size() > PROFILE_JOURNAL_MAX_RECORD) return false;
+        LOCK_SD(true);
+        if (Replaced()) {       // COD rewritten by someone else: the journal is stale, snapshot everything
+            Discard();
+            newProfile = newPresets = true;
+        }
+        File f = Open();
+        bool success = (bool)f;
+        if (success && newProfile) success = WriteRecord(f, jr_profile, &profileData, sizeof(profileData));
+        if (success && newPresets) success = WriteRecord(f, jr_presets, apPairs.data(), 2*apPairs.size());
+        f.close();
+        LOCK_SD(false);
+        if (!success) return false;
+        profile_ = profileData; profileKnown_ = true;
+        presets_ = apPairs; presetsKnown_ = true;
+        if (end_ >= PROFILE_JOURNAL_COMPACT) compact_ = true;
+        return true;
+    }
+
+    // Fold the journal into the COD and drop it
+    bool Compact() {
+        compact_ = false;
+        if (!end_) return true;             // nothing to fold
+        LOCK_SD(true);
+        if (!profileKnown_ || !presetsKnown_ || Replaced()) { Discard(); LOCK_SD(false); return true; }   // nothing to fold or COD is newer
+        File f = Open();
+        bool success = f && WriteRecord(f, jr_compact, 0, 0);  // from now on the COD may be torn, the journal stays authoritative
+        f.close();
+        if (success) compacting_ = true;
+        if (success) success = WriteProfileCOD(codFile_, codID_, profile_, presets_);
+        if (success) { Discard(); Rebase(); }
+        LOCK_SD(false);
+        return success;
+    }
+
+    // 'filename' was written without the journal
+    void Rewritten(const char* filename) {
+        if (codID_ && !strcmp(filename, codFile_)) baseKnown_ = false;
+    }
+
+    void Loop() override {
+        if (!compact_) return;
+        if (SaberBase::IsOn() || !LSFS::IsMounted()) return;
+    #ifdef ENABLE_AUDIO
+        if (SoundActive()) return;
+    #endif
+        Compact();      // on failure, retried after the next save
+    }
+
+    // { ID, variation } of the active presets in RAM
+    static void PresetPairs(vector<uint16_t>* apPairs) {
+        apPairs->resize(2*presets.size());
+        for (uint8_t i=0; i<presets.size(); i++) {
+            (*apPairs)[2*i] = presets[i].id;
+            (*apPairs)[2*i+1] = presets[i].variation;
+        }
+    }
+
+private:
+    const char* codFile_;
+    uint16_t codID_;
+    uint32_t end_;                  // end of the last valid record, 0 if there's no journal
+    profileData_t profile_;         // latest profile saved, in journal or COD
+    vector<uint16_t> presets_;      // latest active presets saved, in journal or COD
+    bool profileKnown_, presetsKnown_;
+    bool compact_;                  // compaction pending
+    bool compacting_;               // jr_compact written: COD is being rewritten from the journal
+    bool baseKnown_;                // baseCRC_ and the stamp are those of the COD as it is
+    uint32_t baseCRC_;              // CRC32 of the COD, 0 if there's none
+    uint32_t baseSize_, baseHead_;  // stamp of the COD: size and CRC32 of the head
+
+    // Size and CRC32 of the first PROFILE_JOURNAL_HEAD bytes of the open COD; 'crc' goes on from there
+    static void Stamp(File& f, uint32_t* size, uint32_t* head, CRC32* crc) {
+        uint8_t buffer[PROFILE_JOURNAL_HEAD];
+        *size = f.size();
+        int n = f.read(buffer, sizeof(buffer));
+        if (n < 0) n = 0;
+        *head = CRC32::Compute(buffer, n);
+        if (crc) crc->Update(buffer, n);
+    }
+
+    // Full CRC32 and stamp of the COD
+    void Rebase() {
+        baseKnown_ = true;
+        baseCRC_ = baseSize_ = baseHead_ = 0;
+        File f = LSFS::Open(codFile_);
+        if (!f) return;
+        CRC32 crc;
+        Stamp(f, &baseSize_, &baseHead_, &crc);
+        if (baseSize_ > PROFILE_JOURNAL_HEAD) crc.UpdateFromFile(&f, baseSize_ - PROFILE_JOURNAL_HEAD);
+        f.close();
+        baseCRC_ = crc.Value();
+    }
+
+    // COD still as Rebase() saw it, as far as the stamp tells
+    bool SameCOD() {
+        if (!baseKnown_) return false;
+        uint32_t size = 0, head = 0;
+        File f = LSFS::Open(codFile_);
+        if (f) { Stamp(f, &size, &head, nullptr); f.close(); }
+        return size == baseSize_ && head == baseHead_;
+    }
+
+    // Open the journal at the end of the last valid record. A new journal starts with the COD's CRC.
+    File Open() {
+        File f;
+        if (end_) {
+            f = LSFS::OpenForOverWrite(PROFILE_JOURNAL_FILE);
+            if (f) f.seek(end_);
+            return f;
+        }
+        if (!SameCOD()) Rebase();       // changed behind our back: full read, rare
+        compacting_ = false;
+        f = LSFS::OpenForWrite(PROFILE_JOURNAL_FILE);
+        if (f && !WriteRecord(f, jr_base, &baseCRC_, 4)) { f.close(); return File(); }
+        return f;
+    }
+
+    // COD changed since the journal was started, e.g. uploaded by the PC app
+    bool Replaced() {
+        return end_ && !compacting_ && !SameCOD();
+    }
+
+    // Write a record at the current position, in one go
+    bool WriteRecord(File& f, uint8_t type, const void* data, uint16_t size) {
+        uint8_t record[sizeof(journalHeader_t) + PROFILE_JOURNAL_MAX_RECORD + 4];
+        journalHeader_t* header = (journalHeader_t*)record;
+        header->magic = PROFILE_JOURNAL_MAGIC;
+        header->type = type;
+        header->size = size;
+        if (size) memcpy(record + sizeof(journalHeader_t), data, size);
+        uint32_t crc = CRC32::Compute(record, sizeof(journalHeader_t) + size);
+        memcpy(record + sizeof(journalHeader_t) + size, &crc, 4);
+        uint32_t n = sizeof(journalHeader_t) + size + 4;
+        if ((uint32_t)f.write(record, n) != n) return false;
+        end_ += n;
+        return true;
+    }
+
+    // Drop the journal, the COD is up to date
+    void Discard() {
+        LSFS::Remove(PROFILE_JOURNAL_FILE);
+        end_ = 0;
+    }
+};
+
+ProfileJournal profile_journal;
+
+
 // If needed, adjusts regular / stealth volume & brightness to follow policy. Changes 'userProfile'!
 void FixStealthMode() {
     // 1. Stealth is below limits
@@ -102,6 +421,7 @@ uint16_t ReadProfile(const char* filename, uint16_t ID) {
         // }
     }
     reader.Close();    
+    if (profile_journal.GetProfile(&profileData)) success = true;     // newer settings saved in the journal
     if (!success) { 
          #ifdef DIAGNOSE_BOOT
             STDOUT.println("Failed, could not read profile.");
@@ -155,14 +475,8 @@ uint16_t ReadProfile(const char* filename, uint16_t ID) {
     return profileData.activePresets_id;
 }
 
-// Write user profile and color variations to profile.cod
-// __attribute__((optimize("Og")))
-bool WriteUserProfile(const char* filename, uint16_t ID) {
-    // STDOUT.print("NOT Writing profile to file "); STDOUT.print(filename); STDOUT.print(", ID="); STDOUT.println(ID);
-    CodReader reader;
-    profileData_t profileData;
-
-    // 1. Prepare data structure for profile
+// Prepare data structure for profile, from current settings
+void GetProfileData(profileData_t& profileData) {
     profileData.volume = userProfile.combatVolume;                     // get current volume & brightness
     profileData.brightness = userProfile.combatBrightness;
     profileData.stealthVol = userProfile.stealthVolume;
@@ -177,55 +491,53 @@ bool WriteUserProfile(const char* filename, uint16_t ID) {
     profileData.menuSens = userProfile.menuSensitivity.userSetting;   
     profileData.activePresets_id = userProfile.apID;            // get presets
     profileData.currentPreset_index = userProfile.preset;
+}
 
-    // 2. Overwrite profile entry in COD
-    if (!reader.Open(filename, true)) return false;     // open for overwrite
-    int32_t retVal = reader.OverwriteEntry(ID, &profileData, sizeof(profileData));
-    if (retVal != sizeof(profileData)) {
-        // STDOUT.print("[WriteUserProfile] Error writing struct, error="); STDOUT.println(retVal);
-        reader.Close();
-        return false;       // could not overwrite
-    }
-    // 3. Prepare active presets table
-    retVal = reader.FindEntry(userProfile.apID); // this sets the codProperties so we can get the real table size - we might have fewer presets in RAM, if some were not good
-    if (retVal != COD_ENTYPE_TABLE) { reader.Close(); return false; }   // active presets table not found
-    uint8_t tableSize = 2*reader.codProperties.table.Columns;
-    vector<uint16_t> apData(tableSize, 0);    // active presets data - initialized everyting with 0
-    for (uint8_t i=0; i<presets.size(); i++) {
-        apData[i] = presets[i].id;
-        apData[tableSize/2+i] = presets[i].variation;
-    }
-
-    // 4. Overwrite active presets entry in COD
-    retVal = reader.OverwriteEntry(userProfile.apID, apData.data(), 2*tableSize);
-
-    // STDOUT.println("[WriteUserProfile] will write active presets table:");
-    // for (uint8_t i=0; i<apData.size(); i++) {
-    //     STDOUT.print(apData[i]); STDOUT.print(" ");
-    // }
-    // STDOUT.println("");        
+// Save user profile and color variations. Changes go to the journal; 
+// direct = fold them into profile.cod now (e.g. the PC app is going to read it)
+// __attribute__((optimize("Og")))
+bool WriteUserProfile(const char* filename, uint16_t ID, bool direct = false) {
+    // STDOUT.print("NOT Writing profile to file "); STDOUT.print(filename); STDOUT.print(", ID="); STDOUT.println(ID);
+    // 1. Prepare data
+    profileData_t profileData;
+    GetProfileData(profileData);
+    vector<uint16_t> apPairs;
+    ProfileJournal::PresetPairs(&apPairs);
 
-    reader.Close();
-    if (retVal != 2*tableSize) return false;
+    // 2. Append to journal
+    if (profile_journal.Save(filename, ID, profileData, apPairs)) 
+        return direct ? profile_journal.Compact() : true;
 
-    return true;
+    // 3. No journal, overwrite COD entries
+    profile_journal.Rewritten(filename);
+    return WriteProfileCOD(filename, ID, profileData, apPairs);
 } 
 
 
 
 
 // Read and set user profile from profile.cod; load active presets
-bool SetUserProfile(const char* filename) {
+// deferChecks: check the sounds of the current preset only, see LoadActivePresets()
+bool SetUserProfile(const char* filename, bool deferChecks = false) {
     #ifdef DIAGNOSE_BOOT
         STDOUT.println("");
         STDOUT.println("Starting xProfile ................................."); 
     #endif
+    profile_journal.Replay(filename, 1);            // settings saved since profile.cod was last written
     uint16_t retVal = ReadProfile(filename, 1);     // retVal = ID of active presets
     bool success = false; 
     if (retVal) {
         userProfile.apID = retVal;      // store ID of active presets table, in case we need to overwrite        
-        if (LoadActivePresets(filename, retVal)) success = true;
+        if (LoadActivePresets(filename, retVal, deferChecks)) {
+            profile_journal.ApplyPresets();     // saved color variations
+            success = true;
+        }
         else if (!presets.size()) userProfile.preset = 0;        // preset error if no valid preset (fatal error!!!)
+        profileData_t profileData;              // journal only needs to record changes from here
+        GetProfileData(profileData);
+        vector<uint16_t> apPairs;
+        ProfileJournal::PresetPairs(&apPairs);
+        profile_journal.Persisted(profileData, apPairs);
         #ifdef DIAGNOSE_BOOT
             STDOUT.print("... Setting current preset to #"); STDOUT.println(userProfile.preset);
         #endif
@@ -28,6 +28,10 @@ public:
     return on;
   }
 
+  uint32_t IdleMicros() override {
+    return Active() || on_ ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+  }
+
   void Enable() {
     last_enabled_ = millis();
     if (!on_) {
@@ -0,0 +1,147 @@
+#ifndef COMMON_BOOT_PROFILE_H
+#define COMMON_BOOT_PROFILE_H
+
+/********************************************************************
+ *  BOOT PROFILE - cycle timing of the boot stages                  *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - setup() marks the end of each stage with Mark(); the cycle    *
+ *    counter starts at 0 when setup() begins                       *
+ *  - the record sits in RAM that survives a reset (ESP32 RTC       *
+ *    memory, STM32 .noinit), so the previous boot can be compared  *
+ *  - "boot" prints the duration of each stage, this & last boot    *
+ ********************************************************************/
+
+#ifdef ARDUINO_ARCH_ESP32   // ESP architecture
+  #define BOOT_RECORD_ATTR RTC_NOINIT_ATTR
+#else
+  #define BOOT_RECORD_ATTR __attribute__((section(".noinit")))
+#endif
+
+#define BOOT_RECORD_MAGIC 0xB0075EC5
+
+// Boot stages, in boot order. Each one ends when it is marked.
+enum BootStage : uint8_t {
+    boot_serial,        // serial port, welcome message, firmware update check
+    boot_settle,        // PROFFIEOS_STARTUP_DELAY: voltages settle, storage powers up
+    boot_storage,       // serial flash / SD card init
+    boot_install,       // Install(): board configuration
+    boot_profile,       // user profile and active presets (current preset checked only)
+    boot_publish,       // offline content
+    boot_blades,        // blades activated, current preset set
+    boot_setup,         // Looper::DoSetup(): buttons, motion, sound...
+    boot_ready,         // SaberBase::DoBoot(): ignite-ready
+    boot_background,    // remaining presets checked, from the loop
+    boot_numStages
+};
+
+struct BootRecord {
+    uint32_t magic;
+    uint32_t boots;                     // resets since the record was (re)started
+    uint32_t preMicros;                 // micros() when setup() started: time spent in the core before it
+    uint32_t mhz;
+    uint32_t cycles[boot_numStages];    // cycles from setup() start to the end of each stage, 0 = not reached
+    uint32_t check;                     // ~magic
+};
+
+class BootProfile : CommandParser {
+public:
+    BootProfile() : CommandParser() {}
+
+    // First thing in setup(): keep the previous record, start a new one.
+    static void Begin() {
+        uint32_t pre = micros();
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+            CoreDebug->DEMCR |= 1<<24; // DEMCR_TRCENA_Msk;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+    #endif
+        start_ = Cycles();
+        bool valid = record_.magic == BOOT_RECORD_MAGIC && record_.check == ~BOOT_RECORD_MAGIC;
+        if (valid) last_ = record_;
+        else last_.magic = 0;
+        uint32_t boots = valid ? record_.boots + 1 : 1;
+        memset(&record_, 0, sizeof(record_));
+        record_.boots = boots;
+        record_.preMicros = pre;
+        record_.mhz = _SYSTEM_CORE_CLOCK_MHZ_;
+        record_.magic = BOOT_RECORD_MAGIC;
+        record_.check = ~BOOT_RECORD_MAGIC;
+    }
+
+    // End of a stage. Later marks of the same stage are ignored.
+    static void Mark(BootStage stage) {
+        if (stage >= boot_numStages || record_.cycles[stage]) return;
+        uint32_t c = Cycles() - start_;
+        record_.cycles[stage] = c ? c : 1;
+    }
+
+    bool Parse(const char* cmd, const char* arg) override {
+        if (strcmp(cmd, "boot")) return false;
+        STDOUT.print("Boot #"); STDOUT.print(record_.boots);
+        STDOUT.println(", stage durations [us] (this boot / last boot):");
+        Print(" core", StageDuration(record_, -1), StageDuration(last_, -1));
+        for (int8_t i = 0; i < boot_numStages; i++)
+            Print(stageNames_[i], StageDuration(record_, i), StageDuration(last_, i));
+        Print(" ready at", StageEnd(record_, boot_ready), StageEnd(last_, boot_ready));
+        return true;
+    }
+
+    void Help() override {
+        STDOUT.println(" boot - show boot stage timing");
+    }
+
+private:
+    static inline uint32_t Cycles() {
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        return DWT->CYCCNT;
+    #else
+        return xthal_get_ccount();
+    #endif
+    }
+
+    // Microseconds from reset to the end of 'stage', 0 if not reached
+    static uint32_t StageEnd(const BootRecord& r, int8_t stage) {
+        if (r.magic != BOOT_RECORD_MAGIC || !r.mhz) return 0;
+        if (stage < 0) return r.preMicros;
+        if (!r.cycles[stage]) return 0;
+        return r.preMicros + r.cycles[stage] / r.mhz;
+    }
+
+    // Microseconds spent in 'stage' (-1 = before setup), 0 if not reached
+    static uint32_t StageDuration(const BootRecord& r, int8_t stage) {
+        uint32_t end = StageEnd(r, stage);
+        if (!end || stage < 0) return end;
+        for (int8_t prev = stage - 1; prev >= 0; prev--)     // skip stages that were not reached
+            if (r.cycles[prev]) return end - StageEnd(r, prev);
+        return end - r.preMicros;
+    }
+
+    static void Print(const char* name, uint32_t now, uint32_t last) {
+        STDOUT.print(name); STDOUT.print(": ");
+        if (now) STDOUT.print(now); else STDOUT.print("-");
+        STDOUT.print(" / ");
+        if (last) STDOUT.println(last); else STDOUT.println("-");
+    }
+
+    static const char* const stageNames_[boot_numStages];
+    static BootRecord record_;
+    static BootRecord last_;
+    static uint32_t start_;
+};
+
+// One per BootStage, in enum order
+const char* const BootProfile::stageNames_[boot_numStages] = {
+    " serial", " settle", " storage", " install", " profile",
+    " publish", " blades", " setup", " ready", " background"
+};
+BOOT_RECORD_ATTR BootRecord BootProfile::record_;
+BootRecord BootProfile::last_;
+uint32_t BootProfile::start_ = 0;
+
+BootProfile bootProfile;
+
+#define BOOT_MARK(STAGE) BootProfile::Mark(STAGE)
+
+#endif // COMMON_BOOT_PROFILE_H
@@ -51,6 +51,63 @@ private:
   CommandParser* next_parser_;
 };
 
+// Table-driven commands: a parser keeps its commands in a static array
+// sorted by name (strcmp order!) and finds them by binary search instead
+// of walking a strcmp chain. Aliases are separate entries with the same
+// handler; a handler returns false to let other parsers try the command.
+// Diagnose and developer commands are left out of the table at compile time.
+template<class T>
+struct CommandEntry {
+  const char* name;
+  bool (T::*handler)(const char* arg);
+  const char* help;         // help line, nullptr = not listed
+};
+
+// strcmp() for constant expressions
+constexpr int CommandCompare(const char* a, const char* b) {
+  return *a != *b || !*a ? (uint8_t)*a - (uint8_t)*b : CommandCompare(a + 1, b + 1);
+}
+
+// For static_assert() after a constexpr command list: names in strictly increasing strcmp order
+template<class T, size_t N>
+constexpr bool CommandsSorted(const CommandEntry<T> (&entries)[N], size_t i = 1) {
+  return i >= N || (CommandCompare(entries[i-1].name, entries[i].name) < 0 && CommandsSorted(entries, i + 1));
+}
+
+template<class T>
+class CommandTable {
+public:
+  template<size_t N>
+  CommandTable(const CommandEntry<T> (&entries)[N]) : entries_(entries), size_(N) {}
+
+  const CommandEntry<T>* Find(const char* cmd) const {
+    uint16_t lo = 0, hi = size_;
+    while (lo < hi) {
+      uint16_t mid = (lo + hi) / 2;
+      int c = strcmp(cmd, entries_[mid].name);
+      if (!c) return entries_ + mid;
+      if (c < 0) hi = mid;
+      else lo = mid + 1;
+    }
+    return nullptr;
+  }
+
+  bool Run(T* target, const char* cmd, const char* arg) const {
+    const CommandEntry<T>* e = Find(cmd);
+    if (!e) return false;
+    return (target->*(e->handler))(arg);
+  }
+
+  void Help() const {
+    for (uint16_t i = 0; i < size_; i++)
+      if (entries_[i].help) STDOUT.println(entries_[i].help);
+  }
+
+private:
+  const CommandEntry<T>* entries_;
+  uint16_t size_;
+};
+
 // This ifdef avoids problems with tests
 #ifdef DEFINE_COMMON_STDOUT_GLOBALS
 
@@ -4,14 +4,28 @@
 #include "file_reader.h"
 #include "strfun.h"
 
+#ifndef CONFIG_READ_BUFFER
+#define CONFIG_READ_BUFFER 256    // bytes read from the file at once, also the longest line
+#endif
+
 // Reads an config file, looking for variable assignments.
 // TODO(hubbe): Read config files from serialflash.
+// Assignments are looked up in an index of the variables, sorted by name
+// hash and built from iterateVariables() on first use, so a line costs a
+// hash and a binary search instead of a compare with every variable.
+// Only plain variables (with an address()) are indexed; the font config
+// indexes its per-effect settings itself (FontConfigFile::SetVariable()).
+// Names found in neither index still go through SetVariableOP.
 struct ConfigFile {
 
   struct VariableBase {
+    typedef void (*Setter)(void* var, float v);
     virtual void set(float v) = 0;
     virtual float get() = 0;
     virtual void setDefault() = 0;
+    // Plain storage to set through setter(), nullptr if there's none
+    virtual void* address() { return nullptr; }
+    virtual Setter setter() { return nullptr; }
   };
 
   template<class T>
@@ -20,6 +34,9 @@ struct ConfigFile {
     void set(float value) override { var_ = value; }
     float get() override { return var_; }
     void setDefault() override { var_ = def_; }
+    void* address() override { return &var_; }
+    Setter setter() override { return &SetAt; }
+    static void SetAt(void* var, float value) { *(T*)var = value; }
   private:
     T& var_;
     T def_;
@@ -74,6 +91,95 @@ struct ConfigFile {
     BufferedFileWriter& f_;
   };
 
+  // Variable index entry: where to store the value, and how
+  struct IndexEntry {
+    uint32_t hash;
+    const char* name;     // in indexNames_
+    void* var;
+    VariableBase::Setter set;
+  };
+
+  // Case-insensitive FNV-1a of a variable name
+  static uint32_t NameHash(const char* name) {
+    uint32_t h = 2166136261;
+    for (; *name; name++) {
+      h ^= (uint8_t)toLower(*name);
+      h *= 16777619;
+    }
+    return h;
+  }
+
+  // Plain variables and the room their names take
+  struct CountOP : public VariableOP {
+    void run(const char* name, VariableBase* var) override {
+      if (!var->address()) return;
+      count++;
+      chars += strlen(name) + 1;
+    }
+    uint16_t count = 0;
+    uint16_t chars = 0;
+  };
+  struct IndexOP : public VariableOP {
+    IndexOP(IndexEntry* index, char* names) : index_(index), names_(names) {}
+    void run(const char* name, VariableBase* var) override {
+      if (!var->address()) return;
+      IndexEntry& e = index_[n_++];
+      e.hash = NameHash(name);
+      e.name = strcpy(names_, name);      // names may be built on the stack
+      names_ += strlen(name) + 1;
+      e.var = var->address();
+      e.set = var->setter();
+    }
+  private:
+    IndexEntry* index_;
+    char* names_;
+    uint16_t n_ = 0;
+  };
+
+  void BuildIndex() {
+    CountOP count;
+    iterateVariables(&count);
+    index_ = new IndexEntry[count.count ? count.count : 1];
+    indexNames_ = new char[count.chars ? count.chars : 1];
+    if (!index_ || !indexNames_) {
+      delete[] index_;
+      delete[] indexNames_;
+      index_ = nullptr;
+      indexNames_ = nullptr;
+      return;
+    }
+    IndexOP op(index_, indexNames_);
+    iterateVariables(&op);
+    indexSize_ = count.count;
+    // Insertion sort by hash: a few dozen entries, once.
+    for (uint16_t i = 1; i < indexSize_; i++) {
+      IndexEntry e = index_[i];
+      uint16_t j = i;
+      for (; j && index_[j-1].hash > e.hash; j--) index_[j] = index_[j-1];
+      index_[j] = e;
+    }
+  }
+
+  // Index entry of 'variable', nullptr if unknown
+  const IndexEntry* FindVariable(const char* variable) {
+    if (!index_) BuildIndex();
+    if (!index_) return nullptr;
+    uint32_t h = NameHash(variable);
+    uint16_t lo = 0, hi = indexSize_;
+    while (lo < hi) {
+      uint16_t mid = (lo + hi) / 2;
+      if (index_[mid].hash < h) lo = mid + 1;
+      else hi = mid;
+    }
+    for (; lo < indexSize_ && index_[lo].hash == h; lo++)
+      if (!strcasecmp(index_[lo].name, variable)) return &index_[lo];
+    return nullptr;
+  }
+
+  IndexEntry* index_ = nullptr;
+  char* indexNames_ = nullptr;
+  uint16_t indexSize_ = 0;
+
   template<class T>
   void DoVariableOp(VariableOP *op, const char* name, T& ref, T def) {
     Variable<T> var(ref, def);
@@ -85,45 +191,84 @@ struct ConfigFile {
     READ_OK,
     READ_END,
   };
+  // Read assignments in one buffered pass, a line at a time.
   virtual ReadStatus Read(FileReader* f, bool reset = true) {
     if (reset) SetVariable("=", 0.0);  // This resets all variables.
     if (!f || !f->IsOpen()) return ReadStatus::READ_FAIL;
-    for (; f->Available(); f->skipline()) {
-      char variable[33];
-      variable[0] = 0;
-      f->skipwhite();
-      if (f->Peek() == '#') continue;
-      f->readVariable(variable);
-      if (!strcmp(variable,"end")) return ReadStatus::READ_END;
-      f->skipwhite();
-      if (f->Peek() != '=') continue;
-      f->Read();
-      f->skipwhite();
-#ifndef KEEP_SAVEFILES_WHEN_PROGRAMMING
-      if (!strcmp(variable, "installed")) {
-	if (!f->Expect(install_time)) {
-	  return ReadStatus::READ_FAIL;
-	}
-	continue;
+    char buf[CONFIG_READ_BUFFER + 1];
+    int len = 0;          // bytes in buf
+    bool more = true;     // file not exhausted yet
+    bool cut = false;     // a line didn't fit, skip its remainder
+    while (more || len) {
+      if (more) {
+        int n = f->Read((uint8_t*)buf + len, CONFIG_READ_BUFFER - len);
+        if (n <= 0) more = false;
+        else len += n;
       }
-#endif
-      float v = f->readFloatValue();
-#if 0
-      STDOUT.print(variable);
-      STDOUT.print(" = ");
-      STDOUT.println(v);
-#endif
-      SetVariable(variable, v);
+      char* line = buf;
+      char* end = buf + len;
+      while (line < end) {
+        char* eol = (char*)memchr(line, '\n', end - line);
+        bool full = false;
+        if (!eol) {
+          if (more && line != buf) break;       // finish this line after the next read
+          full = more;                          // longer than the buffer
+          eol = end;
+        }
+        *eol = 0;
+        if (!cut) {
+          ReadStatus status = ParseLine(line);
+          if (status != ReadStatus::READ_OK) return status;
+        }
+        cut = full;
+        line = eol + 1;
+      }
+      if (line > end) line = end;
+      len = end - line;
+      memmove(buf, line, len);
     }
     return ReadStatus::READ_OK;
   }
 
+  static const char* SkipBlanks(const char* s) {
+    while (*s == ' ' || *s == '\t' || *s == '\r') s++;
+    return s;
+  }
+
+  // One "variable = value" line; comments and anything else are ignored.
+  ReadStatus ParseLine(const char* s) {
+    char variable[33];
+    s = SkipBlanks(s);
+    if (*s == '#') return ReadStatus::READ_OK;
+    uint8_t i = 0;
+    for (; i < 32; i++, s++) {
+      char c = toLower(*s);
+      if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '.')) break;
+      variable[i] = c;
+    }
+    variable[i] = 0;
+    if (!strcmp(variable,"end")) return ReadStatus::READ_END;
+    s = SkipBlanks(s);
+    if (*s != '=') return ReadStatus::READ_OK;
+    s = SkipBlanks(s + 1);
+#ifndef KEEP_SAVEFILES_WHEN_PROGRAMMING
+    if (!strcmp(variable, "installed")) {
+      if (strncmp(s, install_time, strlen(install_time))) return ReadStatus::READ_FAIL;
+      return ReadStatus::READ_OK;
+    }
+#endif
+    SetVariable(variable, parsefloat(s));
+    return ReadStatus::READ_OK;
+  }
+
 
   virtual void SetVariable(const char* variable, float v) {
     if (!strcmp(variable, "=")) {
       SetDefaultOP op;
       iterateVariables(&op);
-    } else {
+    } else if (const IndexEntry* e = FindVariable(variable)) {
+      e->set(e->var, v);
+    } else {      // unknown name, or no memory for the index
       SetVariableOP op(variable, v);
       iterateVariables(&op);
     }
@@ -168,8 +313,7 @@ struct ConfigFile {
     const char* nw = SkipWord(var_and_value);
     memcpy(variable, var_and_value, nw - var_and_value);
     variable[nw - var_and_value] = 0;
-    ConfigFile::SetVariableOP op(variable, parsefloat(nw));
-    iterateVariables(&op);
+    SetVariable(variable, parsefloat(nw));
   }
 
   ReadStatus Read(const char *filename, bool reset = true) {
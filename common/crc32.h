@@ -0,0 +1,222 @@
+#ifndef COMMON_CRC32_H
+#define COMMON_CRC32_H
+
+/********************************************************************
+/** CRC32 engine                                                    *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - Same result as the STM32 CRC peripheral in its default setup:
+ *    poly 0x04C11DB7, init 0xFFFFFFFF, no reflection, no final xor,
+ *    data fed as big-endian 32-bit words. A trailing 1..3 bytes
+ *    group is zero-extended to a full word (that's how both the
+ *    patched HAL and the ESP reproduction always handled it).
+ *  - Incremental: Update() can be called with any chunk sizes, the
+ *    partial word is kept until the next call or until Value().
+ *  - STM32L4: CRC peripheral, optionally DMA-fed for file streams
+ *    (define CRC32_DMA_CHANNEL to a free stm32l4 DMA channel).
+ *    Elsewhere: slicing-by-8 tables (8KB RAM, built on first use).
+ ********************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#define CRC32_INIT_VALUE  0xFFFFFFFF
+#define CRC32_POLY        0x04C11DB7
+
+#ifndef CRC32_DMA_IRQ_PRIORITY
+#define CRC32_DMA_IRQ_PRIORITY  15  // no callback is used, so this hardly matters
+#endif
+
+#ifndef CRC32_FILE_CHUNK
+#define CRC32_FILE_CHUNK  512       // bytes read from storage at once by UpdateFromFile()
+#endif
+
+class CRC32 {
+public:
+  CRC32() { Reset(); }
+
+  void Reset() {
+    crc_ = CRC32_INIT_VALUE;
+    tail_len_ = 0;
+  }
+
+  // Accumulate 'bytes' from 'data'.
+  void Update(const void* data, uint32_t bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    if (!p || !bytes) return;
+    if (tail_len_) {    // complete the pending word first
+      while (tail_len_ < 4 && bytes) {
+        tail_[tail_len_++] = *p++;
+        bytes--;
+      }
+      if (tail_len_ < 4) return;
+      crc_ = UpdateWords(crc_, tail_, 1);
+      tail_len_ = 0;
+    }
+    uint32_t words = bytes >> 2;
+    if (words) crc_ = UpdateWords(crc_, p, words);
+    p += words << 2;
+    tail_len_ = bytes & 3;
+    memcpy(tail_, p, tail_len_);
+  }
+
+  // CRC of everything accumulated since Reset(). Does not alter the state.
+  uint32_t Value() const {
+    if (!tail_len_) return crc_;
+    uint8_t last[4] = {0, 0, 0, 0};
+    memcpy(last + 4 - tail_len_, tail_, tail_len_);    // zero-extended, right aligned
+    return UpdateWords(crc_, last, 1);
+  }
+
+  // One-shot CRC of a buffer.
+  static uint32_t Compute(const void* data, uint32_t bytes) {
+    CRC32 crc;
+    crc.Update(data, bytes);
+    return crc.Value();
+  }
+
+  // Accumulate 'bytes' read from the current position of an open file (File or FileReader-like:
+  // anything with read(uint8_t*, size)). Returns false if the file ran out of data.
+  template<class FILE_T>
+  bool UpdateFromFile(FILE_T* file, uint32_t bytes) {
+    bool ok = true;
+#if defined(ARDUINO_ARCH_STM32L4) && defined(CRC32_DMA_CHANNEL)
+    uint8_t buffer[2][CRC32_FILE_CHUNK];
+    uint8_t crt = 0;
+    // Double buffering: the CRC peripheral eats one chunk over DMA while we read the next one.
+    bool pending = false;
+    while (bytes) {
+      uint32_t n = bytes < CRC32_FILE_CHUNK ? bytes : CRC32_FILE_CHUNK;
+      if ((uint32_t)file->read(buffer[crt], n) != n) { ok = false; break; }
+      bytes -= n;
+      if (pending) pending = !DMAFinish();
+      if (!tail_len_ && !(n & 3) && n >= 4 && DMAStart(buffer[crt], n)) pending = true;
+      else Update(buffer[crt], n);
+      crt ^= 1;
+    }
+    if (pending) DMAFinish();
+#else
+    uint8_t buffer[CRC32_FILE_CHUNK];
+    while (bytes) {
+      uint32_t n = bytes < CRC32_FILE_CHUNK ? bytes : CRC32_FILE_CHUNK;
+      if ((uint32_t)file->read(buffer, n) != n) { ok = false; break; }
+      Update(buffer, n);
+      bytes -= n;
+    }
+#endif
+    return ok;
+  }
+
+  // Call once at boot, before first use (enables the peripheral clock / builds the tables).
+  static void Begin() {
+#ifdef ARDUINO_ARCH_STM32L4
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    (void)RCC->AHB1ENR;                     // wait for the clock to settle
+    CRC->POL = CRC32_POLY;
+    CRC->CR = 0;                            // 32-bit poly, no reversal
+    CRC->INIT = CRC32_INIT_VALUE;
+  #ifdef CRC32_DMA_CHANNEL
+    stm32l4_dma_create(&dma_, CRC32_DMA_CHANNEL, CRC32_DMA_IRQ_PRIORITY);
+  #endif
+#else
+    BuildTables();
+#endif
+  }
+
+private:
+  uint32_t crc_;
+  uint8_t tail_[4];
+  uint8_t tail_len_;
+
+#ifdef ARDUINO_ARCH_STM32L4
+  // Hardware: load the running CRC as INIT, feed words, read back.
+  // Each call is self-contained so several CRC32 objects can interleave.
+  static uint32_t UpdateWords(uint32_t crc, const uint8_t* p, uint32_t words) {
+    CRC->INIT = crc;
+    CRC->CR |= CRC_CR_RESET;
+    for (; words; words--, p += 4)
+      CRC->DR = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    return CRC->DR;
+  }
+
+  #ifdef CRC32_DMA_CHANNEL
+  static stm32l4_dma_t dma_;
+
+  // Bytes written one at a time into DR give the same CRC as the big-endian words
+  // made of them, so DMA can feed the data as it sits in memory.
+  bool DMAStart(const uint8_t* p, uint32_t bytes) {
+    if (bytes > 0xFFFF) return false;
+    if (!stm32l4_dma_enable(&dma_, NULL, NULL)) return false;
+    CRC->INIT = crc_;
+    CRC->CR |= CRC_CR_RESET;
+    stm32l4_dma_start(&dma_, (uint32_t)&CRC->DR, (uint32_t)p, bytes,
+                      DMA_OPTION_MEMORY_TO_PERIPHERAL | DMA_CCR_MEM2MEM |
+                      DMA_OPTION_PERIPHERAL_DATA_SIZE_8 | DMA_OPTION_MEMORY_DATA_SIZE_8 |
+                      DMA_OPTION_MEMORY_DATA_INCREMENT | DMA_OPTION_PRIORITY_LOW);
+    return true;
+  }
+
+  // Wait for the running transfer and collect the CRC. Always returns true.
+  bool DMAFinish() {
+    while (!stm32l4_dma_done(&dma_)) { }
+    stm32l4_dma_stop(&dma_);
+    stm32l4_dma_disable(&dma_);
+    crc_ = CRC->DR;
+    return true;
+  }
+  #endif // CRC32_DMA_CHANNEL
+
+#else // software
+  static uint32_t table_[8][256];
+  static bool tablesReady_;
+
+  static void BuildTables() {
+    if (tablesReady_) return;
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t c = b << 24;
+      for (uint8_t i = 0; i < 8; i++)
+        c = (c & 0x80000000) ? (c << 1) ^ CRC32_POLY : (c << 1);
+      table_[0][b] = c;
+    }
+    // table_[k][b]: byte b followed by k zero bytes
+    for (uint8_t k = 1; k < 8; k++)
+      for (uint32_t b = 0; b < 256; b++)
+        table_[k][b] = (table_[k-1][b] << 8) ^ table_[0][table_[k-1][b] >> 24];
+    tablesReady_ = true;
+  }
+
+  static inline uint32_t BE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+  }
+
+  // Slicing-by-8: two words per step, one by four for the odd one.
+  static uint32_t UpdateWords(uint32_t crc, const uint8_t* p, uint32_t words) {
+    if (!tablesReady_) BuildTables();
+    for (; words >= 2; words -= 2, p += 8) {
+      uint32_t hi = crc ^ BE32(p);
+      uint32_t lo = BE32(p + 4);
+      crc = table_[7][hi >> 24] ^ table_[6][(hi >> 16) & 0xFF] ^
+            table_[5][(hi >> 8) & 0xFF] ^ table_[4][hi & 0xFF] ^
+            table_[3][lo >> 24] ^ table_[2][(lo >> 16) & 0xFF] ^
+            table_[1][(lo >> 8) & 0xFF] ^ table_[0][lo & 0xFF];
+    }
+    if (words) {
+      crc ^= BE32(p);
+      crc = table_[3][crc >> 24] ^ table_[2][(crc >> 16) & 0xFF] ^
+            table_[1][(crc >> 8) & 0xFF] ^ table_[0][crc & 0xFF];
+    }
+    return crc;
+  }
+#endif
+};
+
+#ifdef ARDUINO_ARCH_STM32L4
+  #ifdef CRC32_DMA_CHANNEL
+  stm32l4_dma_t CRC32::dma_;
+  #endif
+#else
+uint32_t CRC32::table_[8][256];
+bool CRC32::tablesReady_ = false;
+#endif
+
+#endif // COMMON_CRC32_H
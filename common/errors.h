@@ -22,11 +22,15 @@ void ProffieOSErrors::sd_card_not_found() {
   talkie.Say(talkie_sd_card_15, 15);
   talkie.Say(talkie_not_found_15, 15);
 #else
-  beeper.Beep(0.5, 261.63 * 2); // C4
-  beeper.Beep(0.5, 293.66 * 2); // D4
-  beeper.Beep(0.5, 261.63 * 2); // C4
-  beeper.Beep(0.5, 196.00 * 2); // G3
-  beeper.Beep(1.0, 130.81 * 2); // C3
+  static const BeepNote notes[] = {
+    { 500, 523, beep_flat },    // C4
+    { 500, 587, beep_flat },    // D4
+    { 500, 523, beep_flat },    // C4
+    { 500, 392, beep_flat },    // G3
+    { 1000, 262, beep_decay },  // C3
+    { 0, 0, beep_flat }
+  };
+  beeper.Play(notes);
 #endif
 #endif
 }
@@ -38,13 +42,17 @@ void ProffieOSErrors::font_directory_not_found() {
   talkie.Say(talkie_font_directory_15, 15);
   talkie.Say(talkie_not_found_15, 15);
 #else
-  beeper.Beep(0.5, 261.63 * 2); // C4
-  beeper.Beep(0.5/3, 246.94 * 2); // B3
-  beeper.Beep(0.5/3, 220.00 * 2); // A3
-  beeper.Beep(0.5/3, 196.00 * 2); // G3
-  beeper.Beep(0.5, 174.61 * 2); // F3
-  beeper.Beep(0.5, 146.83 * 2); // D3
-  beeper.Beep(0.5, 130.81 * 2); // C3
+  static const BeepNote notes[] = {
+    { 500, 523, beep_flat },    // C4
+    { 167, 494, beep_flat },    // B3
+    { 167, 440, beep_flat },    // A3
+    { 167, 392, beep_flat },    // G3
+    { 500, 349, beep_flat },    // F3
+    { 500, 294, beep_flat },    // D3
+    { 500, 262, beep_decay },   // C3
+    { 0, 0, beep_flat }
+  };
+  beeper.Play(notes);
 #endif
 #endif
 }
@@ -57,14 +65,18 @@ void ProffieOSErrors::error_in_blade_array() {
   talkie.Say(talkie_error_in_15, 15);
   talkie.Say(talkie_blade_array_15, 15);
 #else
-  beeper.Beep(0.25, 174.61 * 2); // F3 - Er
-  beeper.Beep(0.25, 196.00 * 2); // G3 - ror
-  beeper.Beep(0.25, 174.61 * 2); // F3 - in
-  beeper.Beep(0.25, 164.81 * 2); // E3 - the
-  beeper.Beep(0.3, 146.83 * 2); // D3 - blade
-  beeper.Beep(0.2, 0);
-  beeper.Beep(0.5, 146.83 * 2); // D3 - ar
-  beeper.Beep(1.0, 130.81 * 2); // C3 - ray
+  static const BeepNote notes[] = {
+    { 250, 349, beep_flat },    // F3 - Er
+    { 250, 392, beep_flat },    // G3 - ror
+    { 250, 349, beep_flat },    // F3 - in
+    { 250, 330, beep_flat },    // E3 - the
+    { 300, 294, beep_flat },    // D3 - blade
+    { 200, 0, beep_flat },
+    { 500, 294, beep_flat },    // D3 - ar
+    { 1000, 262, beep_decay },  // C3 - ray
+    { 0, 0, beep_flat }
+  };
+  beeper.Play(notes);
 #endif
 #endif
 }
@@ -76,15 +88,19 @@ void ProffieOSErrors::error_in_font_directory() {
   talkie.Say(talkie_error_in_15, 15);
   talkie.Say(talkie_font_directory_15, 15);
 #else
-  beeper.Beep(0.25, 174.61 * 2); // F3
-  beeper.Beep(0.25, 196.0 * 2); // G3
-  beeper.Beep(0.25, 174.61 * 2); // F3
-  beeper.Beep(0.25, 164.81 * 2); // E3
-  beeper.Beep(0.5, 146.83 * 2); // D3
-  beeper.Beep(0.5, 164.81 * 2); // E3
-  beeper.Beep(0.5, 196.0 * 2); // G3
-  beeper.Beep(0.5, 246.94 * 2); // B3
-  beeper.Beep(0.5, 261.63 * 2); // C4
+  static const BeepNote notes[] = {
+    { 250, 349, beep_flat },    // F3
+    { 250, 392, beep_flat },    // G3
+    { 250, 349, beep_flat },    // F3
+    { 250, 330, beep_flat },    // E3
+    { 500, 294, beep_flat },    // D3
+    { 500, 330, beep_flat },    // E3
+    { 500, 392, beep_flat },    // G3
+    { 500, 494, beep_flat },    // B3
+    { 500, 523, beep_decay },   // C4
+    { 0, 0, beep_flat }
+  };
+  beeper.Play(notes);
 #endif
 #endif
 }
@@ -100,8 +116,12 @@ void ProffieOSErrors::low_battery() {
 #ifndef DISABLE_TALKIE
   talkie.Say(talkie_low_battery_15, 15);
 #else
-  beeper.Beep(1.0, 261.63 * 2); // C4
-  beeper.Beep(1.0, 130.81 * 2); // C3
+  static const BeepNote notes[] = {
+    { 1000, 523, beep_flat },   // C4
+    { 1000, 262, beep_decay },  // C3
+    { 0, 0, beep_flat }
+  };
+  beeper.Play(notes);
 #endif
 #endif
 }
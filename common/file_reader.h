@@ -83,6 +83,12 @@ private:
 };
 
 // TODO: Make proper assignment or use std::variant instead.
+#ifdef ENABLE_FLASH_CACHE
+// Serial flash copies of SD files, see flash_cache.h
+bool FlashCacheLookup(const char* filename, char* cachedName);
+void FlashCacheWant(const char* filename);
+#endif
+
 class FileReader {
 public:
   FileReader() : type_(TYPE_MEM) {
@@ -91,6 +97,9 @@ public:
   ~FileReader() { Close(); }
   bool Open(const char* filename) {
     Close();
+#ifdef ENABLE_FLASH_CACHE
+    if (OpenCached(filename)) return true;
+#endif
 #ifdef ENABLE_SERIALFLASH
     new (&sf_file_) SerialFlashFile;
     type_ = TYPE_SF;
@@ -106,6 +115,9 @@ public:
     type_ = TYPE_SD;
     sd_file_ = LSFS::Open(filename);
     if (sd_file_) {
+#ifdef ENABLE_FLASH_CACHE
+      FlashCacheWant(filename);
+#endif
       return true;
     } else {
       Close();
@@ -116,6 +128,9 @@ public:
 
   bool OpenFast(const char* filename) {
     Close();
+#ifdef ENABLE_FLASH_CACHE
+    if (OpenCached(filename)) return true;
+#endif
 #ifdef ENABLE_SERIALFLASH
     new (&sf_file_) SerialFlashFile;
     type_ = TYPE_SF;
@@ -131,6 +146,9 @@ public:
     type_ = TYPE_SD;
     sd_file_ = LSFS::OpenFast(filename);
     if (sd_file_) {
+#ifdef ENABLE_FLASH_CACHE
+      FlashCacheWant(filename);
+#endif
       return true;
     } else {
       Close();
@@ -138,6 +156,19 @@ public:
 #endif
     return false;
   }
+#ifdef ENABLE_FLASH_CACHE
+  bool OpenCached(const char* filename) {
+    char cached[12];
+    if (!FlashCacheLookup(filename, cached)) return false;
+    new (&sf_file_) SerialFlashFile;
+    type_ = TYPE_SF;
+    sf_file_ = SerialFlashChip::open(cached);
+    if (sf_file_) return true;
+    Close();
+    return false;
+  }
+#endif
+
   bool Create(const char* filename) {
     Close();
 #ifdef ENABLE_SD
@@ -169,6 +200,15 @@ public:
     mem_file_ = tmp;
     return true;
   }
+  // Read from the SD card, as opposed to serial flash or memory
+  bool OnSD() {
+#ifdef ENABLE_SD
+    return type_ == TYPE_SD;
+#else
+    return false;
+#endif
+  }
+
   bool IsOpen() {
     switch (type_) {
       IF_SD(case TYPE_SD: return !!sd_file_;)
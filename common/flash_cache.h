@@ -0,0 +1,576 @@
+#ifndef COMMON_FLASH_CACHE_H
+#define COMMON_FLASH_CACHE_H
+
+/********************************************************************
+ *  FLASH CACHE - serial flash mirror of hot SD font files          *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - enabled by #define ENABLE_FLASH_CACHE, on boards with both    *
+ *    ENABLE_SD and ENABLE_SERIALFLASH                              *
+ *  - hum, swing, clash and blast files opened from SD are queued   *
+ *    and copied to serial flash while the blade is off and no      *
+ *    sound plays; FileReader::Open() then prefers the copy         *
+ *  - copies pause while the blade is on, a sound plays or a       *
+ *    serial session is open, and go on from their offset after;    *
+ *    only a file that changed on SD loses its partial copy         *
+ *  - index: append-only records in one of two erasable index       *
+ *    files, last record of a path wins, size = 0 removes it; a     *
+ *    full index is compacted into the other one                    *
+ *  - staleness: every boot and after each serial session, entries  *
+ *    are only used again once SD size and CRC32 of the whole file  *
+ *    match the record (read in slices, like copies); copies are    *
+ *    verified against the same CRC32 when written                  *
+ *  - serial flash can't reclaim removed files: "fcache clear"      *
+ *    drops the cache, "format" gets the space back                 *
+ ********************************************************************/
+
+#ifdef ENABLE_FLASH_CACHE
+
+#if !defined(ENABLE_SD) || !defined(ENABLE_SERIALFLASH)
+#error ENABLE_FLASH_CACHE needs ENABLE_SD and ENABLE_SERIALFLASH
+#endif
+
+#ifndef FLASH_CACHE_ENTRIES
+#define FLASH_CACHE_ENTRIES     64          // files cached
+#endif
+#define FLASH_CACHE_QUEUE       8           // files waiting to be copied
+#define FLASH_CACHE_PATH        64          // longest SD path cached, including terminator
+#define FLASH_CACHE_HEAD        512         // bytes checked first for staleness
+#define FLASH_CACHE_CHUNK       512         // bytes copied at once
+#define FLASH_CACHE_SLICE       2000        // [us] copy time per Loop()
+#define FLASH_CACHE_INDEX       "fc/index"  // the two index files, used in turn
+#define FLASH_CACHE_INDEX_B     "fc/indexb"
+#define FLASH_CACHE_INDEX_SIZE  65536       // one erase block
+#define FLASH_CACHE_MAGIC       0xFCAC4E01
+
+struct FlashCacheRecord {
+    uint32_t magic;                 // FLASH_CACHE_MAGIC; erased flash = end of index
+    uint32_t pathHash;
+    uint32_t size;                  // SD file size, 0 = removed
+    uint32_t headCRC;               // CRC32 of the first FLASH_CACHE_HEAD bytes
+    uint32_t crc;                   // CRC32 of the whole file
+    char path[FLASH_CACHE_PATH];
+    uint32_t check;                 // CRC32 of the fields above
+} __attribute__((packed));
+
+class FlashCache : Looper, CommandParser {
+public:
+    FlashCache() : Looper(), CommandParser() {
+        nEntries_ = 0;
+        nQueued_ = 0;
+        nRecords_ = 0;
+        full_ = false;
+        copying_ = false;
+        checking_ = false;
+        job_.open = false;
+        check_.open = false;
+        loaded_ = false;
+        session_ = false;
+        index_ = 0;
+    }
+    const char* name() override { return "FlashCache"; }
+
+    // Serial flash name of a checked copy of 'path', if any
+    bool Lookup(const char* path, char* cachedName) {
+        Entry* e = Find(Hash(path));
+        if (!e || e->state != fc_valid) return false;
+        FlashCacheRecord r;     // the hash only finds the entry, its record has the path
+        if (!ReadRecord(e->record, &r)) return false;
+        r.path[FLASH_CACHE_PATH - 1] = 0;
+        if (strcasecmp(r.path, path)) return false;
+        CachedName(e->pathHash, cachedName);
+        return true;
+    }
+
+    // 'path' was opened from SD: queue it for copy if it's a hot font file
+    void Want(const char* path) {
+        if (full_ || !Hot(path) || strlen(path) >= FLASH_CACHE_PATH) return;
+        uint32_t hash = Hash(path);
+        if (Find(hash)) return;                         // cached or waiting for check
+        if (copying_ && job_.hash == hash) return;
+        for (uint8_t i = 0; i < nQueued_; i++)
+            if (!strcmp(queue_[i], path)) return;
+        if (nQueued_ >= FLASH_CACHE_QUEUE) return;
+        strcpy(queue_[nQueued_++], path);
+    }
+
+    // SD content may have changed: check all entries again before using them
+    void Unvalidate() {
+        Pause();
+        for (uint8_t i = 0; i < nEntries_; i++)
+            if (Valid(i)) entries_[i].state = fc_unchecked;
+        checking_ = false;                  // restarts from the first byte
+        if (copying_) {                     // the part already copied is read again before going on
+            job_.checked = 0;
+            job_.check.Reset();
+        }
+    }
+
+    // Serial session state, every pass: nothing runs during a session, and everything is checked again after it
+    void Session(bool open) {
+        if (open && !session_) Unvalidate();
+        session_ = open;
+    }
+
+protected:
+    void Setup() override {
+        Load();
+    }
+
+    // Works only while the card is mounted (and powered: no idle sleep then)
+    uint32_t IdleMicros() override {
+        return loaded_ && !session_ && LSFS::IsMounted() ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+    }
+
+    void Loop() override {
+        bool idle = loaded_ && !session_ && !SaberBase::IsOn() && LSFS::IsMounted();
+    #ifdef ENABLE_AUDIO
+        if (SoundActive()) idle = false;
+    #endif
+        if (!idle) { Pause(); return; }
+        LOCK_SD(true);
+        uint32_t start = micros();
+        while (micros() - start < FLASH_CACHE_SLICE) {
+            if (copying_) { Copy(); continue; }
+            if (checking_) { Check(); continue; }
+            if (StartCheck()) continue;
+            if (nQueued_) { StartCopy(); continue; }
+            break;      // nothing to do
+        }
+        LOCK_SD(false);
+    }
+
+    bool Parse(const char* cmd, const char* arg) override {
+        if (strcmp(cmd, "fcache")) return false;
+        if (arg && !strcmp(arg, "clear")) {
+            Clear();
+            STDOUT.println("Flash cache cleared.");
+            return true;
+        }
+        uint8_t valid = 0, unchecked = 0;
+        for (uint8_t i = 0; i < nEntries_; i++) {
+            if (entries_[i].state == fc_valid) valid++;
+            if (entries_[i].state == fc_unchecked) unchecked++;
+        }
+        STDOUT.print("Flash cache: "); STDOUT.print(valid); STDOUT.print(" files, ");
+        STDOUT.print(unchecked); STDOUT.print(" unchecked, ");
+        STDOUT.print(nQueued_ + copying_); STDOUT.print(" queued");
+        if (full_) STDOUT.print(", full");
+        STDOUT.println("");
+        return true;
+    }
+
+    void Help() override {
+        STDOUT.println(" fcache [clear] - flash cache status / drop all cached files");
+    }
+
+private:
+    enum EntryState : uint8_t {
+        fc_unchecked = 0,   // in index, not checked against SD yet
+        fc_valid,           // checked, Lookup() returns it
+        fc_removed          // stale or cleared
+    };
+
+    struct Entry {
+        uint32_t pathHash;
+        uint16_t record;    // last index record of this path
+        EntryState state;
+    };
+
+    struct CopyJob {
+        uint32_t hash;
+        File src;
+        SerialFlashFile dst;
+        bool open;          // files open; closed while paused
+        CRC32 crc, headCRC;
+        uint32_t pos, size;
+        CRC32 check;        // SD bytes read again up to 'pos' after a serial session
+        uint32_t checked;
+        char path[FLASH_CACHE_PATH];
+    };
+
+    struct CheckJob {
+        uint8_t entry;
+        File f;
+        bool open;
+        CRC32 crc, headCRC;
+        uint32_t pos;
+        FlashCacheRecord r;
+    };
+
+    Entry entries_[FLASH_CACHE_ENTRIES];
+    uint8_t nEntries_;
+    char queue_[FLASH_CACHE_QUEUE][FLASH_CACHE_PATH];
+    uint8_t nQueued_;
+    uint16_t nRecords_;     // records in index
+    CopyJob job_;
+    CheckJob check_;
+    bool copying_;
+    bool checking_;
+    bool full_;             // out of flash space or entries
+    bool loaded_;
+    bool session_;          // serial session open
+    uint8_t index_;         // index file in use
+
+    bool Valid(uint8_t i) { return entries_[i].state == fc_valid; }
+
+    // FNV-1a
+    static uint32_t Hash(const char* path) {
+        uint32_t h = 2166136261u;
+        for (; *path; path++) {
+            h ^= (uint8_t)toLower(*path);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    static void CachedName(uint32_t hash, char* name) {
+        const char* hex = "0123456789abcdef";
+        strcpy(name, "fc/");
+        for (int8_t i = 7; i >= 0; i--)
+            name[3 + 7 - i] = hex[(hash >> (4 * i)) & 15];
+        name[11] = 0;
+    }
+
+    // Any path element starting as a hot effect name
+    static bool Hot(const char* path) {
+        static const char* const hot[] = { "hum", "swing", "swng", "lswing", "hswing", "clsh", "clash", "blst", "blast" };
+        for (const char* p = path; p; p = strchr(p, '/')) {
+            if (*p == '/') p++;
+            for (uint8_t i = 0; i < NELEM(hot); i++)
+                if (startswith(hot[i], p)) return true;
+        }
+        return false;
+    }
+
+    Entry* Find(uint32_t hash) {
+        for (uint8_t i = 0; i < nEntries_; i++)
+            if (entries_[i].pathHash == hash && entries_[i].state != fc_removed) return entries_ + i;
+        return nullptr;
+    }
+
+    static const char* IndexName(uint8_t which) { return which ? FLASH_CACHE_INDEX_B : FLASH_CACHE_INDEX; }
+
+    // Walk index 'which': number of records, rebuilding the entries from them if 'load'
+    uint16_t ReadIndex(uint8_t which, bool load) {
+        SerialFlashFile index = SerialFlashChip::open(IndexName(which));
+        if (!index) return 0;
+        FlashCacheRecord r;
+        uint16_t n = 0;
+        while ((n + 1) * sizeof(r) <= FLASH_CACHE_INDEX_SIZE) {
+            if (index.read(&r, sizeof(r)) != sizeof(r) || r.magic != FLASH_CACHE_MAGIC) break;
+            if (CRC32::Compute(&r, sizeof(r) - 4) != r.check) break;   // torn record: index ends here
+            if (load) {
+                Entry* e = Find(r.pathHash);
+                if (!r.size) { if (e) e->state = fc_removed; }
+                else if (e) e->record = n;
+                else if (nEntries_ < FLASH_CACHE_ENTRIES) {
+                    entries_[nEntries_].pathHash = r.pathHash;
+                    entries_[nEntries_].record = n;
+                    entries_[nEntries_++].state = fc_unchecked;
+                }
+            }
+            n++;
+        }
+        index.close();
+        return n;
+    }
+
+    static void EraseIndex(uint8_t which) {
+        SerialFlashFile index = SerialFlashChip::open(IndexName(which));
+        if (!index) return;
+        index.erase();
+        index.close();
+    }
+
+    // Rebuild the entries from the index. Everything starts unchecked.
+    void Load() {
+        loaded_ = true;
+        nEntries_ = 0;
+        uint16_t n0 = ReadIndex(0, false), n1 = ReadIndex(1, false);
+        index_ = n1 && (!n0 || n1 < n0);
+        // Both in use: a compaction was cut before erasing the old index. The new, shorter one is complete.
+        if (n0 && n1) EraseIndex(!index_);
+        nRecords_ = ReadIndex(index_, true);
+    }
+
+    bool ReadRecord(uint16_t n, FlashCacheRecord* r) {
+        SerialFlashFile index = SerialFlashChip::open(IndexName(index_));
+        if (!index) return false;
+        index.seek(n * sizeof(FlashCacheRecord));
+        bool ok = index.read(r, sizeof(*r)) == sizeof(*r);
+        index.close();
+        return ok;
+    }
+
+    static void Seal(FlashCacheRecord* r) {
+        r->magic = FLASH_CACHE_MAGIC;
+        r->check = CRC32::Compute(r, sizeof(*r) - 4);
+    }
+
+    // Append a record to the index, which gets compacted into the other index file when full
+    bool AppendRecord(FlashCacheRecord* r) {
+        Seal(r);
+        if (!SerialFlashChip::exists(IndexName(index_)) &&
+            !SerialFlashChip::createErasable(IndexName(index_), FLASH_CACHE_INDEX_SIZE)) return false;
+        if ((nRecords_ + 1) * sizeof(*r) > FLASH_CACHE_INDEX_SIZE && !CompactIndex()) return false;
+        SerialFlashFile index = SerialFlashChip::open(IndexName(index_));
+        if (!index) return false;
+        index.seek(nRecords_ * sizeof(*r));
+        bool ok = index.write(r, sizeof(*r)) == sizeof(*r);
+        index.close();
+        if (ok) nRecords_++;
+        return ok;
+    }
+
+    // Copy the last record of each live entry into the other index file, then erase this one.
+    // Record 0 of the new index (an empty tombstone) is written last, so a compaction cut by a
+    // reset leaves an index that reads as empty, and the old one is used.
+    bool CompactIndex() {
+        uint8_t to = index_ ^ 1;
+        if (!SerialFlashChip::exists(IndexName(to)) &&
+            !SerialFlashChip::createErasable(IndexName(to), FLASH_CACHE_INDEX_SIZE)) return false;
+        SerialFlashFile index = SerialFlashChip::open(IndexName(to));
+        if (!index) return false;
+        index.erase();
+        FlashCacheRecord r;
+        uint16_t n = 1;
+        for (uint8_t i = 0; i < nEntries_; i++) {
+            if (entries_[i].state == fc_removed) continue;
+            if (!ReadRecord(entries_[i].record, &r)) { entries_[i].state = fc_removed; continue; }
+            index.seek(n * sizeof(r));
+            index.write(&r, sizeof(r));
+            entries_[i].record = n++;
+        }
+        memset(&r, 0, sizeof(r));
+        Seal(&r);
+        index.seek(0);
+        index.write(&r, sizeof(r));
+        index.close();
+        EraseIndex(index_);
+        index_ = to;
+        nRecords_ = n;
+        return true;
+    }
+
+    // Remove an entry: tombstone in index, copy file deleted (space comes back only with "format")
+    void Remove(Entry* e) {
+        FlashCacheRecord r;
+        memset(&r, 0, sizeof(r));
+        r.pathHash = e->pathHash;
+        AppendRecord(&r);
+        char name[12];
+        CachedName(e->pathHash, name);
+        SerialFlashChip::remove(name);
+        e->state = fc_removed;
+    }
+
+    void Clear() {
+        if (copying_) Drop(false);
+        Pause();
+        checking_ = false;
+        nQueued_ = 0;
+        for (uint8_t i = 0; i < nEntries_; i++) {
+            char name[12];
+            CachedName(entries_[i].pathHash, name);
+            SerialFlashChip::remove(name);
+        }
+        EraseIndex(0);      // erasable: no space lost
+        EraseIndex(1);
+        index_ = 0;
+        nEntries_ = 0;
+        nRecords_ = 0;
+        full_ = false;
+    }
+
+    // Close the files of the running copy and check; both go on from where they are later
+    void Pause() {
+        if (!job_.open && !check_.open) return;
+        LOCK_SD(true);
+        if (job_.open) {
+            job_.src.close();
+            job_.dst.close();
+            job_.open = false;
+        }
+        if (check_.open) {
+            check_.f.close();
+            check_.open = false;
+        }
+        LOCK_SD(false);
+    }
+
+    // Start checking one unchecked entry against SD. Returns false if there's none left.
+    bool StartCheck() {
+        for (uint8_t i = 0; i < nEntries_; i++) {
+            Entry* e = entries_ + i;
+            if (e->state != fc_unchecked) continue;
+            CheckJob& c = check_;
+            if (!ReadRecord(e->record, &c.r) || c.r.pathHash != e->pathHash) { Remove(e); return true; }
+            c.r.path[FLASH_CACHE_PATH - 1] = 0;
+            c.entry = i;
+            c.crc.Reset();
+            c.headCRC.Reset();
+            c.pos = 0;
+            c.open = false;
+            checking_ = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Read one more chunk of the SD file being checked. Valid once size, head and whole file CRC match.
+    void Check() {
+        CheckJob& c = check_;
+        if (!c.open) {
+            c.f = LSFS::Open(c.r.path);
+            c.open = true;
+            if (!c.f || c.f.size() != c.r.size) { EndCheck(false); return; }
+            c.f.seek(c.pos);
+        }
+        uint8_t buffer[FLASH_CACHE_CHUNK];
+        uint32_t n = std::min<uint32_t>(c.r.size - c.pos, FLASH_CACHE_CHUNK);
+        if (!n) { EndCheck(c.crc.Value() == c.r.crc && c.headCRC.Value() == c.r.headCRC); return; }
+        if ((uint32_t)c.f.read(buffer, n) != n) { EndCheck(false); return; }
+        c.crc.Update(buffer, n);
+        if (c.pos < FLASH_CACHE_HEAD) {
+            c.headCRC.Update(buffer, std::min<uint32_t>(n, FLASH_CACHE_HEAD - c.pos));
+            // most edits show in the head: no need to read the rest
+            if (c.pos + n >= FLASH_CACHE_HEAD && c.headCRC.Value() != c.r.headCRC) { EndCheck(false); return; }
+        }
+        c.pos += n;
+    }
+
+    void EndCheck(bool valid) {
+        CheckJob& c = check_;
+        c.f.close();
+        c.open = false;
+        checking_ = false;
+        Entry* e = entries_ + c.entry;
+        if (valid) e->state = fc_valid;
+        else {
+            Remove(e);
+            Want(c.r.path);     // copy the new content
+        }
+    }
+
+    void StartCopy() {
+        CopyJob& j = job_;
+        strcpy(j.path, queue_[0]);
+        nQueued_--;
+        memmove(queue_[0], queue_[1], nQueued_ * FLASH_CACHE_PATH);
+        if (nEntries_ >= FLASH_CACHE_ENTRIES) { Reuse(); if (nEntries_ >= FLASH_CACHE_ENTRIES) { full_ = true; return; } }
+        j.hash = Hash(j.path);
+        j.src = LSFS::Open(j.path);
+        if (!j.src) return;
+        j.size = j.src.size();
+        char name[12];
+        CachedName(j.hash, name);
+        SerialFlashChip::remove(name);      // leftover of a copy cut by a reset
+        if (!SerialFlashChip::create(name, j.size)) { j.src.close(); full_ = true; return; }
+        j.dst = SerialFlashChip::open(name);
+        if (!j.dst) { j.src.close(); return; }
+        j.open = true;
+        j.crc.Reset();
+        j.headCRC.Reset();
+        j.pos = j.checked = 0;
+        copying_ = true;
+    }
+
+    // Go on with a paused copy, if its SD file is still the same size
+    bool Reopen() {
+        CopyJob& j = job_;
+        char name[12];
+        CachedName(j.hash, name);
+        j.src = LSFS::Open(j.path);
+        j.dst = SerialFlashChip::open(name);
+        j.open = true;
+        if (!j.src || !j.dst) { Drop(false); return false; }
+        if (j.src.size() != j.size) { Drop(true); return false; }
+        j.src.seek(j.checked);
+        j.dst.seek(j.pos);
+        return true;
+    }
+
+    // Drop removed entries from RAM
+    void Reuse() {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < nEntries_; i++)
+            if (entries_[i].state != fc_removed) entries_[n++] = entries_[i];
+        nEntries_ = n;
+    }
+
+    void Copy() {
+        CopyJob& j = job_;
+        if (!j.open && !Reopen()) return;
+        uint8_t buffer[FLASH_CACHE_CHUNK];
+        uint32_t n;
+        if (j.checked < j.pos) {    // after a session: the SD bytes copied so far must not have changed
+            n = std::min<uint32_t>(j.pos - j.checked, FLASH_CACHE_CHUNK);
+            if ((uint32_t)j.src.read(buffer, n) != n) { Drop(false); return; }
+            j.check.Update(buffer, n);
+            j.checked += n;
+            if (j.checked == j.pos && j.check.Value() != j.crc.Value()) Drop(true);
+            return;
+        }
+        n = std::min<uint32_t>(j.size - j.pos, FLASH_CACHE_CHUNK);
+        if (n) {
+            if ((uint32_t)j.src.read(buffer, n) != n || j.dst.write(buffer, n) != n) { Drop(false); return; }
+            j.crc.Update(buffer, n);
+            if (j.pos < FLASH_CACHE_HEAD) j.headCRC.Update(buffer, std::min<uint32_t>(n, FLASH_CACHE_HEAD - j.pos));
+            j.pos += n;
+            j.checked = j.pos;
+            return;
+        }
+        // Copied: read back and verify before listing it
+        j.src.close();
+        CRC32 check;
+        j.dst.seek(0);
+        for (uint32_t pos = 0; pos < j.size; pos += n) {
+            n = std::min<uint32_t>(j.size - pos, FLASH_CACHE_CHUNK);
+            if (j.dst.read(buffer, n) != n) break;
+            check.Update(buffer, n);
+        }
+        j.dst.close();
+        j.open = false;
+        copying_ = false;
+        char name[12];
+        CachedName(j.hash, name);
+        if (check.Value() != j.crc.Value()) { SerialFlashChip::remove(name); return; }
+        FlashCacheRecord r;
+        memset(&r, 0, sizeof(r));
+        r.pathHash = j.hash;
+        r.size = j.size;
+        r.headCRC = j.headCRC.Value();
+        r.crc = j.crc.Value();
+        strcpy(r.path, j.path);
+        if (!AppendRecord(&r)) { SerialFlashChip::remove(name); return; }
+        entries_[nEntries_].pathHash = j.hash;
+        entries_[nEntries_].record = nRecords_ - 1;
+        entries_[nEntries_++].state = fc_valid;
+    }
+
+    // The SD file changed under a copy ('retry' copies the new content) or can't be read:
+    // the partial copy can only be removed
+    void Drop(bool retry) {
+        CopyJob& j = job_;
+        if (j.open) {
+            j.src.close();
+            j.dst.close();
+            j.open = false;
+        }
+        char name[12];
+        CachedName(j.hash, name);
+        SerialFlashChip::remove(name);
+        copying_ = false;
+        if (retry) Want(j.path);
+    }
+};
+
+FlashCache flash_cache;
+
+bool FlashCacheLookup(const char* filename, char* cachedName) { return flash_cache.Lookup(filename, cachedName); }
+void FlashCacheWant(const char* filename) { flash_cache.Want(filename); }
+
+#endif // ENABLE_FLASH_CACHE
+
+#endif // COMMON_FLASH_CACHE_H
@@ -97,9 +97,15 @@ public:
 #define GYRO_STABILIZATION_TIME_MS 64
 #endif
 
+  // Motion data comes in by interrupt: run once per new sample
+  uint32_t IdleMicros() override {
+    return gyro_extrapolator_.last_time() != last_gyro_seen_ ? 0 : LOOPER_IDLE_FOREVER;
+  }
+
   void Loop() override {
     uint32_t last_accel = accel_extrapolator_.last_time();
     uint32_t last_gyro = gyro_extrapolator_.last_time();
+    last_gyro_seen_ = last_gyro;
     uint32_t now = micros();
     if (!accel_extrapolator_.ready() ||
 	!gyro_extrapolator_.ready() ||
@@ -206,7 +212,7 @@ public:
       ch1_broadcast.gyro_x100 = (int16_t)(100*gyro_extrapolator_.get().x);
       ch1_broadcast.gyro_y100 = (int16_t)(100*gyro_extrapolator_.get().y);
       ch1_broadcast.gyro_z100 = (int16_t)(100*gyro_extrapolator_.get().z);
-      STDOUT.Broadcast(1, &ch1_broadcast, sizeof(ch1_broadcast));
+      TELEMETRY_PUBLISH(tm_fusion, &ch1_broadcast, sizeof(ch1_broadcast));
   #endif // BROADCAST_MOTION
   } 
 
@@ -395,6 +401,7 @@ private:
   Vec3 down_;
   Vec3 mss_;
   uint32_t last_micros_;
+  uint32_t last_gyro_seen_ = 0;   // gyro sample time at the last Loop()
   Vec3 accel_;
   Vec3 gyro_;
   float swing_speed_;
@@ -1,71 +1,485 @@
 #ifndef FWUPD_H
 #define FWUPD_H
 
+/********************************************************************
+ *  FIRMWARE UPDATE - background staging, bounded swap at boot      *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - osx.cod (copied from storage or uploaded by the serial        *
+ *    protocol) holds the update struct and the firmware bin        *
+ *  - FwStager copies the bin to FW_STAGE_FILE one chunk per        *
+ *    Loop(), while the blade is off and no sound plays. Each chunk *
+ *    is read back and its CRC32 kept in FW_STATE_FILE, so staging  *
+ *    resumes after a reset. The whole image CRC is checked last.   *
+ *  - osx.cod's own CRC is checked FW_CHUNK bytes per Loop() too,   *
+ *    when its size or stored CRC changes; it is opened without     *
+ *    a CRC pass after that                                         *
+ *  - once verified, CheckFwUpdate() programs the image at next     *
+ *    boot. osx.cod is not opened (no CRC pass): downtime = flash   *
+ *    programming time. The update struct is marked as installed    *
+ *    in the background, once the new image runs                    *
+ *  - "fwupdate [apply|cancel]" - status / reboot into a staged     *
+ *    image / drop the staged image                                 *
+ ********************************************************************/
+
     #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
         #if HWL_CONCAT(MQUOATE, HW_PREFIX, MQUOATE) == 'L'
         #define UPDATE_FILE "_osx_/osx.cod"
+        #define FW_STAGE_FILE   "_osx_/fw.stg"  // staged image, plain binary
+        #define FW_STATE_FILE   "_osx_/fw.sta"  // FwStageHeader + chunk CRCs
+        #define FW_CHUNK        2048            // bytes staged per Loop()
+        #define FW_MAX_CHUNKS   256             // 512KB image
+        #define FW_STAGE_MAGIC  0xF57A6E01
+        #define FW_STAGE_POLL   2000            // [ms] idle time between checks of osx.cod
 
         #include "stm32l4_fwupg.h"
-        #include "CodReader.h"     // make sure that code reader is included 
+        #include "CodReader.h"     // make sure that code reader is included
 
-        bool __attribute__((optimize("O0"))) CheckFwUpdate()
+        struct fwData_t {
+            uint16_t version;       //
+            uint8_t force;          //
+            uint8_t cnt;            //
+            uint16_t binID;         //
+        } __attribute__((packed));  // install configuration
+
+        enum FwStageState : uint8_t {
+            fws_none = 0,
+            fws_copying,            // 'chunks' copied and checked
+            fws_verifying,          // all copied, whole image CRC pending
+            fws_ready,              // programmed at next boot
+            fws_programmed,         // programming started, to be confirmed by the new image
+            fws_failed              // old image still runs after programming: don't stage this bin again
+        };
+
+        struct FwStageHeader {
+            uint32_t magic;
+            uint32_t binCRC;        // CRC32 of the whole image, from the bin entry
+            uint32_t size;
+            uint32_t srcOffset;     // bin data offset in osx.cod
+            uint16_t version;       // version being staged
+            uint16_t chunks;        // chunks copied and read back
+            uint8_t state;          // FwStageState
+            uint8_t reserved[3];
+            uint32_t check;         // CRC32 of the fields above
+        } __attribute__((packed));  // followed by FW_MAX_CHUNKS chunk CRCs in FW_STATE_FILE
+
+        // Update struct and bin entry of osx.cod, if it asks for an update.
+        // checkCRC = false: the caller checked the file CRC already.
+        bool FwPendingUpdate(fwData_t* fwdata, uint32_t* binOffset = nullptr, CodEntry* bin = nullptr, bool checkCRC = true)
         {
             CodReader reader;
-            struct {
-                uint16_t version;       // 
-                uint8_t force;          // 
-                uint8_t cnt;            //
-                uint16_t binID;         //
-            } __attribute__((packed)) fwdata;   // install configuration
-
-            if (!reader.Open(UPDATE_FILE, 1))
+            if (!reader.Open(UPDATE_FILE, 0, checkCRC))
                 return false;          // file not found
-            
-            
-            if (reader.FindEntry(1) == COD_ENTYPE_STRUCT) 
+            bool pending = false;
+            if (reader.FindEntry(1) == COD_ENTYPE_STRUCT && reader.codProperties.structure.Handler == HANDLER_xUpdate
+                && reader.ReadEntry(1, (void*)fwdata, sizeof(*fwdata)) == sizeof(*fwdata)
+                && (fwdata->force || fwdata->version > atoi(OSX_SUBVERSION))
+                && reader.FindEntry(fwdata->binID) == COD_ENTYPE_BIN)
             {
-            // found a struct with the right ID
-                if (reader.codProperties.structure.Handler == HANDLER_xUpdate)
-                {
-                     uint32_t numBytes = reader.ReadEntry(1, (void*)&fwdata, sizeof(fwdata));
-                     if (numBytes != sizeof(fwdata)) 
-                     {
-                        reader.Close();
-                        return false;
-                     }
-
-                     int convVersion = atoi(OSX_SUBVERSION);
-                     if(fwdata.force || fwdata.version > convVersion)
-                     {
-                        if(fwdata.force) fwdata.force = 0;
-                        fwdata.cnt += 1;
-
-                        if(reader.FindEntry(fwdata.binID) == COD_ENTYPE_BIN)
-                        {
-                            uint32_t savedOffset, crcCalc;
-                            uint32_t dataSize;
-                            dataSize = reader.codProperties.bin.Size;
-                            savedOffset = reader.codInterpreter->currentCodOffset;
-                            // dataSize = 231062;
-                            crcCalc = reader.codInterpreter->BinCrc(savedOffset, dataSize);
-                            if(crcCalc != reader.codProperties.bin.CRC32)
-                            {   
-                                reader.Close();
-                                return false;
-                            }
-                            reader.OverwriteEntry(1, (void*)&fwdata, sizeof(fwdata));
-                            reader.Close();
-                            // TODO STOP ALL INTERRUPTS !!!!! expect SYSTICK IQR
-                            stm32l4_ll_fwpgr(UPDATE_FILE, savedOffset, dataSize);
-                            return true;
-                        }
-                    }
-                }
+                pending = true;
+                if (binOffset) *binOffset = reader.codInterpreter->currentCodOffset;
+                if (bin) *bin = reader.codProperties;
             }
             reader.Close();
-            return false;
+            return pending;
+        }
+
+        bool FwReadStageHeader(FwStageHeader* h)
+        {
+            LOCK_SD(true);
+            File f = LSFS::Open(FW_STATE_FILE);
+            bool ok = f && f.read((uint8_t*)h, sizeof(*h)) == sizeof(*h);
+            if (f) f.close();
+            LOCK_SD(false);
+            return ok && h->magic == FW_STAGE_MAGIC && h->check == CRC32::Compute(h, sizeof(*h) - 4);
         }
 
-        #endif // end of Ultra proffie LITE 
+        bool FwWriteStageHeader(FwStageHeader* h)
+        {
+            h->check = CRC32::Compute(h, sizeof(*h) - 4);
+            LOCK_SD(true);
+            File f = LSFS::OpenForOverWrite(FW_STATE_FILE);
+            bool ok = f && f.write((uint8_t*)h, sizeof(*h)) == sizeof(*h);
+            if (f) f.close();
+            LOCK_SD(false);
+            return ok;
+        }
+
+        // Program a staged image. Everything was checked while staging.
+        bool __attribute__((optimize("O0"))) CheckFwUpdate()
+        {
+            FwStageHeader h;
+            if (!FwReadStageHeader(&h) || h.state != fws_ready)
+                return false;
+            File f = LSFS::Open(FW_STAGE_FILE);
+            bool present = f && f.size() == h.size;
+            if (f) f.close();
+            h.state = fws_programmed;       // never programmed twice; the new image confirms it
+            if (!present || !FwWriteStageHeader(&h)) {
+                LSFS::Remove(FW_STATE_FILE);
+                return false;
+            }
+            // TODO STOP ALL INTERRUPTS !!!!! expect SYSTICK IQR
+            stm32l4_ll_fwpgr(FW_STAGE_FILE, 0, h.size);
+            return true;
+        }
+
+        class FwStager : Looper, CommandParser {
+        public:
+            FwStager() : Looper(), CommandParser() {
+                h_.state = fws_none;
+                idleSince_ = 0;
+                codSize_ = 0;
+                codStamp_ = 0;
+                codPos_ = 0;
+                patchOffset_ = 0;
+                badCRC_ = 0;
+                installing_ = 0;
+                busy_ = false;
+                confirmed_ = false;
+                checking_ = false;
+                valid_ = false;
+                examine_ = false;
+            }
+            const char* name() override { return "FwStager"; }
+
+        protected:
+            uint32_t IdleMicros() override {
+                if (busy_) return 0;
+                if (!LSFS::IsMounted()) return LOOPER_IDLE_FOREVER;
+                uint32_t elapsed = millis() - idleSince_;
+                return elapsed >= FW_STAGE_POLL ? 0 : (FW_STAGE_POLL - elapsed) * 1000;
+            }
+
+            void Loop() override {
+                if (SaberBase::IsOn() || !LSFS::IsMounted()) { Pause(); return; }
+            #ifdef ENABLE_AUDIO
+                if (SoundActive()) { Pause(); return; }
+            #endif
+                if (!busy_) {
+                    if (millis() - idleSince_ < FW_STAGE_POLL) return;
+                    idleSince_ = millis();
+                    if (!Resume()) return;
+                }
+                LOCK_SD(true);
+                if (checking_) CheckCod();
+                else if (h_.state == fws_copying) CopyChunk();
+                else if (h_.state == fws_verifying) VerifyChunk();
+                LOCK_SD(false);
+            }
+
+            bool Parse(const char* cmd, const char* arg) override {
+                if (strcmp(cmd, "fwupdate")) return false;
+                if (arg && !strcmp(arg, "cancel")) {
+                    Pause();
+                    FwStageHeader h;
+                    if (FwReadStageHeader(&h)) badCRC_ = h.binCRC;     // not again from this osx.cod
+                    LSFS::Remove(FW_STATE_FILE);
+                    LSFS::Remove(FW_STAGE_FILE);
+                    h_.state = fws_none;
+                    STDOUT.println("Staged firmware removed.");
+                    return true;
+                }
+                FwStageHeader h;
+                if (!FwReadStageHeader(&h)) { STDOUT.println("No firmware staged."); return true; }
+                if (arg && !strcmp(arg, "apply")) {
+                    if (h.state != fws_ready) { STDOUT.println("Firmware not staged yet."); return true; }
+                    STDOUT.println("Rebooting into the staged firmware.");
+                    Pause();
+                    delay(100);
+                    NVIC_SystemReset();
+                }
+                STDOUT.print("Firmware "); STDOUT.print(h.version); STDOUT.print(": ");
+                if (h.state == fws_ready) STDOUT.println("staged, applied at next boot");
+                else if (h.state == fws_failed) STDOUT.println("programming failed");
+                else if (h.state == fws_programmed) STDOUT.println("programmed, not confirmed yet");
+                else {
+                    STDOUT.print(h.chunks); STDOUT.print(" / "); STDOUT.print(Chunks(h.size));
+                    STDOUT.println(h.state == fws_verifying ? " chunks verified" : " chunks staged");
+                }
+                return true;
+            }
+
+            void Help() override {
+                STDOUT.println(" fwupdate [apply|cancel] - staged firmware status / reboot into it / remove it");
+            }
+
+        private:
+            FwStageHeader h_;
+            File src_, stage_, state_;
+            File cod_;              // osx.cod, while its CRC is checked
+            CRC32 imageCRC_;        // while verifying
+            CRC32 codCRC_;          // osx.cod bytes checked so far
+            CRC32 patchedCRC_;      // the same with patch_ in place
+            fwData_t patch_;        // update struct marking installing_ installed, written once codCRC_ matched
+            uint32_t idleSince_;
+            uint32_t codSize_;      // osx.cod size and stored CRC when last examined: checked again only when they change
+            uint32_t codStamp_;
+            uint32_t codPos_;       // osx.cod bytes checked
+            uint32_t patchOffset_;  // of patch_ in osx.cod, 0 = nothing to write
+            uint32_t badCRC_;       // bin CRC of an osx.cod whose bin didn't match it
+            uint16_t installing_;   // version that runs, to be marked installed in osx.cod
+            bool busy_;             // files open, staging in progress
+            bool confirmed_;        // a programmed image was looked for since boot
+            bool checking_;         // osx.cod CRC pass in progress, resumed after a pause
+            bool valid_;            // osx.cod passed its CRC check
+            bool examine_;          // osx.cod checked, not looked into yet
+            uint8_t buffer_[FW_CHUNK];  // one chunk, kept off the stack
+
+            static uint16_t Chunks(uint32_t size) { return (size + FW_CHUNK - 1) / FW_CHUNK; }
+            static uint32_t ChunkSize(uint32_t size, uint16_t n) { return std::min<uint32_t>(FW_CHUNK, size - n * FW_CHUNK); }
+
+            // Close files, progress stays in FW_STATE_FILE
+            void Pause() {
+                if (!busy_) return;
+                LOCK_SD(true);
+                if (src_) src_.close();
+                if (stage_) stage_.close();
+                if (state_) state_.close();
+                if (cod_) cod_.close();     // a CRC pass continues from codPos_
+                LOCK_SD(false);
+                busy_ = false;
+            }
+
+            // First boot after programming: count the install in osx.cod if the new image runs.
+            // That happens at the end of the CRC pass over osx.cod, see EndCheck().
+            void Confirm() {
+                FwStageHeader h;
+                if (!FwReadStageHeader(&h) || h.state != fws_programmed) return;
+                if (h.version == atoi(OSX_SUBVERSION)) {
+                    installing_ = h.version;
+                } else {
+                    h.state = fws_failed;
+                    FwWriteStageHeader(&h);
+                    LSFS::Remove(FW_STAGE_FILE);
+                    STDOUT.print("Firmware "); STDOUT.print(h.version); STDOUT.println(" programming failed");
+                }
+            }
+
+            // Find what to do: check a changed osx.cod, continue a staging in progress, start a new one or clean up.
+            bool Resume() {
+                if (!confirmed_) { confirmed_ = true; Confirm(); }
+                uint32_t size, stamp;
+                CodStamp(&size, &stamp);
+                bool changed = size != codSize_ || stamp != codStamp_;
+                if (changed) {
+                    codSize_ = size;
+                    codStamp_ = stamp;
+                    checking_ = false;      // a paused pass was for the old file
+                    valid_ = false;
+                    examine_ = true;
+                }
+                if (checking_ || installing_ || (changed && size)) return StartCheck();
+                bool staging = (h_.state == fws_copying || h_.state == fws_verifying) && h_.binCRC != badCRC_;
+                if (!examine_ && !staging) return false;
+                examine_ = false;
+                fwData_t fwdata;
+                uint32_t binOffset;
+                CodEntry bin;
+                FwStageHeader h;
+                bool staged = FwReadStageHeader(&h);
+                if (!valid_ || !FwPendingUpdate(&fwdata, &binOffset, &bin, false)) {
+                    if (!staged && LSFS::Exists(FW_STAGE_FILE)) LSFS::Remove(FW_STAGE_FILE);  // cancelled
+                    return false;
+                }
+                if (bin.bin.Size > FW_MAX_CHUNKS * FW_CHUNK) return false;    // doesn't fit the chunk table
+                if (bin.bin.CRC32 == badCRC_) return false;                     // damaged, wait for a new osx.cod
+                if (staged && h.state == fws_failed && h.binCRC == bin.bin.CRC32) return false;    // didn't program
+                bool same = staged && h.version == fwdata.version && h.binCRC == bin.bin.CRC32
+                            && h.size == bin.bin.Size && h.srcOffset == binOffset;
+                if (same && h.state == fws_ready) return false;     // waiting for a reboot
+                LOCK_SD(true);
+                src_ = LSFS::Open(UPDATE_FILE);
+                if (same) {
+                    state_ = LSFS::OpenForOverWrite(FW_STATE_FILE);
+                    stage_ = LSFS::OpenForOverWrite(FW_STAGE_FILE);
+                    same = state_ && stage_;
+                }
+                if (same) {
+                    h_ = h;
+                    if (h_.chunks && !CheckChunk(h_.chunks - 1, ChunkCRC(h_.chunks - 1))) h_.chunks--;     // last chunk may be torn
+                    if (h_.state == fws_verifying) { h_.chunks = 0; imageCRC_.Reset(); }
+                } else {
+                    if (state_) state_.close();
+                    if (stage_) stage_.close();
+                    h_.magic = FW_STAGE_MAGIC;
+                    h_.binCRC = bin.bin.CRC32;
+                    h_.size = bin.bin.Size;
+                    h_.srcOffset = binOffset;
+                    h_.version = fwdata.version;
+                    h_.chunks = 0;
+                    h_.state = fws_copying;
+                    memset(h_.reserved, 0, sizeof(h_.reserved));
+                    state_ = LSFS::OpenForWrite(FW_STATE_FILE);
+                    stage_ = LSFS::OpenForWrite(FW_STAGE_FILE);
+                    SaveHeader();
+                }
+                busy_ = src_ && stage_ && state_;
+                LOCK_SD(false);
+                if (!busy_) { busy_ = true; Pause(); return false; }
+                STDOUT.print("Staging firmware "); STDOUT.println(h_.version);
+                return true;
+            }
+
+            void SaveHeader() {
+                if (!state_) return;
+                h_.check = CRC32::Compute(&h_, sizeof(h_) - 4);
+                state_.seek(0);
+                state_.write((uint8_t*)&h_, sizeof(h_));
+                state_.flush();
+            }
+
+            // osx.cod size and stored CRC (its last 4 bytes), to tell when it changed
+            void CodStamp(uint32_t* size, uint32_t* stamp) {
+                LOCK_SD(true);
+                File f = LSFS::Open(UPDATE_FILE);
+                *size = f ? f.size() : 0;
+                *stamp = 0;
+                if (*size >= 4 && f.seek(*size - 4)) f.read((uint8_t*)stamp, 4);
+                if (f) f.close();
+                LOCK_SD(false);
+            }
+
+            // Offset of the update struct in osx.cod, with 'force' cleared and the install
+            // counted in patch_, once installing_ runs. 0 if it doesn't ask for that version.
+            // Read without a CRC pass: nothing is written unless the pass that follows matches.
+            uint32_t InstalledPatch() {
+                CodReader reader;
+                if (!reader.Open(UPDATE_FILE, 0, false)) return 0;
+                uint32_t offset = 0;
+                if (reader.FindEntry(1) == COD_ENTYPE_STRUCT && reader.codProperties.structure.Handler == HANDLER_xUpdate) {
+                    offset = reader.codInterpreter->currentCodOffset;
+                    if (reader.ReadEntry(1, (void*)&patch_, sizeof(patch_)) != sizeof(patch_)
+                        || !patch_.force || patch_.version != installing_) offset = 0;
+                }
+                reader.Close();
+                patch_.force = 0;
+                patch_.cnt += 1;
+                return offset;
+            }
+
+            // Open osx.cod for its CRC pass: from the start, or where a paused pass stopped
+            bool StartCheck() {
+                if (!checking_) {
+                    checking_ = true;
+                    codPos_ = 0;
+                    codCRC_.Reset();
+                    patchedCRC_.Reset();
+                    patchOffset_ = installing_ ? InstalledPatch() : 0;
+                }
+                LOCK_SD(true);
+                if (codSize_ >= 8 && !(codSize_ & 3))
+                    cod_ = patchOffset_ ? LSFS::OpenForOverWrite(UPDATE_FILE) : LSFS::Open(UPDATE_FILE);
+                if (cod_) busy_ = true;
+                else EndCheck(false);
+                LOCK_SD(false);
+                return busy_;
+            }
+
+            // One chunk of the CRC pass: the whole file but its last 4 bytes, the stored CRC
+            void CheckCod() {
+                uint32_t end = codSize_ - 4;
+                uint32_t size = std::min<uint32_t>(FW_CHUNK, end - codPos_);
+                if (!cod_.seek(codPos_) || (uint32_t)cod_.read(buffer_, size) != size) { EndCheck(false); return; }
+                if (!codPos_ && !memcmp(buffer_, "cod_v01", COD_HEADER_LEN)) { EndCheck(true, false); return; }     // no CRC
+                codCRC_.Update(buffer_, size);
+                if (patchOffset_) {
+                    for (uint32_t i = 0; i < sizeof(patch_); i++)
+                        if (patchOffset_ + i >= codPos_ && patchOffset_ + i < codPos_ + size)
+                            buffer_[patchOffset_ + i - codPos_] = ((uint8_t*)&patch_)[i];
+                    patchedCRC_.Update(buffer_, size);
+                }
+                codPos_ += size;
+                if (codPos_ < end) return;
+                uint32_t stored = 0;
+                EndCheck(cod_.read((uint8_t*)&stored, 4) == 4 && stored == codCRC_.Value());
+            }
+
+            // CRC pass done, SD locked. A matching osx.cod gets patch_ and its new CRC, if any,
+            // and is used without another pass until it changes.
+            void EndCheck(bool ok, bool hasCRC = true) {
+                if (ok && patchOffset_) {
+                    uint32_t crc = patchedCRC_.Value();
+                    ok = cod_.seek(patchOffset_) && cod_.write((uint8_t*)&patch_, sizeof(patch_)) == sizeof(patch_)
+                         && (!hasCRC || (cod_.seek(codSize_ - 4) && cod_.write((uint8_t*)&crc, 4) == 4));
+                    if (ok && hasCRC) codStamp_ = crc;      // our own change: no new pass
+                }
+                if (cod_) cod_.close();
+                checking_ = false;
+                busy_ = false;
+                valid_ = ok;
+                idleSince_ = millis() - FW_STAGE_POLL;      // look into it at the next Loop()
+                if (!installing_) return;
+                LSFS::Remove(FW_STATE_FILE);
+                LSFS::Remove(FW_STAGE_FILE);
+                STDOUT.print("Firmware "); STDOUT.print(installing_); STDOUT.println(" installed");
+                installing_ = 0;
+                patchOffset_ = 0;
+            }
+
+            // CRC of a staged chunk, as saved after it was read back
+            uint32_t ChunkCRC(uint16_t n) {
+                uint32_t crc = 0;
+                if (!state_.seek(sizeof(h_) + n * 4) || state_.read((uint8_t*)&crc, 4) != 4) return ~h_.binCRC;
+                return crc;
+            }
+
+            // Read back a staged chunk
+            bool CheckChunk(uint16_t n, uint32_t crc) {
+                uint32_t size = ChunkSize(h_.size, n);
+                if (!stage_.seek(n * FW_CHUNK) || (uint32_t)stage_.read(buffer_, size) != size) return false;
+                return CRC32::Compute(buffer_, size) == crc;
+            }
+
+            void CopyChunk() {
+                uint16_t n = h_.chunks;
+                uint32_t size = ChunkSize(h_.size, n);
+                if (!src_.seek(h_.srcOffset + n * FW_CHUNK) || (uint32_t)src_.read(buffer_, size) != size) { Pause(); return; }
+                uint32_t crc = CRC32::Compute(buffer_, size);
+                stage_.seek(n * FW_CHUNK);
+                stage_.write(buffer_, size);
+                stage_.flush();
+                if (!CheckChunk(n, crc)) return;    // write again next time
+                state_.seek(sizeof(h_) + n * 4);
+                state_.write((uint8_t*)&crc, 4);
+                h_.chunks++;
+                if (h_.chunks == Chunks(h_.size)) {
+                    h_.state = fws_verifying;
+                    h_.chunks = 0;
+                    imageCRC_.Reset();
+                }
+                SaveHeader();
+            }
+
+            // Whole image CRC, as the bin entry has it. Progress isn't saved: a reset restarts this pass.
+            void VerifyChunk() {
+                uint16_t n = h_.chunks;
+                uint32_t size = ChunkSize(h_.size, n);
+                if (!stage_.seek(n * FW_CHUNK) || (uint32_t)stage_.read(buffer_, size) != size
+                    || CRC32::Compute(buffer_, size) != ChunkCRC(n)) {
+                    h_.state = fws_copying;     // damaged since copied: copy it again
+                    h_.chunks = n;
+                    SaveHeader();
+                    return;
+                }
+                imageCRC_.Update(buffer_, size);
+                if (++h_.chunks < Chunks(h_.size)) return;
+                if (imageCRC_.Value() == h_.binCRC) {
+                    h_.state = fws_ready;
+                    STDOUT.print("Firmware "); STDOUT.print(h_.version); STDOUT.println(" staged, applied at next boot");
+                } else {
+                    h_.state = fws_copying;     // source doesn't match its own CRC
+                    h_.chunks = 0;
+                    badCRC_ = h_.binCRC;
+                    STDOUT.println("Firmware update failed, waiting for a new " UPDATE_FILE);
+                }
+                SaveHeader();
+                Pause();
+            }
+        };
+
+        FwStager fwStager;
+
+        #endif // end of Ultra proffie LITE
     #endif // end of ULTRAPROFFIE
-#endif
\ No newline at end of file
+#endif
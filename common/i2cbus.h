@@ -40,6 +40,13 @@ public:
     return !((last_request_millis_ + shtimeMS - millis()) >> 31);
   }
 
+  // Bring the bus up right away for a new user, wake up when it's due to be
+  // released, then wait for the next user
+  uint32_t IdleMicros() override {
+    if (used()) return i2c_detected_ ? (last_request_millis_ + shtimeMS - millis() + 1) * 1000 : 0;
+    return i2c_detected_ ? 0 : LOOPER_IDLE_FOREVER;
+  }
+
 
   void scheduledDeinitTime(uint32_t ms) {
     shtimeMS = ms;
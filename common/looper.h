@@ -5,6 +5,12 @@
 // function. Also provides a Setup() function.
 class Looper;
 Looper* loopers = NULL;
+
+// Idle hints, see Looper::IdleMicros()
+#ifndef LOOPER_IDLE_POLL
+#define LOOPER_IDLE_POLL    1000        // [us] continuous loopers are fine running this often while idle
+#endif
+#define LOOPER_IDLE_FOREVER 0xFFFFFFFF  // nothing to do until an interrupt
 Looper* hf_loopers = NULL;
 class Looper {
 public:
@@ -34,10 +40,15 @@ public:
   ~Looper() { Unlink(); }
   static void DoLoop() {
     uint32_t microsNow = micros();       // current time;
-    for (Looper *l = loopers; l; l = l->next_looper_) {
+    uint8_t pos = 0;                     // position in list, for trace
+    for (Looper *l = loopers; l; l = l->next_looper_, pos++) {
       if (microsNow - l->cpu_probe_.micros >= l->scheduled_time_) {
+        TRACE(trc_looper, tr_looper, pos);
+        {
         ScopedCycleCounter cc(l->cpu_probe_);     // updates .cpu_probe_.micros (and CPU probe if enabled)
         l->Loop();                                // run .Loop() for this task
+        }
+        TRACE(trc_looper, tr_looper | tr_end, pos);
         microsNow = micros();                     // update current loop time (changed if .Loop() run)
       }
     }
@@ -46,6 +57,31 @@ public:
 
   }
   
+  // Looper names in list order, as referenced by trace records: u8 count | (u8 len | name)*
+  static void DumpNames(Print& out) {
+    uint8_t n = 0;
+    for (Looper *l = loopers; l; l = l->next_looper_) n++;
+    out.write(n);
+    for (Looper *l = loopers; l; l = l->next_looper_) {
+      uint8_t len = strlen(l->name());
+      out.write(len);
+      out.write((const uint8_t*)l->name(), len);
+    }
+  }
+
+  // Earliest deadline of all loopers, in micros from now. 0 = someone is busy.
+  static uint32_t DoIdleMicros() {
+    uint32_t idle = LOOPER_IDLE_FOREVER;
+    for (Looper *l = loopers; l; l = l->next_looper_) {
+      uint32_t t = l->IdleMicros();
+      if (t < idle) {
+        idle = t;
+        if (!idle) break;
+      }
+    }
+    return idle;
+  }
+
   static void DoSetup() {
     for (Looper *l = loopers; l; l = l->next_looper_) {
       l->Setup();
@@ -55,6 +91,12 @@ public:
     for (Looper *l = loopers; l; l = l->next_looper_) 
       if (what==DoWhatToProbe::reset_probe)
         l->cpu_probe_.Reset();        
+#ifdef X_PROBECPU
+      else if (what==DoWhatToProbe::dump_probe)
+        l->cpu_probe_.Dump(l->name());
+      else if (what==DoWhatToProbe::reset_window)
+        l->cpu_probe_.ResetWindow();
+#endif
       else {
         l->cpu_probe_.Print(what);    
         STDOUT.print(" ");        
@@ -65,6 +107,17 @@ protected:
   virtual const char* name() = 0;
   virtual void Loop() = 0;
   virtual void Setup() {}
+  // How long this looper can wait before it must run again, in micros.
+  // Periodic loopers: time to their next slot. Others default to
+  // LOOPER_IDLE_POLL; override to return 0 while busy, or up to
+  // LOOPER_IDLE_FOREVER when only an interrupt can bring new work.
+  // The idle sleep is only as long as the shortest hint: a looper left on
+  // the default keeps the CPU waking every LOOPER_IDLE_POLL.
+  virtual uint32_t IdleMicros() {
+    if (!scheduled_time_) return LOOPER_IDLE_POLL;
+    uint32_t elapsed = micros() - cpu_probe_.micros;
+    return elapsed >= scheduled_time_ ? 0 : scheduled_time_ - elapsed;
+  }
 private:
   CPUprobe cpu_probe_;        // X_PROBECPU defined: monitors execution time, call frequency and cpu usage
   uint32_t scheduled_time_; // call period, in microsecond. .Loop() will be called on time intervals >= scheduled_time_
@@ -24,6 +24,110 @@
 #define DEFAULT_FONT "Luke ROTJ"
 
 
+// Directories in the storage root, so font checks look names up in RAM instead of
+// asking the file system once per preset (hash to find, name to confirm). The
+// listing is taken again after Invalidate() (new presets load, storage unmounted);
+// its signature (CRC32 of the names) tells whether the fallback font found by the
+// hum scan is still good.
+class FontCache {
+public:
+    void Invalidate() { valid_ = false; }
+
+    // Same as LSFS::Exists() for a directory in the root
+    bool Exists(const char* dir) {
+        if (strchr(dir, '/') || !Refresh()) return LSFS::Exists(dir);
+        uint32_t h = Hash(dir);
+        uint16_t lo = 0, hi = dirs_.size();
+        while (lo < hi) {   // binary search, dirs_ is sorted
+            uint16_t mid = (lo + hi) / 2;
+            if (dirs_[mid].hash < h) lo = mid + 1;
+            else hi = mid;
+        }
+        for (; lo < dirs_.size() && dirs_[lo].hash == h; lo++)      // the hash only narrows it down
+            if (!strcasecmp(names_.data() + dirs_[lo].name, dir)) return true;
+        return false;
+    }
+
+    // First directory in the root with a hum file, "" if none
+    const char* AnyFont() {
+        if (!Refresh() || scanned_) return anyFont_;
+        for (LSFS::Iterator iter("/"); iter; ++iter) {
+            if (iter.isdir()) {
+                char fname[128];
+                strcpy(fname, iter.name());
+                strcat(fname, "/");
+                char* fend = fname + strlen(fname);
+                bool isfont = false;
+                strcpy(fend, "hum.wav");
+                isfont = LSFS::Exists(fname);
+                if (!isfont) {
+                    strcpy(fend, "hum01.wav");
+                    isfont = LSFS::Exists(fname);
+                }
+                if (!isfont) {
+                    strcpy(fend, "hum1.wav");
+                    isfont = LSFS::Exists(fname);
+                }
+                if (isfont && strlen(iter.name()) < sizeof(anyFont_)) {
+                    strcpy(anyFont_, iter.name());
+                    break;                                
+                }
+            }
+        }
+        scanned_ = true;
+        return anyFont_;
+    }
+
+private:
+    bool Refresh() {
+        if (valid_) return true;
+        if (!LSFS::IsMounted()) return false;
+        dirs_.clear();
+        names_.clear();
+        CRC32 crc;
+        for (LSFS::Iterator iter("/"); iter; ++iter) {
+            if (!iter.isdir()) continue;
+            uint16_t len = strlen(iter.name()) + 1;
+            crc.Update(iter.name(), len);
+            Dir d = { Hash(iter.name()), (uint16_t)names_.size() };
+            names_.insert(names_.end(), iter.name(), iter.name() + len);
+            uint16_t i = dirs_.size();      // insertion sort, few entries
+            dirs_.push_back(d);
+            for (; i && dirs_[i-1].hash > d.hash; i--) dirs_[i] = dirs_[i-1];
+            dirs_[i] = d;
+        }
+        uint32_t signature = crc.Value();
+        if (signature != signature_) {      // root changed: look for a fallback font again when needed
+            signature_ = signature;
+            scanned_ = false;
+            anyFont_[0] = 0;
+        }
+        valid_ = true;
+        return true;
+    }
+
+    // FNV-1a of the lower case name: the file system ignores case
+    static uint32_t Hash(const char* name) {
+        uint32_t h = 2166136261;
+        for (; *name; name++) h = (h ^ (uint8_t)tolower(*name)) * 16777619;
+        return h;
+    }
+
+    struct Dir {
+        uint32_t hash;
+        uint16_t name;          // offset in names_
+    };
+    vector<Dir> dirs_;          // sorted by hash
+    vector<char> names_;        // directory names, 0-terminated, one after another
+    uint32_t signature_ = 0;
+    bool valid_ = false;
+    bool scanned_ = false;      // AnyFont() looked for a font with this signature
+    char anyFont_[16] = "";
+};
+
+FontCache fontCache;
+
+
 
 
 class Preset{ 
@@ -35,6 +139,9 @@ public:
     char track[22];
     uint32_t variation; // uint32 for no reason
     StyleDescriptor* bladeStyle[NUM_BLADES];
+    bool checked;       // CheckSounds() done
+    bool loaded;        // track checked, see Load()
+    uint32_t offset;    // data offset in PRESETS_FILE, 0 = not indexed
 
     Preset() {     // default constructor
         id = 0;
@@ -45,6 +152,9 @@ public:
         variation = 0;
         for (uint8_t i=0; i<NUM_BLADES; i++)
             bladeStyle[i] = 0;
+        checked = false;
+        loaded = false;
+        offset = 0;
     }    
 
     Preset(uint16_t id_) {  // id constructor
@@ -95,6 +205,7 @@ public:
             return false;
         }
 
+        loaded = true;
         return true;
     }
 
@@ -123,6 +234,41 @@ public:
 
         // STDOUT.print("Preset "); STDOUT.print(id); STDOUT.print(" = ");
         // Print();
+        loaded = true;
+        return true;
+    }
+
+    // Index entry: the preset as read, with its styles assigned (cheap, and reports bad
+    // styles at boot), but nothing checked on SD yet. File is already open.
+    bool ReadIndex(CodReader* file, uint16_t ID) {
+        presetData_t presetData;
+        if (file->FindEntry(ID) != COD_ENTYPE_STRUCT) return false;  // wrong entry type
+        if (file->codProperties.structure.Handler != HANDLER_Preset) return false;   // wrong handler
+        if (file->codInterpreter->entryDataSize != sizeof(presetData_t)) return false;
+        uint32_t dataOffset = file->codInterpreter->currentCodOffset;
+        if (file->ReadAt(dataOffset, &presetData, sizeof(presetData)) != sizeof(presetData)) return false;
+        memcpy(name, presetData.name, sizeof(name));
+        name[sizeof(name)-1] = 0;
+        memcpy(font, presetData.font, sizeof(font));
+        font[sizeof(font)-1] = 0;
+        memcpy(track, presetData.track, sizeof(track));
+        track[sizeof(track)-1] = 0;
+        id = ID;
+        variation = 0;      // variation is user-profile-data, not preset-data. 
+        offset = 0;
+        loaded = false;
+        if (!AssignStylesToBlades(&presetData)) return false;
+        offset = dataOffset;
+        return true;
+    }
+
+    // First use of an indexed preset: check its track. Returns false if it can't be used.
+    // See ReindexPresets() for a PRESETS_FILE replaced since it was indexed.
+    bool Load() {
+        if (loaded) return true;
+        if (!offset) return false;
+        loaded = true;
+        CheckTrack();
         return true;
     }
 
@@ -218,14 +364,13 @@ public:
         return true;    // all the errors above are non-critical if at least the default style could be assigned
     }
 
-    char default_font[16] = "";
-
     // Check track and font, replace with defaults if fails
     bool CheckSounds() {
+        checked = true;
         bool success = true;        // assume success
         // 1. Check font
-        if (!LSFS::Exists(font)) { // font does not exist, attempt to use default
-            if (LSFS::Exists(DEFAULT_FONT)) {  // default font exists: warning
+        if (!fontCache.Exists(font)) { // font does not exist, attempt to use default
+            if (fontCache.Exists(DEFAULT_FONT)) {  // default font exists: warning
                 #if defined(DIAGNOSE_BOOT) && ULTRAPROFFIE_VERSION != 'Z'
                     STDOUT.println();
                     STDOUT.print(">>>>>>>>>> WARNING: Invalid font '"); STDOUT.print(font);
@@ -236,31 +381,7 @@ public:
                 // STDOUT.print(font); STDOUT.println("' - will use default.");
             }
             else { // default font does not exist: assign ANY font
-                if (!default_font[0]) { // scan for a valid font if didn't do this already                
-                    for (LSFS::Iterator iter("/"); iter; ++iter) {
-                        if (iter.isdir()) {
-                            char fname[128];
-                            strcpy(fname, iter.name());
-                            strcat(fname, "/");
-                            char* fend = fname + strlen(fname);
-                            bool isfont = false;
-                            strcpy(fend, "hum.wav");
-                            isfont = LSFS::Exists(fname);
-                            if (!isfont) {
-                                strcpy(fend, "hum01.wav");
-                                isfont = LSFS::Exists(fname);
-                            }
-                            if (!isfont) {
-                                strcpy(fend, "hum1.wav");
-                                isfont = LSFS::Exists(fname);
-                            }
-                            if (isfont) {
-                                strcpy(default_font, iter.name());
-                                break;                                
-                            }
-                        }
-                    }
-                }
+                const char* default_font = fontCache.AnyFont();     // scanned once per storage signature
                 if (default_font[0]) {    // asign dynamic default
                     #if defined(DIAGNOSE_BOOT) && ULTRAPROFFIE_VERSION != 'Z'
                         STDOUT.println();
@@ -281,7 +402,14 @@ public:
 
             }
         }
-        // 2. Check track (if specified)
+        // 2. Check track (if specified). Not read yet if not loaded, Load() will check it.
+        CheckTrack();
+
+        return success;
+    }
+
+    // Drop the track if it doesn't exist
+    void CheckTrack() {
         if (track[0])
             if (!LSFS::Exists(track)) { 
                 // STDOUT.print("Preset "); STDOUT.print(name); STDOUT.print(" references invalid track '"); 
@@ -293,9 +421,6 @@ public:
                 strcpy(track, "");
                 // success = false;
             }
-       
-
-        return success;
     }
 
     void Print() {
@@ -319,13 +444,69 @@ public:
 };
 
 extern vector<Preset> presets;
+uint8_t presetsUnchecked = 0;   // presets loaded with deferred checks, see CheckNextPreset()
+uint32_t presetsFileSize = 0;   // PRESETS_FILE when the presets were indexed, see PresetsFileStamp()
+uint32_t presetsFileCRC = 0;
+
+// Size and stored CRC (last 4 bytes) of the open PRESETS_FILE: any rewrite changes them
+void PresetsFileStamp(CodReader* reader, uint32_t* size, uint32_t* crc) {
+    *size = reader->file.size();
+    *crc = 0;
+    if (*size >= 4) reader->ReadAt(*size - 4, crc, 4);
+}
+
+// PRESETS_FILE replaced since the presets were indexed (app upload, serial write):
+// index them again by ID. Names or fonts may have changed, so their sounds get checked
+// again by CheckNextPreset(). Returns true if the file had changed.
+bool ReindexPresets() {
+    if (!presets.size()) return false;
+    CodReader reader;
+    if (!reader.Open(PRESETS_FILE)) return false;
+    uint32_t size, crc;
+    PresetsFileStamp(&reader, &size, &crc);
+    if (size == presetsFileSize && crc == presetsFileCRC) {
+        reader.Close();
+        return false;
+    }
+    #ifdef DIAGNOSE_PRESETS
+        STDOUT.println("Presets file changed, indexing presets again.");
+    #endif
+    for (Preset& p : presets) {
+        uint32_t variation = p.variation;
+        if (!p.ReadIndex(&reader, p.id)) p.offset = 0;      // Load() fails, the preset gets dropped
+        p.variation = variation;
+        if (p.checked) {
+            p.checked = false;
+            presetsUnchecked++;
+        }
+    }
+    reader.Close();
+    presetsFileSize = size;
+    presetsFileCRC = crc;
+    return true;
+}
+
+// Check how many fonts are active
+void UpdateMonoFont() {
+    SaberBase::monoFont = true;
+    if (presets.size()>1)
+        for (uint8_t i=1; i<presets.size(); i++) 
+            if (strcmp(presets[0].font, presets[i].font)) {
+                SaberBase::monoFont = false;
+                break;
+            }           
+    // STDOUT.print(" MONO-FONT = "); STDOUT.println(SaberBase::monoFont);
+}
 
 // Read list of active presets from profile.cod and populate the 'presets' vector
 // __attribute__((optimize("Og")))
-bool LoadActivePresets(const char* filename, uint16_t ID) {
+// deferChecks: only check the sounds of the current preset (userProfile.preset), leave the others to CheckNextPreset()
+bool LoadActivePresets(const char* filename, uint16_t ID, bool deferChecks = false) {
     // 0. Clear previous presets table
     presets.resize(0);                                          
     presets.shrink_to_fit();
+    presetsUnchecked = 0;
+    fontCache.Invalidate();     // list the fonts again
     // 1. Find active presets table
     #ifdef DIAGNOSE_BOOT
         STDOUT.print("* Loading active presets table from "); STDOUT.print(filename); 
@@ -377,7 +558,9 @@ bool LoadActivePresets(const char* filename, uint16_t ID) {
     #ifdef DIAGNOSE_BOOT
         STDOUT.println();
     #endif
+    PresetsFileStamp(&reader, &presetsFileSize, &presetsFileCRC);
     uint16_t presetID, presetVar;
+    uint8_t current = userProfile.preset ? userProfile.preset-1 : 0;    // table index of the current preset
     for (uint8_t i=0; i<reader.codProperties.table.Columns; i++) {
         success = true;     // assume success
         presetID = *(apData.data() + i);
@@ -386,16 +569,22 @@ bool LoadActivePresets(const char* filename, uint16_t ID) {
             STDOUT.print("... Loading preset #"); STDOUT.print(i+1); STDOUT.print(", ID = "); 
             STDOUT.print(presetID); STDOUT.print(" ... ");
         #endif
-        // 4.1 Read preset in the new element and check validity
+        // 4.1 Index preset in the new element and check validity. Its track is checked when the preset is selected.
         presets.emplace_back();   // Add new element at the end of the vector, assuming preset will be successfully assigned
-        if (presets.back().FastRead(&reader, presetID)) {
+        if (presets.back().ReadIndex(&reader, presetID)) {
             // 4.2 Set variation
             presets.back().variation = presetVar;
             // presets.back().Print();
             // 4.3 Check validity and fix is possible
-            if (!presets.back().CheckSounds()) {
+            if (deferChecks && i != current) {
+                presetsUnchecked++;
+                #ifdef DIAGNOSE_BOOT
+                    STDOUT.print("check deferred. Preset name: '"); STDOUT.print(presets.back().name); STDOUT.println("'.");
+                #endif
+            } else if (!presets.back().CheckSounds()) {
                 success = false; // mark we found at least one error
                 presets.pop_back(); // delete newly added preset
+                if (i == current) current++;    // deferred checks: the next one must be good to start with
                 // #ifdef DIAGNOSE_BOOT
                 //     STDOUT.println("Failed, invalid preset."); 
                 // #endif
@@ -403,15 +592,16 @@ bool LoadActivePresets(const char* filename, uint16_t ID) {
                 #ifdef DIAGNOSE_BOOT
                     STDOUT.print("Color variation: "); STDOUT.print(presets.back().variation);
                     STDOUT.print(". Font: "); STDOUT.print(presets.back().font);
-                    STDOUT.print(". Track: "); STDOUT.print(presets.back().track);                
                     STDOUT.print(". Preset name: '"); STDOUT.print(presets.back().name);
                     STDOUT.println("'.");
                 #endif
+                if (deferChecks) userProfile.preset = presets.size();   // position after the presets dropped so far
             }
         }
         else { // failed, delete newly created vector element
             success = false;        // mark we found at least one error
             presets.pop_back();     // delete newly added preset
+            if (i == current) current++;
             // #ifdef DIAGNOSE_BOOT
             //     STDOUT.println("Failed, preset not found."); 
             // #endif
@@ -419,16 +609,7 @@ bool LoadActivePresets(const char* filename, uint16_t ID) {
     }
     
     reader.Close();
-    
-    // Check how many fonts are active
-    SaberBase::monoFont = true;
-    if (presets.size()>1)
-        for (uint8_t i=1; i<presets.size(); i++) 
-            if (strcmp(presets[0].font, presets[i].font)) {
-                SaberBase::monoFont = false;
-                break;
-            }           
-    // STDOUT.print(" MONO-FONT = "); STDOUT.println(SaberBase::monoFont);
+    UpdateMonoFont();
 
     // #ifdef DIAGNOSE_BOOT
     // #endif
@@ -440,6 +621,3 @@ bool LoadActivePresets(const char* filename, uint16_t ID) {
 
 
 #endif // XPRESET_H
-
-
-
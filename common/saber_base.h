@@ -236,6 +236,7 @@ public:
 #define SABERFUN(NAME, EFFECT, TYPED_ARGS, ARGS)		\
 public:                                                         \
   static void Do##NAME TYPED_ARGS {                             \
+    TRACE(trc_saber, tr_##NAME, EFFECT);                        \
     ClearSoundInfo();				                \
     CHECK_LL(SaberBase, saberbases, next_saber_);               \
     for (SaberBase *p = saberbases; p; p = p->next_saber_) {    \
@@ -245,6 +246,7 @@ public:                                                         \
       p->SB_##NAME##2 ARGS;                                     \
     }                                                           \
     CHECK_LL(SaberBase, saberbases, next_saber_);               \
+    TRACE(trc_saber, tr_##NAME | tr_end, EFFECT);               \
   }                                                             \
                                                                 \
   virtual void SB_##NAME TYPED_ARGS {}                          \
@@ -263,6 +265,7 @@ public:                                                         \
   SABERBASEFUNCTIONS();
 
   static void DoEffect(EffectType e, float location, int N) {
+    TRACE(trc_saber, tr_Effect, e);
     sound_length = 0.0;
     sound_number = N;
     CHECK_LL(SaberBase, saberbases, next_saber_);
@@ -273,6 +276,7 @@ public:                                                         \
       p->SB_Effect2(e, location);
     }
     CHECK_LL(SaberBase, saberbases, next_saber_);
+    TRACE(trc_saber, tr_Effect | tr_end, e);
   }
   static void DoEffectR(EffectType e) { DoEffect(e, (200 + random(700))/1000.0f); }
   static void DoBlast() { DoEffectR(EFFECT_BLAST); }
@@ -16,12 +16,24 @@
  #elif defined(ARDUINO_ARCH_ESP32) // ESP architecture
   #define STORAGE_RES "SD Card"
  #endif
-// Unmount sdcard when we don't need it anymore.
+// Mount the sdcard in the background when needed (or requested) and unmount
+// it when we don't need it anymore.
+
+#ifndef SDCARD_MOUNT_BACKOFF_MIN
+#define SDCARD_MOUNT_BACKOFF_MIN  20      // ms, first retry after a failed mount
+#endif
+#ifndef SDCARD_MOUNT_BACKOFF_MAX
+#define SDCARD_MOUNT_BACKOFF_MAX  2000    // ms, retry period when the card stays missing
+#endif
+#ifndef SDCARD_MOUNT_TIMEOUT
+#define SDCARD_MOUNT_TIMEOUT      1000    // ms, a Mount() request fails if not mounted by then
+#endif
+#define SDCARD_MOUNT_WAITERS      4       // WhenMounted() callbacks
 
 #ifdef ULTRAPROFFIE
-class SDCard : Looper , PowerSubscriber {
+class SDCard : Looper, StateMachine, PowerSubscriber {
 #else 
-class SDCard : Looper {
+class SDCard : Looper, StateMachine {
 #endif
 public:
   
@@ -43,14 +55,31 @@ public:
     
     bool Active() {
       // if (amplifier.Active() || AudioStreamWork::sd_is_locked() || AudioStreamWork::SDActive()) return true;
+    #ifdef ENABLE_FLASH_CACHE
+      if (SoundFromSD() || AudioStreamWork::sd_is_locked() || AudioStreamWork::SDActive()) return true;
+    #else
       if (SoundActive() || AudioStreamWork::sd_is_locked() || AudioStreamWork::SDActive()) return true;
+    #endif
       // TODO add define here
       #ifdef OSX_ENABLE_MTP 
       if (Serial_Protocol<SerialAdapter>::GetSession()) return true;
       #endif
       if (SaberBase::IsOn()) return true;
+      if (millis() - warm_start_ < warm_time_) return true;    // warmed up for an expected action
       return false;
     }
+
+    // Domain warmed up by PowerManager::Anticipate(): mount now, in the background,
+    // so the action that follows doesn't wait for the card. A longer window still running is kept.
+    void Anticipate_Callback(uint32_t timeout) override {
+      uint32_t now = millis();
+      uint32_t left = now - warm_start_ < warm_time_ ? warm_time_ - (now - warm_start_) : 0;
+      if (timeout > left) {
+        warm_start_ = now;
+        warm_time_ = timeout;
+      }
+      Kick();     // don't wait for the next mount attempt
+    }
   #else 
     bool Active() {
     #ifdef ENABLE_AUDIO    
@@ -74,6 +103,10 @@ public:
 
   
 
+  // Request the storage. Never waits for the card: mounts right away if the
+  // device is free, otherwise leaves it to the mount state machine in Loop(),
+  // which retries with exponential back-off. The request completes when the
+  // card is mounted or after SDCARD_MOUNT_TIMEOUT; see Pending() and WhenMounted().
   void Mount() {
     #ifdef ULTRAPROFFIE
       uint32_t mountTimeout = PWRMAN_SDMOUNTTIMEOUT;
@@ -81,31 +114,51 @@ public:
     #endif    
     last_enabled_ = millis();
     if (LSFS::IsMounted()) return;
+    if (!request_) Kick();      // new request: retry now, from the shortest back-off
+    request_ = true;
+    request_start_ = millis();
+    if (LSFS::CanMount()) TryMount();
+  }
 
-    // Wait for card to become available, up to 1000ms
+  // Blocking mount, for code that opens files right after LOCK_SD(true):
+  // waits up to SDCARD_MOUNT_TIMEOUT for the device to become free, as Mount()
+  // used to. Returns true if mounted.
+  bool MountSync() {
+    Mount();
     uint32_t start = millis();
-    while (!LSFS::CanMount() && millis() - start < 1000)
+    while (!LSFS::IsMounted() && millis() - start < SDCARD_MOUNT_TIMEOUT) {
+      if (LSFS::CanMount()) {
+        TryMount();
+        break;
+      }
       #ifdef ARDUINO_ARCH_ESP32   // ESP architecture
       yield();
       #else
       armv7m_core_yield();
       #endif
-    if (!LSFS::CanMount()) {
-      char tmp[128];
-      LSFS::WhyBusy(tmp);
-      #if defined(DIAGNOSE_STORAGE)
-      STDOUT.print(STORAGE_RES" is busy, flags= ");
-      STDOUT.println(tmp);
-      #endif
-      return;
     }
-    
-    if (!LSFS::Begin()) {
-      #if defined(DIAGNOSE_STORAGE)
-      STDOUT.println("Failed to mount " STORAGE_RES);
-      #endif
-      return;
+    return LSFS::IsMounted();
+  }
+
+  // A mount request is still in progress.
+  bool Pending() { return request_ && !LSFS::IsMounted(); }
+
+  // Call 'callback' once, when the current mount request completes (starts one
+  // if needed). Called right away if already mounted. Returns false if there
+  // are too many callbacks waiting.
+  bool WhenMounted(void (*callback)(bool mounted)) {
+    if (!callback) return false;
+    Mount();
+    if (LSFS::IsMounted()) {
+      callback(true);
+      return true;
     }
+    for (uint8_t i = 0; i < SDCARD_MOUNT_WAITERS; i++)
+      if (!waiters_[i]) {
+        waiters_[i] = callback;
+        return true;
+      }
+    return false;
   }
 
 protected:
@@ -114,45 +167,100 @@ protected:
   }
 
 #ifdef ULTRAPROFFIE
+  // Mounted means powered (no idle sleep); unmounted, only a request or activity needs us
+  uint32_t IdleMicros() override {
+    return request_ || Active() ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+  }
+
   void Loop() override {
       if (Active()) 
           RequestPower();   // for all subscribed domains       
-      if(!Serial_Protocol<SerialAdapter>::GetSession()) 
-      {        
-         if(!LSFS::IsMounted()) {   // attempt to mount once every secondm if it should be active
-          if (Active() && millis() - last_mount_try_ > 1000) {
-            last_mount_try_ = millis();
-            AudioStreamWork::LockSD_nomount(true);
-            if (LSFS::CanMount()) Mount();
-            AudioStreamWork::LockSD_nomount(false);
-          }
-        }   
-      }
+      CheckRequest();
+      bool session = Serial_Protocol<SerialAdapter>::GetSession();
+    #ifdef ENABLE_FLASH_CACHE
+      flash_cache.Session(session);   // paused during a session, checked again after
+    #endif
+      if (!session) MountLoop();
+      else font_prefetch.Clear();     // files may change during a session
   }
 #else 
   void Loop() override {
-      if (LSFS::IsMounted()) {
-        if (!Active()) {
+      if (LSFS::IsMounted() && !Active()) {
           AudioStreamWork::LockSD_nomount(true);
           AudioStreamWork::CloseAllOpenFiles();                 
           STDOUT.println("Unmounting " STORAGE_RES);
           LSFS::End();
+          fontCache.Invalidate();
+          font_prefetch.Clear();    // its open scan, too
           AudioStreamWork::LockSD_nomount(false);
-        } 
-      } else {
-        if (Active() && millis() - last_mount_try_ > 1000) {
-          last_mount_try_ = millis();
-          AudioStreamWork::LockSD_nomount(true);
-          if (LSFS::CanMount()) Mount();
-          AudioStreamWork::LockSD_nomount(false);
-        }
       }
+      CheckRequest();
+      MountLoop();
   }
 #endif 
 
-  
-  
+  // Retry from the shortest back-off, right now.
+  void Kick() {
+    backoff_ = SDCARD_MOUNT_BACKOFF_MIN;
+    state_machine_.sleep_until_ = millis();   // ends a running SLEEP()
+  }
 
+private:
+  bool TryMount() {
+    if (LSFS::IsMounted()) return true;
+    if (!LSFS::CanMount()) {
+      #if defined(DIAGNOSE_STORAGE)
+      char tmp[128];
+      LSFS::WhyBusy(tmp);
+      STDOUT.print(STORAGE_RES" is busy, flags= ");
+      STDOUT.println(tmp);
+      #endif
+      return false;
+    }
+    if (!LSFS::Begin()) {
+      #if defined(DIAGNOSE_STORAGE)
+      STDOUT.println("Failed to mount " STORAGE_RES);
+      #endif
+      return false;
+    }
+    return true;
+  }
+
+  // Complete the pending request, if any, and notify whoever waits for it.
+  void CheckRequest() {
+    if (!request_) return;
+    bool mounted = LSFS::IsMounted();
+    if (!mounted && millis() - request_start_ < SDCARD_MOUNT_TIMEOUT) return;
+    request_ = false;
+    for (uint8_t i = 0; i < SDCARD_MOUNT_WAITERS; i++)
+      if (waiters_[i]) {
+        void (*callback)(bool) = waiters_[i];
+        waiters_[i] = nullptr;
+        callback(mounted);
+      }
+  }
+
+  // Mount while requested or needed, doubling the wait after each failed
+  // attempt, up to SDCARD_MOUNT_BACKOFF_MAX.
+  void MountLoop() {
+    STATE_MACHINE_BEGIN();
+    while (true) {
+      while (LSFS::IsMounted() || !(request_ || Active())) YIELD();
+      backoff_ = SDCARD_MOUNT_BACKOFF_MIN;
+      while (!LSFS::IsMounted() && (request_ || Active())) {
+        AudioStreamWork::LockSD_nomount(true);
+        TryMount();
+        AudioStreamWork::LockSD_nomount(false);
+        if (LSFS::IsMounted()) break;
+        SLEEP(backoff_);
+        backoff_ <<= 1;
+        if (backoff_ > SDCARD_MOUNT_BACKOFF_MAX) backoff_ = SDCARD_MOUNT_BACKOFF_MAX;
+      }
+    }
+    STATE_MACHINE_END();
+  }
+
+protected:
 #ifdef ULTRAPROFFIE
         void PwrOn_Callback() override { 
           #ifdef DIAGNOSE_POWER
@@ -166,6 +274,7 @@ protected:
               STDOUT.println("Unmounting " STORAGE_RES);
             #endif          
             LSFS::End();
+            fontCache.Invalidate();
             AudioStreamWork::LockSD_nomount(false);
             #ifdef DIAGNOSE_POWER
               STDOUT.println(" sd- "); 
@@ -175,13 +284,24 @@ protected:
 
 private:
   uint32_t last_enabled_;
-  uint32_t last_mount_try_;
+  uint32_t backoff_ = SDCARD_MOUNT_BACKOFF_MIN;   // ms until the next mount attempt
+  bool request_ = false;                          // Mount() called, not completed yet
+  uint32_t request_start_ = 0;
+  void (*waiters_[SDCARD_MOUNT_WAITERS])(bool mounted) = {};
+#ifdef ULTRAPROFFIE
+  uint32_t warm_start_ = 0;
+  uint32_t warm_time_ = 0;
+#endif
 };
 
 SDCard sdcard;
 inline void MountSDCard() { sdcard.Mount(); }
+inline bool MountSDCardSync() { return sdcard.MountSync(); }
+inline bool SDCardMountPending() { return sdcard.Pending(); }
 #else
 inline void MountSDCard() {  }
+inline bool MountSDCardSync() { return false; }
+inline bool SDCardMountPending() { return false; }
 #endif // v4 && enable_sd
 
 #endif
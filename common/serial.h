@@ -329,20 +329,10 @@ public:
     */
     uint32_t CalculateCRC32(uint8_t *buffer, uint16_t nrOfBytes, uint8_t reset) // __attribute__((optimize("O0")))
     {   
-        uint32_t calcCrc = 0;
-        #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
-        if(reset)
-          calcCrc = HAL_CRC_Calculate(&stm32l4_crc, (uint32_t*)buffer, nrOfBytes);
-        else 
-          calcCrc = HAL_CRC_Accumulate(&stm32l4_crc, (uint32_t*)buffer, nrOfBytes);
-        #else 
         if(reset)
-          calcCrc = STCrc_impl.CRC_Calculate((uint32_t*)buffer, nrOfBytes);
-        else 
-          calcCrc = STCrc_impl.CRC_Acumulate((uint32_t*)buffer, nrOfBytes);
-        #endif
-
-        return calcCrc;
+          _crc.Reset();
+        _crc.Update(buffer, nrOfBytes);
+        return _crc.Value();
     }
     /* brief    : Wait nr of bytes on serial with deseried timeout 
     *  param    : nrOfByes - nr of bytes we want to wait
@@ -372,6 +362,7 @@ public:
     uint16_t _dataLen;
     uint16_t _flags;
     uint32_t _checkSum;
+    CRC32 _crc;
     uint8_t _protocolFrame[SERIAL_PROTOCOL_LEN];
     static bool _sessionState;
     static Print* savedDefault_output;
@@ -393,6 +384,10 @@ class Serial_Transfer : public Serial_Protocol<SA>, CommandParser,Looper
     this->_sessionTimeStamp = 0;
   }
 
+  uint32_t IdleMicros() override {
+    return Serial_Protocol<SA>::GetSession() ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+  }
+
   bool Parse(const char* cmd, const char* arg) override {
     if (!strcmp(cmd, "openSession"))
     { 
@@ -1017,24 +1012,9 @@ class Serial_Transfer : public Serial_Protocol<SA>, CommandParser,Looper
             strcpy(tmpPath, (char*)(cmd+1));
             _file = LSFS::Open(tmpPath);
             if(_file) {
-              uint32_t bytesAvailable = 0, calcCrc = 0;
-              uint16_t byteRead = 0;
-              uint8_t  rst = 1;
-              bytesAvailable =  _file.available();
-              while(bytesAvailable)
-              {
-              if(bytesAvailable >= SERIAL_PROTOCOL_FILE_MAX_LEN && bytesAvailable > 0) {
-                byteRead = _file.read(cmd, SERIAL_PROTOCOL_FILE_MAX_LEN);
-                calcCrc =  Serial_Protocol<SA>::CalculateCRC32(cmd, byteRead, rst);
-                rst = 0;
-              }
-              else if( bytesAvailable > 0 && bytesAvailable < SERIAL_PROTOCOL_FILE_MAX_LEN) {
-                byteRead = _file.read((cmd), bytesAvailable);
-                calcCrc =  Serial_Protocol<SA>::CalculateCRC32(cmd, byteRead, rst);
-                rst = 0;
-              }
-              bytesAvailable =  _file.available();
-              }
+              CRC32 fileCrc;
+              fileCrc.UpdateFromFile(&_file, _file.available());
+              uint32_t calcCrc = fileCrc.Value();
               _file.close();
               *cmd = trOk;
               *(uint32_t*)(cmd+1) = calcCrc;
@@ -1154,6 +1134,10 @@ StaticWrapper<Serial_Transfer<SerialAdapter>> mtpUart;
 
 #endif  // end mtp
 
+#ifndef PARSER_IDLE_HOLDOFF
+#define PARSER_IDLE_HOLDOFF 2000    // [ms] keep polling this long after the last received byte
+#endif
+
 // Command-line parser. Easiest way to use it is to start the arduino
 // serial monitor.
 template<class SA> /* SA = Serial Adapter */
@@ -1173,6 +1157,13 @@ public:
     SA::begin();
   }
 
+  // Serial RX wakes the CPU, but stay awake through a host session anyway
+  uint32_t IdleMicros() override {
+    if (SA::Connected() && SA::stream().available()) return 0;
+    if (millis() - last_rx_ < PARSER_IDLE_HOLDOFF) return LOOPER_IDLE_POLL;
+    return LOOPER_IDLE_FOREVER;
+  }
+
   void Loop() override {
 
 #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
@@ -1207,6 +1198,7 @@ public:
 
         int c = SA::stream().read();
         if (c < 0) { break; }
+        last_rx_ = millis();
         if (c == '\n' || c == '\r') {
           if (cmd_) ParseLine();
           len_ = 0;
@@ -1259,8 +1251,25 @@ public:
     }
     stdout_output = &SA::stream();
     STDOUT.print(SA::response_header());
-    char *cmd = cmd_;
+    // "batch <cmd1>;<cmd2>;..." runs several commands back to back under a
+    // single response header/footer. Any other line is one command, ';' and all.
+    if (!strncmp(cmd_, "batch ", 6)) {
+      for (char* next = cmd_ + 6; next; ) {
+        char *cmd = next;
+        next = strchr(cmd, ';');
+        if (next) *next++ = 0;
+        ParseCommand(cmd);
+      }
+    } else {
+      ParseCommand(cmd_);
+    }
+    STDOUT.print(SA::response_footer());
+    stdout_output = default_output;
+  }
+
+  void ParseCommand(char* cmd) {
     while (*cmd == ' ') cmd++;
+    if (!*cmd) return;
     char *e = cmd;
     while (*e != ' ' && *e) e++;
     if (*e) {
@@ -1274,14 +1283,13 @@ public:
       STDOUT.print("Whut? :");
       STDOUT.println(cmd);
     }
-    STDOUT.print(SA::response_footer());
-    stdout_output = default_output;
   }
 
 private:
   int len_ = 0;
   char* cmd_ = nullptr;
   int space_ = 0;
+  uint32_t last_rx_ = 0;
 };
 
 StaticWrapper<Parser<SerialAdapter>> parser;
@@ -46,7 +46,6 @@ struct PrintHelper<T, decltype(((T*)0)->printTo(*(Print*)0))> {
 class ConsoleHelper : public Print {
 private:
   bool broadcast = false;    // true if broadcasting binary
-  uint32_t lastMillis;
 public:
   size_t write(uint8_t b) override {
     size_t ret = stdout_output->write(b);
@@ -89,7 +88,6 @@ public:
       default_output = &EmptySerial;                
       stdout_output = &EmptySerial; 
       broadcast = true;   
-      lastMillis = millis();
   }
 
   void StopBroadcast() {
@@ -102,27 +100,7 @@ public:
 
   bool Broadcasting() {   return broadcast;   }
   
-  size_t Broadcast(uint8_t channel, void* buffer, uint16_t size) { //  __attribute__((optimize("Og")))  {
-    if (!Broadcasting()) return 0;          // silence, we're NOT broadcasting
-    if (!channel) return 0;                 // Don't broadcast on channel 0
-    uint32_t timeNow = millis();
-    // uint32_t timeNow = 10*millis(); timeNow = timeNow / 7;    // adjust for systick bug
-    if (timeNow-lastMillis < 10) return 0;  // Limit frequency to 100 Hz   // TODO: set frequency per channel
-    // if (timeNow-lastMillis < 5) return 0;  // Limit frequency to 200 Hz
-    lastMillis = timeNow;
-    #ifdef OBSIDIANFORMAT 
-      size_t ret = Serial.write((uint8_t*)buffer, size);
-      ret += Serial.write((uint8_t*)(&timeNow), 4);
-
-    // size_t ret = Serial.println(timeNow);
-    #else
-      size_t ret = Serial.write(channel);   
-      ret += Serial.write((uint8_t*)(&timeNow), 4);
-      ret += Serial.write((uint8_t*)(&size), 2);
-      ret += Serial.write((uint8_t*)buffer, size);
-    #endif
-    return ret;
-  }
+  // Packets are sent by Telemetry (common/telemetry.h)
 #endif // X_BROADCAST
 
   template<typename T>
@@ -0,0 +1,201 @@
+#ifndef COMMON_TELEMETRY_H
+#define COMMON_TELEMETRY_H
+
+/********************************************************************
+ *  TELEMETRY - binary monitoring stream (replaces raw Broadcast)    *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - enabled by #define X_BROADCAST, started with "broadcast"      *
+ *  - Publish() is safe from interrupts: packets go to a lock-free  *
+ *    ring of fixed slots, the Looper drains them in one write      *
+ *  - per-channel rate limit, set with "telemetry <ch> <Hz>"        *
+ *  - packet: A5 | ch | seq16 | micros32 | size | payload           *
+ *    seq counts every accepted packet, gaps mean lost packets      *
+ ********************************************************************/
+
+#ifdef X_BROADCAST
+
+#ifndef TELEMETRY_SLOTS
+#define TELEMETRY_SLOTS     64      // must be a power of 2
+#endif
+#define TELEMETRY_SLOT_SIZE 32      // header + payload
+#define TELEMETRY_SYNC      0xA5
+
+enum TelemetryChannel : uint8_t {
+    tm_none = 0,
+    tm_debug,           // ad-hoc debug structures (prop, menu, shake, tap...)
+    tm_imu,             // raw LSM6DS3H output: gyro xyz, accel xyz (int16, sensor units)
+    tm_fusion,          // fused accel [0.01g] & gyro [0.01dps]
+    tm_mixer,           // dynamic mixer envelope, peaks and underflows
+    tm_cpu,             // CPU probes of the interrupt handlers
+    tm_numChannels
+};
+
+struct TelemetryHeader {
+    uint8_t sync;
+    uint8_t channel;
+    uint16_t seq;
+    uint32_t micros;
+    uint8_t size;
+} __attribute__((packed));
+
+#define TELEMETRY_MAX_PAYLOAD (TELEMETRY_SLOT_SIZE - sizeof(TelemetryHeader))
+
+class Telemetry : public Looper, CommandParser {
+public:
+    Telemetry() : Looper(), CommandParser() {
+        for (uint8_t i = 0; i < tm_numChannels; i++) {
+            period_[i] = 10000;     // 100 Hz, as the old broadcast
+            last_[i] = 0;
+            seq_[i] = 0;
+        }
+        period_[tm_imu] = 0;        // as fast as the sensor (1.66 kHz)
+        period_[tm_mixer] = 0;      // once per audio block
+        head_ = tail_ = 0;
+        dropped_ = 0;
+    }
+    const char* name() override { return "Telemetry"; }
+
+    // Queue a packet. Callable from any context; returns false if rate-limited or dropped.
+    bool Publish(TelemetryChannel channel, const void* data, uint8_t size) {
+        if (!STDOUT.Broadcasting()) return false;
+        if (channel == tm_none || channel >= tm_numChannels) return false;
+        if (size > TELEMETRY_MAX_PAYLOAD) size = TELEMETRY_MAX_PAYLOAD;
+        uint32_t now = micros();
+        if (period_[channel] == 0xFFFFFFFF) return false;   // channel off
+        if (now - last_[channel] < period_[channel]) return false;
+        last_[channel] = now;
+        uint16_t seq = __atomic_fetch_add(&seq_[channel], 1, __ATOMIC_RELAXED);
+
+        // Claim a slot
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        do {
+            if (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) >= TELEMETRY_SLOTS) {
+                __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);     // full: host sees the seq gap
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&head_, &head, head + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+        Slot& slot = slots_[head & (TELEMETRY_SLOTS - 1)];
+        TelemetryHeader* h = (TelemetryHeader*)slot.data;
+        h->sync = TELEMETRY_SYNC;
+        h->channel = channel;
+        h->seq = seq;
+        h->micros = now;
+        h->size = size;
+        memcpy(slot.data + sizeof(TelemetryHeader), data, size);
+        __atomic_store_n(&slot.ready, 1, __ATOMIC_RELEASE);    // commit
+        return true;
+    }
+
+    uint32_t IdleMicros() override {
+        return STDOUT.Broadcasting() ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+    }
+
+    // Drain committed slots, in order, with a single write
+    void Loop() override {
+        if (!STDOUT.Broadcasting()) return;
+        PublishCPU();
+        uint8_t out[TELEMETRY_SLOT_SIZE * 16];
+        uint16_t len = 0;
+        uint32_t tail = tail_;
+        while (tail != __atomic_load_n(&head_, __ATOMIC_ACQUIRE)) {
+            Slot& slot = slots_[tail & (TELEMETRY_SLOTS - 1)];
+            if (!__atomic_load_n(&slot.ready, __ATOMIC_ACQUIRE)) break;   // still being written
+            TelemetryHeader* h = (TelemetryHeader*)slot.data;
+            uint16_t n = sizeof(TelemetryHeader) + h->size;
+            if (len + n > sizeof(out)) break;
+        #ifdef OBSIDIANFORMAT
+            memcpy(out + len, slot.data + sizeof(TelemetryHeader), h->size);
+            uint32_t ms = h->micros / 1000;
+            memcpy(out + len + h->size, &ms, 4);
+            len += h->size + 4;
+        #else
+            memcpy(out + len, slot.data, n);
+            len += n;
+        #endif
+            slot.ready = 0;
+            tail++;
+            __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+        }
+        if (len) Serial.write(out, len);
+    }
+
+    bool Parse(const char* cmd, const char* arg) override {
+        if (!strcmp(cmd, "broadcast")) {
+            if (arg && !strcmp(arg, "off")) STDOUT.StopBroadcast();
+            else {
+                tail_ = head_;      // discard anything older
+                STDOUT.StartBroadcast();
+            }
+            return true;
+        }
+        if (!strcmp(cmd, "telemetry")) {
+            if (!arg) {
+                for (uint8_t i = 1; i < tm_numChannels; i++) {
+                    STDOUT.print("ch"); STDOUT.print(i); STDOUT.print(": ");
+                    if (period_[i] == 0xFFFFFFFF) STDOUT.println("off");
+                    else if (!period_[i]) STDOUT.println("max");
+                    else { STDOUT.print(1000000 / period_[i]); STDOUT.println(" Hz"); }
+                }
+                STDOUT.print("dropped: "); STDOUT.println(dropped_);
+                return true;
+            }
+            char* hz;
+            uint32_t ch = strtol(arg, &hz, 0);
+            while (*hz == ' ') hz++;
+            if (!ch || ch >= tm_numChannels) return false;
+            uint32_t rate = strtol(hz, nullptr, 0);
+            if (!strcmp(hz, "max")) period_[ch] = 0;
+            else period_[ch] = rate ? 1000000 / rate : 0xFFFFFFFF;
+            return true;
+        }
+        return false;
+    }
+
+    void Help() override {
+        STDOUT.println(" broadcast [off] - start/stop binary telemetry");
+        STDOUT.println(" telemetry [channel Hz|max|0] - show/set telemetry rates");
+    }
+
+private:
+    struct Slot {
+        uint8_t data[TELEMETRY_SLOT_SIZE];
+        volatile uint8_t ready;
+    };
+
+    // CPU probes are sampled here rather than from each interrupt
+    void PublishCPU() {
+    #ifdef X_PROBECPU
+        struct {
+            int32_t duration[4];    // average duration, machine cycles
+            uint16_t period[2];     // average period, us (audio, motion)
+        } __attribute__((packed)) ch;
+        ch.duration[0] = audio_dma_interrupt_cycles.duration.avg;
+        ch.duration[1] = pixel_dma_interrupt_cycles.duration.avg;
+        ch.duration[2] = motion_interrupt_cycles.duration.avg;
+        ch.duration[3] = wav_interrupt_cycles.duration.avg;
+        ch.period[0] = audio_dma_interrupt_cycles.period.avg;
+        ch.period[1] = motion_interrupt_cycles.period.avg;
+        Publish(tm_cpu, &ch, sizeof(ch));
+    #endif
+    }
+
+    Slot slots_[TELEMETRY_SLOTS];
+    uint32_t head_;             // next slot to claim (producers)
+    uint32_t tail_;             // next slot to send (Loop)
+    uint32_t dropped_;
+    uint32_t period_[tm_numChannels];   // minimum time between packets, us. 0 = no limit, 0xFFFFFFFF = off
+    uint32_t last_[tm_numChannels];
+    uint16_t seq_[tm_numChannels];
+};
+
+Telemetry telemetry;
+
+#define TELEMETRY_PUBLISH(CH, DATA, SIZE) telemetry.Publish(CH, DATA, SIZE)
+
+#else
+#define TELEMETRY_PUBLISH(CH, DATA, SIZE) do {} while(0)
+#endif // X_BROADCAST
+
+#endif // COMMON_TELEMETRY_H
@@ -0,0 +1,121 @@
+#ifndef COMMON_TRACE_H
+#define COMMON_TRACE_H
+
+/********************************************************************
+ *  EVENT TRACE - cycle-stamped flight recorder                     *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - always compiled in, off until "trace on [mask]"               *
+ *  - Record() is safe from interrupts; the ring keeps the last     *
+ *    TRACE_RECORDS events, older ones are overwritten              *
+ *  - "trace dump" sends the ring in binary, oldest first:          *
+ *    "TRC1" | u32 cpu MHz | u32 cycles now | u32 millis now |      *
+ *    u16 count | count * TraceRecord | u8 nLoopers | (u8 len|name)*|
+ *    looper arg = position in that list                            *
+ *  - common/trace_decode.py turns a captured dump into text        *
+ ********************************************************************/
+
+#ifndef TRACE_RECORDS
+  #ifdef ARDUINO_ARCH_ESP32
+  #define TRACE_RECORDS 512         // must be a power of 2
+  #else
+  #define TRACE_RECORDS 128         // must be a power of 2
+  #endif
+#endif
+
+// Event categories, as bits of the runtime mask
+enum TraceCategory : uint8_t {
+    trc_saber   = 0b00000001,       // SaberBase dispatch
+    trc_looper  = 0b00000010,       // Looper runs (floods the ring, enable only when needed)
+    trc_audio   = 0b00000100,       // AudioStreamWork refills, wav players started
+    trc_dma     = 0b00001000,       // audio DMA interrupts
+    trc_motion  = 0b00010000,       // motion sensor data, clash detection
+    trc_default = 0b00011101        // all but loopers
+};
+
+// Event IDs. 'arg' meaning in brackets.
+enum TraceEvent : uint8_t {
+    tr_none = 0,
+    // SaberBase::Do* functions [EffectType]. Sent at dispatch begin, then again with tr_end set when all SaberBases ran
+    tr_Effect, tr_On, tr_Off, tr_BladeDetect, tr_Change, tr_Top, tr_IsOn,
+    tr_looper,          // Looper::Loop() run [looper position]
+    tr_refill,          // AudioStreamWork::ProcessAudioStreams() [0]
+    tr_wavplay,         // wav player got a new file [player index]
+    tr_dacisr,          // audio DMA interrupt [0]
+    tr_motion,          // accel & gyro data received [0]
+    tr_clash,           // clash detected by the prop [strength * 100]
+    tr_end = 0x80       // OR-ed to the ID of the matching end event
+};
+
+struct TraceRecord {
+    uint32_t cycles;    // cycle counter at event
+    uint8_t id;         // TraceEvent
+    uint8_t reserved;
+    uint16_t arg;
+} __attribute__((packed));
+
+class EventTrace {
+public:
+    static volatile uint8_t mask;       // enabled categories, 0 = off
+
+    static inline void Record(TraceCategory category, uint8_t id, uint16_t arg = 0) {
+        if (!(mask & category)) return;
+        uint32_t idx = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+        TraceRecord& r = ring_[idx & (TRACE_RECORDS - 1)];
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        r.cycles = DWT->CYCCNT;
+    #else
+        r.cycles = xthal_get_ccount();
+    #endif
+        r.id = id;
+        r.reserved = 0;
+        r.arg = arg;
+    }
+
+    static void Start(uint8_t newMask) {
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+            CoreDebug->DEMCR |= 1<<24; // DEMCR_TRCENA_Msk;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+    #endif
+        head_ = 0;
+        mask = newMask;
+    }
+    static void Stop() { mask = 0; }
+
+    // Binary dump, recording paused meanwhile
+    static void Dump(Print& out) {
+        uint8_t savedMask = mask;
+        mask = 0;
+        uint32_t head = head_;
+        uint16_t count = head < TRACE_RECORDS ? head : TRACE_RECORDS;
+        uint32_t mhz = _SYSTEM_CORE_CLOCK_MHZ_;
+    #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+        uint32_t cycles = DWT->CYCCNT;
+    #else
+        uint32_t cycles = xthal_get_ccount();
+    #endif
+        uint32_t now = millis();
+        out.write((const uint8_t*)"TRC1", 4);
+        out.write((const uint8_t*)&mhz, 4);
+        out.write((const uint8_t*)&cycles, 4);
+        out.write((const uint8_t*)&now, 4);
+        out.write((const uint8_t*)&count, 2);
+        for (uint32_t i = head - count; i != head; i++)
+            out.write((const uint8_t*)&ring_[i & (TRACE_RECORDS - 1)], sizeof(TraceRecord));
+        mask = savedMask;
+    }
+
+private:
+    static uint32_t head_;
+    static TraceRecord ring_[TRACE_RECORDS];
+};
+
+volatile uint8_t EventTrace::mask = 0;
+uint32_t EventTrace::head_ = 0;
+TraceRecord EventTrace::ring_[TRACE_RECORDS];
+
+#define TRACE(CATEGORY, ID, ARG) EventTrace::Record(CATEGORY, ID, ARG)
+
+#endif // COMMON_TRACE_H
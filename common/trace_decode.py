@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+# Decode a "trace dump" capture (see common/trace.h) into text.
+# Usage: trace_decode.py capture.bin
+#   e.g. capture with: (echo trace dump; sleep 1) | ... > capture.bin
+# Text before the "TRC1" marker (echo, prompts) is skipped.
+
+import struct
+import sys
+
+EVENTS = ["none", "Effect", "On", "Off", "BladeDetect", "Change", "Top", "IsOn",
+          "looper", "refill", "wavplay", "dacisr", "motion", "clash"]
+TR_END = 0x80
+
+
+def decode(data):
+    start = data.find(b"TRC1")
+    if start < 0:
+        sys.exit("no TRC1 marker found")
+    pos = start + 4
+    mhz, now_cycles, now_millis, count = struct.unpack_from("<IIIH", data, pos)
+    pos += 14
+    records = []
+    for _ in range(count):
+        records.append(struct.unpack_from("<IBBH", data, pos))
+        pos += 8
+    names = []
+    if pos < len(data):
+        n = data[pos]
+        pos += 1
+        for _ in range(n):
+            length = data[pos]
+            names.append(data[pos + 1:pos + 1 + length].decode("ascii", "replace"))
+            pos += 1 + length
+
+    print("cpu %d MHz, dump at %d ms, %d records" % (mhz, now_millis, count))
+    for cycles, id, _, arg in records:
+        # cycles before the dump, modulo 2^32 like the counter
+        ago = ((now_cycles - cycles) & 0xffffffff) / mhz
+        name = EVENTS[id & ~TR_END] if (id & ~TR_END) < len(EVENTS) else "id%d" % (id & ~TR_END)
+        if id & TR_END:
+            name += " end"
+        if (id & ~TR_END) == 8 and arg < len(names):
+            detail = names[arg]
+        elif (id & ~TR_END) == 13:
+            detail = "%.2f" % (arg / 100.0)
+        else:
+            detail = str(arg)
+        print("%12.1f us  %-16s %s" % (-ago, name, detail))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        sys.exit("usage: trace_decode.py capture.bin")
+    with open(sys.argv[1], "rb") as f:
+        decode(f.read())
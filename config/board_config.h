@@ -77,6 +77,7 @@
         uint8_t nBlades = 0;        // number of installed blades
         bool monochrome = true;     // assume monochrome, set true at install time
         uint32_t APOtime;           // auto power off time [ms]
+        uint8_t audioLatency = 0;   // 0 = normal, 1 = low latency audio
     } installConfig;
     #undef VOLUME
     #define VOLUME installConfig.audioFSR
@@ -192,6 +193,7 @@
             uint8_t nBlades = 0;        // number of installed blades
             bool monochrome = true;     // assume monochrome, set true at install time
             uint32_t APOtime;           // auto power off time [ms]
+            uint8_t audioLatency = 0;   // 0 = normal, 1 = low latency audio
         } installConfig;
         #undef VOLUME
         #define VOLUME installConfig.audioFSR
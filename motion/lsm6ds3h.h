@@ -193,6 +193,7 @@
       last_event_ = millis();
 #ifdef ARDUINO_ARCH_STM32L4   // STM architecture 
   attachInterrupt(digitalPinToInterrupt(motionSensorInterruptPin), motion_irq, RISING);
+      streaming_ = true;
 
   #ifdef ULTRAPROFFIE
       while (enabled) {
@@ -205,11 +206,13 @@
           STDOUT.println("Motion timeout.");
           #endif
           detachInterrupt(digitalPinToInterrupt(motionSensorInterruptPin));
+          streaming_ = false;
           goto i2c_timeout;
   	    }
 	    YIELD();
     }
     detachInterrupt(digitalPinToInterrupt(motionSensorInterruptPin));
+    streaming_ = false;
 
 #else  // nPROFFIEBOARD
       while (true) {
@@ -235,6 +238,8 @@
 	}
 	
 	I2C_READ_BYTES_ASYNC(OUTX_L_G, databuffer, 12);
+	TELEMETRY_PUBLISH(tm_imu, databuffer, 12);
+	TRACE(trc_motion, tr_motion, 0);
 	// accel data available
 	prop.DoAccel(
 	  MotionUtil::FromData(databuffer + 6, 16.0 / 32768.0,   // 16 g range
@@ -298,6 +303,15 @@
   }
 
 #ifdef ARDUINO_ARCH_STM32L4   // STM architecture
+  // While streaming, samples are read from the data-ready interrupt: Loop() is
+  // only needed for a sample the interrupt missed, or for the timeout check.
+  uint32_t IdleMicros() override {
+    if (!streaming_) return Looper::IdleMicros();
+    if (digitalRead(motionSensorInterruptPin)) return 0;
+    uint32_t elapsed = millis() - last_event_;
+    return elapsed >= I2C_TIMEOUT_MILLIS * 2 ? 0 : (I2C_TIMEOUT_MILLIS * 2 - elapsed) * 1000;
+  }
+
   void Poll() {
     if (!digitalRead(motionSensorInterruptPin)) {
       return;
@@ -334,6 +348,8 @@
   void DataReceived2() {
     stm32l4_i2c_notify(Wire._i2c, nullptr, 0, 0);
     I2CUnlock();
+    TELEMETRY_PUBLISH(tm_imu, databuffer, 12);
+    TRACE(trc_motion, tr_motion, 0);
     // accel data available
     prop.DoAccel(MotionUtil::FromData(databuffer + 6, 16.0 / 32768.0,   // 16 g range
 				      Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
@@ -352,6 +368,7 @@
 
   uint8_t databuffer[12];
   volatile uint32_t last_event_;
+  bool streaming_ = false;    // data-ready interrupt attached
   bool first_motion_;
   bool first_accel_;
   uint8_t id_ = 105;
@@ -212,7 +212,7 @@ bool SetActions(xMenuActions* actions_, TYPE initialValue)  {
         player2->CloseFiles();
     }
     else {
-        player2 = GetFreeWavPlayer();
+        player2 = GetFreeWavPlayer(wp_background);
         player2->set_fade_time(0.003);
     }     
 
@@ -516,7 +516,7 @@ public:
         ch1_broadcast.down1 = (int16_t)(tick);
         ch1_broadcast.down2 = (int16_t)(scrollIndex);     
         ch1_broadcast.down3 = (int16_t)(scrollTickPeriod);
-        STDOUT.Broadcast(1, &ch1_broadcast, sizeof(ch1_broadcast));
+        TELEMETRY_PUBLISH(tm_debug, &ch1_broadcast, sizeof(ch1_broadcast));
     #endif // X_BROADCAST
 
     }
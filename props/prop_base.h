@@ -5,6 +5,10 @@
 #define PROP_INHERIT_PREFIX
 #endif
 
+#ifndef PROP_IDLE_POLL
+#define PROP_IDLE_POLL 10000    // [us] idle hint while the blade is off and motion is stopped
+#endif
+
 #include "TTmenu.h"
 #ifdef OSX_ENABLE_MTP
   #include "../common/serial.h"
@@ -224,6 +228,7 @@ public:
     }
   }
   virtual void Clash(int8_t stab, float strength) {   // stab=-1 => reversed stab
+    TRACE(trc_motion, tr_clash, (uint16_t)(strength * 100));
     // TODO: Pick clash randomly and/or based on strength of clash.
     uint32_t t = millis();
     if (t - last_clash_ < clash_timeout_) {
@@ -266,23 +271,15 @@ public:
     }
 #endif
 
-    char *b = current_directory;
-    for (const char *a = dir; *a; a++) {
-      // Skip trailing slash
-      if (*a == '/' && (a[1] == 0 || a[1] == ';'))
-        continue;
-      if (*a == ';') {
-        *(b++) = 0;
-        continue;
-      }
-      *(b++) = *a;
-    }
-    // Two zeroes at end!
-    *(b++) = 0;
-    *(b++) = 0;
+    split_directories(current_directory, dir);
 
 #ifdef ENABLE_AUDIO
-    Effect::ScanCurrentDirectory();
+    if (font_prefetch.Switch(dir)) {      // prefetched: no need to scan
+      Effect::CheckFiles();
+    } else {
+      Effect::ScanCurrentDirectory();
+      font_prefetch.Scanned(dir);
+    }
     SaberBase* font = NULL;
     hybrid_font.Activate();
     font = &hybrid_font;
@@ -379,6 +376,12 @@ public:
       #endif
       presetIndex = presetIndex % presets.size();         // circular indexing
       FreeBladeStyles();                               // delete old styles
+      ReindexPresets();                                // presets file replaced since it was indexed
+      while (presets.size() > 1 && !presets[presetIndex].Load()) {   // read the preset on first use, drop it if unusable
+        presets.erase(presets.begin() + presetIndex);
+        presetIndex = presetIndex % presets.size();
+        UpdateMonoFont();
+      }
       if (presets.size()) {
         current_preset_ = presets.data() + presetIndex;     // set new preset
         #ifdef DIAGNOSE_PRESETS
@@ -394,6 +397,50 @@ public:
       chdir(current_preset_->font);                       // change font
       userProfile.preset = presetIndex+1;                 // set current preset in user profile
     }
+
+    // Presets loaded with deferred checks (fast boot) are checked here, one per loop,
+    // while the blade is off. Invalid ones are dropped, the current one stays selected.
+    void CheckNextPreset() {
+      if (!presetsUnchecked) {
+        BOOT_MARK(boot_background);
+        return;
+      }
+      if (SaberBase::IsOn()) return;
+      LOCK_SD(true);
+      if (LSFS::IsMounted()) {
+        uint8_t i = 0;
+        while (i < presets.size() && presets[i].checked) i++;
+        if (i == presets.size()) presetsUnchecked = 0;
+        else {
+          presetsUnchecked--;
+          if (!presets[i].CheckSounds() && presets.size() > 1) {
+            bool wasCurrent = userProfile.preset == i+1;
+            presets.erase(presets.begin() + i);
+            if (userProfile.preset > i+1 || userProfile.preset > presets.size()) userProfile.preset--;
+            if (wasCurrent) ChangePreset(userProfile.preset-1);
+            else if (userProfile.preset) current_preset_ = presets.data() + userProfile.preset - 1;
+          }
+        }
+        if (!presetsUnchecked) UpdateMonoFont();
+      }
+      LOCK_SD(false);
+    }
+
+    // While idle, index the fonts of the next and previous presets, so browsing
+    // to them doesn't wait for a font scan.
+    void PrefetchNeighbours() {
+#ifdef ENABLE_AUDIO
+      if (presets.size() < 2 || !userProfile.preset || presetsUnchecked) return;
+      if (SaberBase::IsOn() || SoundActive() || !LSFS::IsMounted()) return;
+      uint8_t n = presets.size();
+      uint8_t next = userProfile.preset % n;                // 0-based
+      uint8_t previous = (userProfile.preset + n - 2) % n;
+      // Next first, then previous: a slice of one scan per loop
+      const char* font = presets[next].font;
+      if (font_prefetch.Has(font)) font = presets[previous].font;
+      font_prefetch.Prefetch(font);
+#endif
+    }
   
   public:
     // preset_num starts at 1!
@@ -632,6 +679,12 @@ public:
       process = DoGesture(TWIST_CLOSE);
     }
     if (process) {
+      #ifdef ULTRAPROFFIE
+        // A valid stroke while off may be the first half of a twist-on: get the SD ready
+        if (!IsOn() && strokes[NELEM(strokes)-1].length() > TWIST_MINTIME &&
+            strokes[NELEM(strokes)-1].length() < TWIST_MAXTIME)
+          powerman.Anticipate(intent_motion);
+      #endif
       if ((strokes[NELEM(strokes)-1].type == TWIST_LEFT &&
            strokes[NELEM(strokes)-2].type == TWIST_RIGHT) ||
           (strokes[NELEM(strokes)-1].type == TWIST_RIGHT &&
@@ -730,7 +783,7 @@ public:
         ch1_broadcast.down1 = (int16_t)(shakeState);
         ch1_broadcast.down2 = 0;
         ch1_broadcast.down3 = 0;
-        STDOUT.Broadcast(1, &ch1_broadcast, sizeof(ch1_broadcast));        
+        TELEMETRY_PUBLISH(tm_debug, &ch1_broadcast, sizeof(ch1_broadcast));        
   #endif // X_BROADCAST   
   }
 
@@ -821,7 +874,7 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
         ch1_broadcast.down1 = clash;
         ch1_broadcast.down2 = tapCounter;
         ch1_broadcast.down3 = Detected2Tap;
-        STDOUT.Broadcast(1, &ch1_broadcast, sizeof(ch1_broadcast));        
+        TELEMETRY_PUBLISH(tm_debug, &ch1_broadcast, sizeof(ch1_broadcast));        
   #endif // X_BROADCAST   
   }
 
@@ -850,7 +903,7 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
     } else {
       MountSDCard();
       EnableAmplifier();
-      track_player_ = GetFreeWavPlayer();
+      track_player_ = GetFreeWavPlayer(wp_background);
       if (track_player_) {
           track_player_->Play(current_preset_->track);
       } else {
@@ -921,6 +974,18 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
   uint32_t last_beep_;
   float current_tick_angle_ = 0.0;
 
+  // Clashes and motion are handled as they come in. Without motion, the rest
+  // (battery, presets, idle off) doesn't mind waiting PROP_IDLE_POLL.
+  uint32_t IdleMicros() override {
+    if (clash_pending1_) return 0;
+    if (clash_pending_) {
+      uint32_t elapsed = millis() - last_clash_;
+      return elapsed >= clash_timeout_ ? 0 : (clash_timeout_ - elapsed) * 1000;
+    }
+    if (SaberBase::IsOn() || fusor.ready()) return LOOPER_IDLE_POLL;
+    return PROP_IDLE_POLL;
+  }
+
   void Loop() override {
     CallMotion();
     if (clash_pending1_) {
@@ -932,6 +997,8 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
       Clash2(pending_clash_is_stab_, pending_clash_strength_);
     }
     CheckLowBattery();
+    CheckNextPreset();
+    PrefetchNeighbours();
 #ifdef ENABLE_AUDIO
     if (track_player_ && !track_player_->isPlaying()) {
       track_player_.Free();
@@ -1027,416 +1094,330 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
     STDOUT.println(millis());
   }
 
+  // Commands are looked up in commandList_ (sorted, see after the class) instead of a strcmp chain
   bool Parse(const char *cmd, const char* arg) override {
-
-    if (!strcmp(cmd, "stealth")) {
-      // stealthMode = !stealthMode;
-      SetStealth(!stealthMode); 
-      return true;
-    }
     #ifdef X_MENUTEST
       // parse menu commands as well, if needed
       if (menu)
         if (menu->Parse(cmd, arg)) return true;   
     #endif  // X_MENUTEST  
+    return commands_.Run(this, cmd, arg);
+  }
 
-
-    if (!strcmp(cmd, "on")) {
-        On();      
-      return true;
-    }
-    if (!strcmp(cmd, "off")) {
-      Off();
-      return true;
-    }
-    if (!strcmp(cmd, "get_on")) {
-      STDOUT.println(IsOn());
-      return true;
-    }
-    if (!strcmp(cmd, "clash")) {
-      Clash(false, 10.0);
-      return true;
-    }
-    if (!strcmp(cmd, "stab")) {
-      Clash(true, 10.0);
-      return true;
-    }
-    if (!strcmp(cmd, "force")) {
-      SaberBase::DoForce();
-      return true;
-    }
-    if (!strcmp(cmd, "blast")) {
-      // Avoid the base and the very tip.
-      // TODO: Make blast only appear on one blade!
-      SaberBase::DoBlast();
-      return true;
-    }
-    if (!strcmp(cmd, "lock") || !strcmp(cmd, "lockup")) {
-      On();
-      STDOUT.print("Lockup ");
-      if (SaberBase::Lockup() == SaberBase::LOCKUP_NONE) {
-        SaberBase::SetLockup(SaberBase::LOCKUP_NORMAL);
-        SaberBase::DoBeginLockup();
-        STDOUT.println("ON");
-      } else {
-        SaberBase::DoEndLockup();
-        SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
-        STDOUT.println("OFF");
-      }
-      return true;
-    }
-    if (!strcmp(cmd, "drag")) {
-      STDOUT.print("Drag ");
-      if (SaberBase::Lockup() == SaberBase::LOCKUP_NONE) {
-        SaberBase::SetLockup(SaberBase::LOCKUP_DRAG);
-        SaberBase::DoBeginLockup();
-        STDOUT.println("ON");
-      } else {
-        SaberBase::DoEndLockup();
-        SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
-        STDOUT.println("OFF");
-      }
-      return true;
-    }
-    if (!strcmp(cmd, "lblock") || !strcmp(cmd, "lb")) {
-      STDOUT.print("lblock ");
-      if (SaberBase::Lockup() == SaberBase::LOCKUP_NONE) {
-        SaberBase::SetLockup(SaberBase::LOCKUP_LIGHTNING_BLOCK);
-        SaberBase::DoBeginLockup();
-        STDOUT.println("ON");
-      } else {
-        SaberBase::DoEndLockup();
-        SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
-        STDOUT.println("OFF");
-      }
-      return true;
-    }
-    if (!strcmp(cmd, "melt")) {
-      STDOUT.print("melt ");
-      if (SaberBase::Lockup() == SaberBase::LOCKUP_NONE) {
-        SaberBase::SetLockup(SaberBase::LOCKUP_MELT);
-        SaberBase::DoBeginLockup();
-        STDOUT.println("ON");
-      } else {
-        SaberBase::DoEndLockup();
-        SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
-        STDOUT.println("OFF");
-      }
-      return true;
+  // Lockup-type toggles
+  void ToggleLockup(SaberBase::LockupType type, const char* label) {
+    STDOUT.print(label);
+    if (SaberBase::Lockup() == SaberBase::LOCKUP_NONE) {
+      SaberBase::SetLockup(type);
+      SaberBase::DoBeginLockup();
+      STDOUT.println("ON");
+    } else {
+      SaberBase::DoEndLockup();
+      SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
+      STDOUT.println("OFF");
     }
+  }
 
-#ifdef ENABLE_AUDIO
+  // Command handlers. Return false to let other parsers try the same command.
+  bool CmdStealth(const char* arg) { SetStealth(!stealthMode); return true; }
+  bool CmdOn(const char* arg) { On(); return true; }
+  bool CmdOff(const char* arg) { Off(); return true; }
+  bool CmdGetOn(const char* arg) { STDOUT.println(IsOn()); return true; }
+  bool CmdClash(const char* arg) { Clash(false, 10.0); return true; }
+  bool CmdStab(const char* arg) { Clash(true, 10.0); return true; }
+  bool CmdForce(const char* arg) { SaberBase::DoForce(); return true; }
+  bool CmdBlast(const char* arg) {
+    // Avoid the base and the very tip.
+    // TODO: Make blast only appear on one blade!
+    SaberBase::DoBlast();
+    return true;
+  }
+  bool CmdLockup(const char* arg) {
+    On();
+    ToggleLockup(SaberBase::LOCKUP_NORMAL, "Lockup ");
+    return true;
+  }
+  bool CmdDrag(const char* arg) { ToggleLockup(SaberBase::LOCKUP_DRAG, "Drag "); return true; }
+  bool CmdLightningBlock(const char* arg) { ToggleLockup(SaberBase::LOCKUP_LIGHTNING_BLOCK, "lblock "); return true; }
+  bool CmdMelt(const char* arg) { ToggleLockup(SaberBase::LOCKUP_MELT, "melt "); return true; }
+
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  bool CmdBeep(const char* arg) {
+    beeper.Beep(0.5, 293.66 * 2);
+    beeper.Beep(0.5, 329.33 * 2);
+    beeper.Beep(0.5, 261.63 * 2);
+    beeper.Beep(0.5, 130.81 * 2);
+    beeper.Beep(1.0, 196.00 * 2);
+    return true;
+  }
 
-// #ifndef DISABLE_DIAGNOSTIC_COMMANDS
-#ifdef ENABLE_DIAGNOSE_COMMANDS
-    if (!strcmp(cmd, "beep")) {
-      beeper.Beep(0.5, 293.66 * 2);
-      beeper.Beep(0.5, 329.33 * 2);
-      beeper.Beep(0.5, 261.63 * 2);
-      beeper.Beep(0.5, 130.81 * 2);
-      beeper.Beep(1.0, 196.00 * 2);
+  bool CmdPlay(const char* arg) {
+    if (!arg) {
+      StartOrStopTrack();
       return true;
     }
-
-  if (!strcmp(cmd, "play")) {
-      if (!arg) {
-        StartOrStopTrack();
-        return true;
-      }
-      MountSDCard();
-      EnableAmplifier();
-      RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer();
-      if (player) {
-        STDOUT.print("Playing ");
-        STDOUT.println(arg);
-        if (!player->PlayInCurrentDir(arg))
-          player->Play(arg);
-      } else {
-        STDOUT.println("No available WAV players.");
-      }
-      
-      return true;
+    MountSDCard();
+    EnableAmplifier();
+    RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer();
+    if (player) {
+      STDOUT.print("Playing ");
+      STDOUT.println(arg);
+      if (!player->PlayInCurrentDir(arg))
+        player->Play(arg);
+    } else {
+      STDOUT.println("No available WAV players.");
     }
+    return true;
+  }
 
-
-
-
-
-    if (!strcmp(cmd, "play_track")) {
-      if (!arg) {
-        StartOrStopTrack();
-        return true;
-      }
-      if (track_player_) {
-        track_player_->Stop();
-        track_player_.Free();
-      }
-      MountSDCard();
-      EnableAmplifier();
-      track_player_ = GetFreeWavPlayer();
-      if (track_player_) {
-        STDOUT.print("Playing ");
-        STDOUT.println(arg);
-        if (!track_player_->PlayInCurrentDir(arg))
-          track_player_->Play(arg);
-      } else {
-        STDOUT.println("No available WAV players.");
-      }
-      return true;
-    }
-    if (!strcmp(cmd, "stop_track")) {
-      if (track_player_) {
-        track_player_->Stop();
-        track_player_.Free();
-      }
+  bool CmdPlayTrack(const char* arg) {
+    if (!arg) {
+      StartOrStopTrack();
       return true;
     }
-    if (!strcmp(cmd, "get_track")) {
-      if (track_player_) {
-        STDOUT.println(track_player_->Filename());
-      }
-      return true;
+    if (track_player_) {
+      track_player_->Stop();
+      track_player_.Free();
     }
-#endif
-  
-// #ifndef DISABLE_DIAGNOSTIC_COMMANDS
-#ifdef ENABLE_DIAGNOSE_COMMANDS
-    if (!strcmp(cmd, "volumes")) {
-      for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
-        STDOUT.print(" Unit ");
-        STDOUT.print(unit);
-        STDOUT.print(" Volume ");
-        STDOUT.println(wav_players[unit].volume());
-      }
-      return true;
+    MountSDCard();
+    EnableAmplifier();
+    track_player_ = GetFreeWavPlayer(wp_background);
+    if (track_player_) {
+      STDOUT.print("Playing ");
+      STDOUT.println(arg);
+      if (!track_player_->PlayInCurrentDir(arg))
+        track_player_->Play(arg);
+    } else {
+      STDOUT.println("No available WAV players.");
     }
-#endif // ENABLE_DIAGNOSE_COMMANDS
+    return true;
+  }
 
-#ifdef ENABLE_DEVELOPER_COMMANDS
-    if (!strcmp(cmd, "buffered")) {
-      for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
-        STDOUT.print(" Unit ");
-        STDOUT.print(unit);
-        STDOUT.print(" Buffered: ");
-        STDOUT.println(wav_players[unit].buffered());
-      }
-      return true;
+  bool CmdStopTrack(const char* arg) {
+    if (track_player_) {
+      track_player_->Stop();
+      track_player_.Free();
     }
-#endif // ENABLE_DEVELOPER_COMMANDS
-
-#endif // enable sound
+    return true;
+  }
 
-#ifdef ENABLE_DIAGNOSE_COMMANDS
-    if (!strcmp(cmd, "cd")) {
-      chdir(arg);
-      SaberBase::DoNewFont();
-      return true;
-    }
-#if 0
-    if (!strcmp(cmd, "mkdir")) {
-      SD.mkdir(arg);
-      return true;
-    }
-#endif
-    if (!strcmp(cmd, "pwd")) {
-      for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
-        STDOUT.println(dir);
-      }
-      return true;
-    }
-#endif // ENABLE_DIAGNOSE_COMMANDS
-    if (!strcmp(cmd, "n") || (!strcmp(cmd, "next") && arg && (!strcmp(arg, "preset") || !strcmp(arg, "pre")))) {
-      // next_preset();
-      next_preset_fast();
-      return true;
-    }
-    if (!strcmp(cmd, "p") || (!strcmp(cmd, "prev") && arg && (!strcmp(arg, "preset") || !strcmp(arg, "pre")))) {
-      // previous_preset();
-      previous_preset_fast();
-      return true;
+  bool CmdGetTrack(const char* arg) {
+    if (track_player_) {
+      STDOUT.println(track_player_->Filename());
     }
-  
-
-    if (!strcmp(cmd, "list_presets")) {
-       list_presets();       
-      return true;
-    } 
+    return true;
+  }
 
-    if (!strcmp(cmd, "list_profile")) {
-       list_profile();       
-      return true;
-    } 
+  bool CmdVolumes(const char* arg) {
+    for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
+      STDOUT.print(" Unit ");
+      STDOUT.print(unit);
+      STDOUT.print(" Volume ");
+      STDOUT.println(wav_players[unit].volume());
+    }
+    return true;
+  }
+#endif // ENABLE_AUDIO && ENABLE_DIAGNOSE_COMMANDS
 
-    
-    
-   #ifdef ENABLE_DIAGNOSE_COMMANDS 
-    if (!strcmp(cmd, "show_current_preset")) {
-        current_preset_->Print();
-      return true;
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DEVELOPER_COMMANDS)
+  bool CmdBuffered(const char* arg) {
+    for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
+      STDOUT.print(" Unit ");
+      STDOUT.print(unit);
+      STDOUT.print(" Buffered: ");
+      STDOUT.println(wav_players[unit].buffered());
     }
+    return true;
+  }
+#endif // ENABLE_AUDIO && ENABLE_DEVELOPER_COMMANDS
 
-    // if (!strcmp(cmd, "reload_presets")) {
-    //     STDOUT.Silent(true);
-    //     bool retVal = LoadActivePresets(PROFILE_FILE, userProfile.apID);
-    //     STDOUT.Silent(false);
-    //     if (retVal) STDOUT.println("reload_presets-OK");
-    //     else STDOUT.println("reload_presets-FAIL");
-
-        
-    //     // current_preset_->Print();
-    //   return true;
-    // }
-
-
-    if (!strcmp(cmd, "tell_style")) {
-      #define TELL_BLADE_STYLE(N) do {                                         \
-            STDOUT.print("blade #"); STDOUT.print(N); STDOUT.print(" @ "); STDOUT.print((uint32_t)current_config->blade##N);   \
-            STDOUT.print(" has style: "); STDOUT.print(current_preset_->bladeStyle[N-1]->name); STDOUT.print(" @ "); STDOUT.println((uint32_t)(current_config->blade##N->current_style()));  \
-      } while (0);
-      ONCEPERBLADE(TELL_BLADE_STYLE) 
-      return true;
+#ifdef ENABLE_DIAGNOSE_COMMANDS
+  bool CmdCd(const char* arg) {
+    chdir(arg);
+    SaberBase::DoNewFont();
+    return true;
+  }
+
+  bool CmdPwd(const char* arg) {
+    for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
+      STDOUT.println(dir);
     }
-   #endif // ENABLE_DIAGNOSE_COMMANDS
+    return true;
+  }
 
-  
+  bool CmdShowCurrentPreset(const char* arg) {
+    current_preset_->Print();
+    return true;
+  }
 
-  
+  bool CmdTellStyle(const char* arg) {
+    #define TELL_BLADE_STYLE(N) do {                                         \
+          STDOUT.print("blade #"); STDOUT.print(N); STDOUT.print(" @ "); STDOUT.print((uint32_t)current_config->blade##N);   \
+          STDOUT.print(" has style: "); STDOUT.print(current_preset_->bladeStyle[N-1]->name); STDOUT.print(" @ "); STDOUT.println((uint32_t)(current_config->blade##N->current_style()));  \
+    } while (0);
+    ONCEPERBLADE(TELL_BLADE_STYLE) 
+    return true;
+  }
+#endif // ENABLE_DIAGNOSE_COMMANDS
 
-    if (!strcmp(cmd, "get_usersettings")) {            
-      bool guarded=false;
-      if (arg) {
-        guarded = true;
-        STDOUT.println("get_usersettings-START");
-      }
-      switch(*arg) {
-        case 'V': // get regular volume
-            STDOUT.println(userProfile.combatVolume);  break;            
-        case 'v': // get stealth volume
-            STDOUT.println(userProfile.stealthVolume);  break;
-        case 'B': // get regular brightness
-            STDOUT.println(userProfile.combatBrightness); break;
-        case 'b': // get stealth brightness
-            STDOUT.println(userProfile.stealthBrightness); break;
-        case 's': // get sensitivity
-              // STDOUT.println(userProfile.masterSensitivity); break;
-              STDOUT.println(Sensitivity::master); break;
-        case 'p': // get preset
-            STDOUT.println(userProfile.preset); break;
-        case 0: // get ALL
-            STDOUT.print("  [V] Master volume = "); STDOUT.println(userProfile.combatVolume);
-            STDOUT.print("  [v] Stealth volume = "); STDOUT.println(userProfile.stealthVolume);
-            STDOUT.print("  [B] Master brightness = "); STDOUT.println(userProfile.combatBrightness);
-            STDOUT.print("  [b] Stealth brightness = "); STDOUT.println(userProfile.stealthBrightness);
-            STDOUT.print("  [s] Master sensitivity = "); STDOUT.println(Sensitivity::master); // STDOUT.println(userProfile.masterSensitivity);
-            STDOUT.print("  [p] Preset = "); STDOUT.println(userProfile.preset);
-            break;
-      }
-      if (guarded) STDOUT.println("get_usersettings-END");
-      return true;
+  // "n" / "next pre[set]"
+  bool CmdNextPreset(const char* arg) { next_preset_fast(); return true; }
+  bool CmdNext(const char* arg) {
+    if (!arg || (strcmp(arg, "preset") && strcmp(arg, "pre"))) return false;
+    next_preset_fast();
+    return true;
+  }
+  // "p" / "prev pre[set]"
+  bool CmdPreviousPreset(const char* arg) { previous_preset_fast(); return true; }
+  bool CmdPrev(const char* arg) {
+    if (!arg || (strcmp(arg, "preset") && strcmp(arg, "pre"))) return false;
+    previous_preset_fast();
+    return true;
+  }
 
+  bool CmdListPresets(const char* arg) { list_presets(); return true; }
+  bool CmdListProfile(const char* arg) { list_profile(); return true; }
+  bool CmdListStyles(const char* arg) { list_styles(NULL); return true; }
+  bool CmdListTracks(const char* arg) { list_tracks(NULL); return true; }
+  bool CmdListFonts(const char* arg) { list_fonts(NULL); return true; }
+
+  bool CmdGetUserSettings(const char* arg) {
+    bool guarded=false;
+    if (arg) {
+      guarded = true;
+      STDOUT.println("get_usersettings-START");
+    }
+    switch(arg ? *arg : 0) {
+      case 'V': // get regular volume
+          STDOUT.println(userProfile.combatVolume);  break;            
+      case 'v': // get stealth volume
+          STDOUT.println(userProfile.stealthVolume);  break;
+      case 'B': // get regular brightness
+          STDOUT.println(userProfile.combatBrightness); break;
+      case 'b': // get stealth brightness
+          STDOUT.println(userProfile.stealthBrightness); break;
+      case 's': // get sensitivity
+            // STDOUT.println(userProfile.masterSensitivity); break;
+            STDOUT.println(Sensitivity::master); break;
+      case 'p': // get preset
+          STDOUT.println(userProfile.preset); break;
+      case 0: // get ALL
+          STDOUT.print("  [V] Master volume = "); STDOUT.println(userProfile.combatVolume);
+          STDOUT.print("  [v] Stealth volume = "); STDOUT.println(userProfile.stealthVolume);
+          STDOUT.print("  [B] Master brightness = "); STDOUT.println(userProfile.combatBrightness);
+          STDOUT.print("  [b] Stealth brightness = "); STDOUT.println(userProfile.stealthBrightness);
+          STDOUT.print("  [s] Master sensitivity = "); STDOUT.println(Sensitivity::master); // STDOUT.println(userProfile.masterSensitivity);
+          STDOUT.print("  [p] Preset = "); STDOUT.println(userProfile.preset);
+          break;
     }
+    if (guarded) STDOUT.println("get_usersettings-END");
+    return true;
+  }
 
-    if (!strcmp(cmd, "set_usersettings")) {        
-        uint16_t numVal = atoi(arg+2);    // numerical value, after character identifier and comma
-        switch(*arg) {
-           case 'V': // set volume
-              if (numVal < MIN_MASTER_VOLUME) numVal = 0;
-              userProfile.combatVolume = numVal;  
-              if(!stealthMode) {  // apply volume if currently in use
-                userProfile.masterVolume = numVal;
-                dynamic_mixer.set_volume(VOLUME);
-                #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
-                if (!userProfile.masterVolume) {
-                  SilentEnableAmplifier(false);
-                  SilentEnableBooster(false);
-                }
-                else if (IsOn()) {
-                  SilentEnableAmplifier(true);
-                  SilentEnableBooster(true);
-                }
-                #endif
-              }
-              return true;
-           case 'v': // set stealth volume
-              if (numVal < MIN_MASTER_VOLUME) numVal = 0;
-              if (numVal > userProfile.combatVolume) numVal = userProfile.combatVolume; // limit to regular volume
-              userProfile.stealthVolume = numVal;  
-              if(stealthMode) {  // apply volume if currently in use
-                userProfile.masterVolume = numVal;
-                dynamic_mixer.set_volume(VOLUME);
-                #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
-                if (!userProfile.masterVolume) {
-                  SilentEnableAmplifier(false);
-                  SilentEnableBooster(false);
-                }
-                else if (IsOn()) {
-                  SilentEnableAmplifier(true);
-                  SilentEnableBooster(true);
-                }
-                #endif
-              }
-              return true;
-          case 'B': // set brightness
-              if (numVal < MIN_MASTER_BRIGHTNESS) numVal = 0;
-              userProfile.combatBrightness = numVal;
-              if(!stealthMode) userProfile.masterBrightness = numVal; // apply brightness if currently in use
-              return true;    
-          case 'b': // set stealth brightness
-              if (numVal < MIN_MASTER_BRIGHTNESS) numVal = 0;
-              if (numVal > userProfile.combatBrightness) numVal = userProfile.combatBrightness; // limit to regular brightness
-              userProfile.stealthBrightness = numVal;
-              if(stealthMode) userProfile.masterBrightness = numVal; // apply brightness if currently in use
-              return true;    
-          case 's': // set master sensitivity
-              // userProfile.masterSensitivity = numVal;
-              if (numVal>255) numVal = 255;
-              ApplySensitivities(numVal);       // apply new master sensitivity
-              return true; 
-          case 'p': // set preset
-              if (numVal && numVal<=presets.size()) 
-                  SetPreset(numVal, true);              
-              return true;                         
-        }
+  bool CmdSetUserSettings(const char* arg) {
+    if (!arg) return false;
+    uint16_t numVal = atoi(arg+2);    // numerical value, after character identifier and comma
+    switch(*arg) {
+       case 'V': // set volume
+          if (numVal < MIN_MASTER_VOLUME) numVal = 0;
+          userProfile.combatVolume = numVal;  
+          if(!stealthMode) {  // apply volume if currently in use
+            userProfile.masterVolume = numVal;
+            dynamic_mixer.set_volume(VOLUME);
+            #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
+            if (!userProfile.masterVolume) {
+              SilentEnableAmplifier(false);
+              SilentEnableBooster(false);
+            }
+            else if (IsOn()) {
+              SilentEnableAmplifier(true);
+              SilentEnableBooster(true);
+            }
+            #endif
+          }
+          return true;
+       case 'v': // set stealth volume
+          if (numVal < MIN_MASTER_VOLUME) numVal = 0;
+          if (numVal > userProfile.combatVolume) numVal = userProfile.combatVolume; // limit to regular volume
+          userProfile.stealthVolume = numVal;  
+          if(stealthMode) {  // apply volume if currently in use
+            userProfile.masterVolume = numVal;
+            dynamic_mixer.set_volume(VOLUME);
+            #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
+            if (!userProfile.masterVolume) {
+              SilentEnableAmplifier(false);
+              SilentEnableBooster(false);
+            }
+            else if (IsOn()) {
+              SilentEnableAmplifier(true);
+              SilentEnableBooster(true);
+            }
+            #endif
+          }
+          return true;
+      case 'B': // set brightness
+          if (numVal < MIN_MASTER_BRIGHTNESS) numVal = 0;
+          userProfile.combatBrightness = numVal;
+          if(!stealthMode) userProfile.masterBrightness = numVal; // apply brightness if currently in use
+          return true;    
+      case 'b': // set stealth brightness
+          if (numVal < MIN_MASTER_BRIGHTNESS) numVal = 0;
+          if (numVal > userProfile.combatBrightness) numVal = userProfile.combatBrightness; // limit to regular brightness
+          userProfile.stealthBrightness = numVal;
+          if(stealthMode) userProfile.masterBrightness = numVal; // apply brightness if currently in use
+          return true;    
+      case 's': // set master sensitivity
+          // userProfile.masterSensitivity = numVal;
+          if (numVal>255) numVal = 255;
+          ApplySensitivities(numVal);       // apply new master sensitivity
+          return true; 
+      case 'p': // set preset
+          if (numVal && numVal<=presets.size()) 
+              SetPreset(numVal, true);              
+          return true;                         
     }
+    return false;
+  }
 
- if (!strcmp(cmd, "get_sensitivity")) {            
-      bool guarded=false;
-      if (arg) {
-        guarded = true;
-        STDOUT.println("get_sensitivity-START");
-      }
-      switch(*arg) {
-        case 's':   // get swing sensitivity
-            STDOUT.println(userProfile.swingSensitivity.userSetting);  break;               
-        case 'c':   // get clash sensitivity
-            STDOUT.println(userProfile.clashSensitivity.userSetting);  break;               
-        case 'b':   // get stab sensitivity
-            STDOUT.println(userProfile.stabSensitivity.userSetting);  break;
-        case 'k':   // get shake sensitivity
-            STDOUT.println(userProfile.shakeSensitivity.userSetting);  break;
-        case 't':   // get double-tap sensitivity
-            STDOUT.println(userProfile.tapSensitivity.userSetting);  break;
-        case 'w':   // get twist sensitivity
-            STDOUT.println(userProfile.twistSensitivity.userSetting);  break;
-        case 'm':   // get menu sensitivity
-            STDOUT.println(userProfile.menuSensitivity.userSetting);  break;
-        case 0: // get ALL     
-          STDOUT.print("  MASTER = "); STDOUT.println(Sensitivity::master);
-          STDOUT.print("  [s] Swing = "); STDOUT.print(userProfile.swingSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.swingSensitivity.ApplyMaster());
-          STDOUT.print("  [c] Clash = "); STDOUT.print(userProfile.clashSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.clashSensitivity.ApplyMaster());
-          STDOUT.print("  [b] Stab = "); STDOUT.print(userProfile.stabSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.stabSensitivity.ApplyMaster());
-          STDOUT.print("  [k] Shake = "); STDOUT.print(userProfile.shakeSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.shakeSensitivity.ApplyMaster());
-          STDOUT.print("  [t] Tap = "); STDOUT.print(userProfile.tapSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.tapSensitivity.ApplyMaster());
-          STDOUT.print("  [w] Twist = "); STDOUT.print(userProfile.twistSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.twistSensitivity.ApplyMaster());
-          STDOUT.print("  [m] Menu = "); STDOUT.print(userProfile.menuSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.menuSensitivity.ApplyMaster());
-          break;         
-
-      }
-      if (guarded) STDOUT.println("get_sensitivity-END");
-      return true;
-    }
+  bool CmdGetSensitivity(const char* arg) {
+    bool guarded=false;
+    if (arg) {
+      guarded = true;
+      STDOUT.println("get_sensitivity-START");
+    }
+    switch(arg ? *arg : 0) {
+      case 's':   // get swing sensitivity
+          STDOUT.println(userProfile.swingSensitivity.userSetting);  break;               
+      case 'c':   // get clash sensitivity
+          STDOUT.println(userProfile.clashSensitivity.userSetting);  break;               
+      case 'b':   // get stab sensitivity
+          STDOUT.println(userProfile.stabSensitivity.userSetting);  break;
+      case 'k':   // get shake sensitivity
+          STDOUT.println(userProfile.shakeSensitivity.userSetting);  break;
+      case 't':   // get double-tap sensitivity
+          STDOUT.println(userProfile.tapSensitivity.userSetting);  break;
+      case 'w':   // get twist sensitivity
+          STDOUT.println(userProfile.twistSensitivity.userSetting);  break;
+      case 'm':   // get menu sensitivity
+          STDOUT.println(userProfile.menuSensitivity.userSetting);  break;
+      case 0: // get ALL     
+        STDOUT.print("  MASTER = "); STDOUT.println(Sensitivity::master);
+        STDOUT.print("  [s] Swing = "); STDOUT.print(userProfile.swingSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.swingSensitivity.ApplyMaster());
+        STDOUT.print("  [c] Clash = "); STDOUT.print(userProfile.clashSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.clashSensitivity.ApplyMaster());
+        STDOUT.print("  [b] Stab = "); STDOUT.print(userProfile.stabSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.stabSensitivity.ApplyMaster());
+        STDOUT.print("  [k] Shake = "); STDOUT.print(userProfile.shakeSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.shakeSensitivity.ApplyMaster());
+        STDOUT.print("  [t] Tap = "); STDOUT.print(userProfile.tapSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.tapSensitivity.ApplyMaster());
+        STDOUT.print("  [w] Twist = "); STDOUT.print(userProfile.twistSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.twistSensitivity.ApplyMaster());
+        STDOUT.print("  [m] Menu = "); STDOUT.print(userProfile.menuSensitivity.userSetting); STDOUT.print(", rescaled by master to "); STDOUT.println(userProfile.menuSensitivity.ApplyMaster());
+        break;         
+
+    }
+    if (guarded) STDOUT.println("get_sensitivity-END");
+    return true;
+  }
 
-    if (!strcmp(cmd, "set_sensitivity")) {        
+  bool CmdSetSensitivity(const char* arg) {
+        if (!arg) return false;
         uint16_t numVal = atoi(arg+2);    // numerical value, after character identifier and comma
         if (numVal>255) numVal = 255;
         switch(*arg) {
@@ -1502,67 +1483,35 @@ void Detect2Tap(float acc)  {  // Got acceleration resultant from DoAccel()
               STDOUT.print(" Stable time = "); STDOUT.println(userProfile.menuSensitivity.stableTime);
               return true;                                                                                     
         }
-    }         
-
-
-
-
-
-    if (!strcmp(cmd, "save_profile")) {     // save profile (including color variations) to profile.cod
-        if (WriteUserProfile(PROFILE_FILE, 1))
-          STDOUT.println("save_profile-OK");
-        else
-          STDOUT.println("save_profile-FAIL");
-        return true;
-    }
-
-
-    if (!strcmp(cmd, "get_color")) {
-        STDOUT.println("get_color-START");
-        if(current_preset_)
-          STDOUT.println(current_preset_->variation);
-        STDOUT.println("get_color-END");
-        return true;
-    }
-
-    if (!strcmp(cmd, "set_color")) {
-        if (arg) {  // set color variation
-          size_t variation = strtol(arg, NULL, 0);
-          current_preset_->variation = variation;
-          SaberBase::SetVariation(variation);
-        }
-        return true;
-    }
-
-   
-
-
-      
-
-
+        return false;
+  }
 
-  
-    if (!strcmp(cmd, "list_styles")) {
-      list_styles(NULL);
+  bool CmdSaveProfile(const char* arg) {     // save profile (including color variations) to profile.cod
+      if (WriteUserProfile(PROFILE_FILE, 1, true))      // the app reads profile.cod, don't leave changes in the journal
+        STDOUT.println("save_profile-OK");
+      else
+        STDOUT.println("save_profile-FAIL");
       return true;
-    }
+  }
 
-    if (!strcmp(cmd, "list_tracks")) {
-      list_tracks(NULL);
+  bool CmdGetColor(const char* arg) {
+      STDOUT.println("get_color-START");
+      if(current_preset_)
+        STDOUT.println(current_preset_->variation);
+      STDOUT.println("get_color-END");
       return true;
-    }
+  }
 
-    if (!strcmp(cmd, "list_fonts")) {
-      list_fonts(NULL);  
+  bool CmdSetColor(const char* arg) {
+      if (arg) {  // set color variation
+        size_t variation = strtol(arg, NULL, 0);
+        current_preset_->variation = variation;
+        SaberBase::SetVariation(variation);
+      }
       return true;
-    }  
-
-
-
-  return false;
-
   }
 
+
   void list_styles(FileReader* fileWriter)
   {   
       if(fileWriter)LOCK_SD(true);
@@ -1725,22 +1674,7 @@ void list_profile(FileReader* fileWriter = 0) {
           // parse menu commands as well, if needed
           if (menu) menu->Help();
         #endif
-          STDOUT.println(" clash - trigger a clash");
-          STDOUT.println(" on/off - turn saber on/off");
-          STDOUT.println(" force - trigger a force push");
-          STDOUT.println(" blast - trigger a blast");
-          STDOUT.println(" stab - trigger a stab");
-          STDOUT.println(" lock - begin/end lockup");
-          STDOUT.println(" lblock/lb - begin/end lightning block");
-          STDOUT.println(" melt - begin/end melt");
-      #ifdef ENABLE_AUDIO
-          STDOUT.println(" pwd - print current directory");
-          STDOUT.println(" cd directory - change directory, and sound font");
-          STDOUT.println(" play filename - play file");
-          STDOUT.println(" next/prev font - walk through directories in alphabetical order");
-          STDOUT.println(" next/prev pre[set] - walk through presets.");
-          STDOUT.println(" beep - play a beep");
-      #endif
+          commands_.Help();
     #endif
   }
 
@@ -1778,6 +1712,12 @@ virtual bool Event(enum BUTTON button, EVENT event) {
         clash_pending_ = false;
       case EVENT_PRESSED:
         IgnoreClash(50); // ignore clashes to prevent buttons from causing clashes
+        #ifdef ULTRAPROFFIE
+          // Power button pressed while off: ignition is likely once it's released or held.
+          // The domains power down on their own after the intent timeout if it doesn't come.
+          if (event == EVENT_PRESSED && button == BUTTON_POWER && !IsOn())
+            powerman.Anticipate(intent_ignite);
+        #endif
         break;
     }
 
@@ -1797,7 +1737,11 @@ virtual bool Event(enum BUTTON button, EVENT event) {
 
   virtual bool Event2(enum BUTTON button, EVENT event, uint32_t modifiers) = 0;
 
+  static const CommandEntry<PropBase> commandList_[];    // public for the static_assert on its order
+
 protected: // was private:
+  static const CommandTable<PropBase> commands_;
+
   bool CommonIgnition() {
     if (IsOn()) return false;
     if (current_style() && current_style()->NoOnOff())
@@ -1830,4 +1774,71 @@ public: // was protected
   LoopCounter accel_loop_counter_;
 };
 
+// PropBase commands, SORTED BY NAME (strcmp order, '_' comes before letters), see static_assert below
+constexpr CommandEntry<PropBase> PropBase::commandList_[] = {
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  { "beep",                &PropBase::CmdBeep,              " beep - play a beep" },
+#endif
+  { "blast",               &PropBase::CmdBlast,             " blast - trigger a blast" },
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DEVELOPER_COMMANDS)
+  { "buffered",            &PropBase::CmdBuffered,          " buffered - show wav players buffer levels" },
+#endif
+#ifdef ENABLE_DIAGNOSE_COMMANDS
+  { "cd",                  &PropBase::CmdCd,                " cd directory - change directory, and sound font" },
+#endif
+  { "clash",               &PropBase::CmdClash,             " clash - trigger a clash" },
+  { "drag",                &PropBase::CmdDrag,              " drag - begin/end drag" },
+  { "force",               &PropBase::CmdForce,             " force - trigger a force push" },
+  { "get_color",           &PropBase::CmdGetColor,          nullptr },
+  { "get_on",              &PropBase::CmdGetOn,             nullptr },
+  { "get_sensitivity",     &PropBase::CmdGetSensitivity,    nullptr },
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  { "get_track",           &PropBase::CmdGetTrack,          nullptr },
+#endif
+  { "get_usersettings",    &PropBase::CmdGetUserSettings,   nullptr },
+  { "lb",                  &PropBase::CmdLightningBlock,    nullptr },
+  { "lblock",              &PropBase::CmdLightningBlock,    " lblock/lb - begin/end lightning block" },
+  { "list_fonts",          &PropBase::CmdListFonts,         nullptr },
+  { "list_presets",        &PropBase::CmdListPresets,       nullptr },
+  { "list_profile",        &PropBase::CmdListProfile,       nullptr },
+  { "list_styles",         &PropBase::CmdListStyles,        nullptr },
+  { "list_tracks",         &PropBase::CmdListTracks,        nullptr },
+  { "lock",                &PropBase::CmdLockup,            " lock - begin/end lockup" },
+  { "lockup",              &PropBase::CmdLockup,            nullptr },
+  { "melt",                &PropBase::CmdMelt,              " melt - begin/end melt" },
+  { "n",                   &PropBase::CmdNextPreset,        nullptr },
+  { "next",                &PropBase::CmdNext,              " next/prev pre[set] (or n/p) - walk through presets" },
+  { "off",                 &PropBase::CmdOff,               nullptr },
+  { "on",                  &PropBase::CmdOn,                " on/off - turn saber on/off" },
+  { "p",                   &PropBase::CmdPreviousPreset,    nullptr },
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  { "play",                &PropBase::CmdPlay,              " play filename - play file" },
+  { "play_track",          &PropBase::CmdPlayTrack,         " play_track/stop_track [filename] - start/stop track" },
+#endif
+  { "prev",                &PropBase::CmdPrev,              nullptr },
+#ifdef ENABLE_DIAGNOSE_COMMANDS
+  { "pwd",                 &PropBase::CmdPwd,               " pwd - print current directory" },
+#endif
+  { "save_profile",        &PropBase::CmdSaveProfile,       nullptr },
+  { "set_color",           &PropBase::CmdSetColor,          nullptr },
+  { "set_sensitivity",     &PropBase::CmdSetSensitivity,    nullptr },
+  { "set_usersettings",    &PropBase::CmdSetUserSettings,   nullptr },
+#ifdef ENABLE_DIAGNOSE_COMMANDS
+  { "show_current_preset", &PropBase::CmdShowCurrentPreset, nullptr },
+#endif
+  { "stab",                &PropBase::CmdStab,              " stab - trigger a stab" },
+  { "stealth",             &PropBase::CmdStealth,           " stealth - toggle stealth mode" },
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  { "stop_track",          &PropBase::CmdStopTrack,         nullptr },
+#endif
+#ifdef ENABLE_DIAGNOSE_COMMANDS
+  { "tell_style",          &PropBase::CmdTellStyle,         nullptr },
+#endif
+#if defined(ENABLE_AUDIO) && defined(ENABLE_DIAGNOSE_COMMANDS)
+  { "volumes",             &PropBase::CmdVolumes,           nullptr },
+#endif
+};
+static_assert(CommandsSorted(PropBase::commandList_), "PropBase::commandList_ must be sorted by name");
+const CommandTable<PropBase> PropBase::commands_(PropBase::commandList_);
+
 #endif
@@ -1089,6 +1089,9 @@ void MenuChangerDestroyer(MenuPreActions *mPreActions)
     if(!menu) { // create navigator only if there is none active 
       menu = new TTMenu<uint16_t>(); 
       if(!menu) return -1; 
+      #ifdef ULTRAPROFFIE
+        powerman.Anticipate(intent_menu);   // voice prompts will follow
+      #endif
       return 1;
     }
     return 0;
@@ -37,6 +37,11 @@ public:
     return false;
   }
 
+  // Nothing to do while off and silent: a sound starting makes Active() true
+  uint32_t IdleMicros() override {
+    return Active() || on_ ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+  }
+
   void Enable() {
     // dac.begin();
     last_enabled_ = millis();
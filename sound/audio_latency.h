@@ -0,0 +1,110 @@
+#ifndef SOUND_AUDIO_LATENCY_H
+#define SOUND_AUDIO_LATENCY_H
+
+// Audio latency mode.
+//
+// Three buffers sit between a triggered effect and the speaker: the DAC DMA
+// half-buffer, the samples each BufferedWavPlayer keeps ahead of the mixer and
+// the PlayWav read chunk. Their sizes are compile-time maximums tuned for
+// throughput; low latency lowers the limits used inside them, all together:
+//  - DAC block: LS_DAC::SetBlock(), applied while the output is silent
+//  - stream: BufferedAudioStream stops refilling at audioLatency.stream samples
+//  - chunk: PlayWav reads at most audioLatency.chunk bytes from the file
+// Smaller reads also mean the refill interrupt comes back sooner to whichever
+// player has the emptiest buffer, which is the one it serves first.
+//
+// The mode comes from the install file (installConfig.audioLatency); "latency"
+// changes it at runtime. If the mixer underflows more than
+// AUDIO_LATENCY_MAX_UNDERFLOWS times within AUDIO_LATENCY_WINDOW ms in low
+// latency, the mode falls back to normal until it is set again.
+
+#ifndef AUDIO_LOW_LATENCY_BLOCK
+#define AUDIO_LOW_LATENCY_BLOCK 16      // DMA half-buffer [samples], multiple of 4
+#endif
+#ifndef AUDIO_LOW_LATENCY_STREAM
+#define AUDIO_LOW_LATENCY_STREAM 256    // samples buffered per wav player
+#endif
+#ifndef AUDIO_LOW_LATENCY_CHUNK
+#define AUDIO_LOW_LATENCY_CHUNK 256     // bytes per file read, up to 512
+#endif
+#define AUDIO_LATENCY_MAX_UNDERFLOWS 8
+#define AUDIO_LATENCY_WINDOW 1000       // [ms]
+
+enum AudioLatency : uint8_t {
+  latency_normal = 0,
+  latency_low
+};
+
+// Limits read by the audio code; set only through AudioLatencyControl.
+struct {
+  volatile uint16_t stream = 0xFFFF;  // samples buffered per stream, 0xFFFF = whole buffer
+  volatile uint16_t chunk = 512;      // bytes per PlayWav read, 512 = whole PlayWav buffer
+} audioLatency;
+
+class AudioLatencyControl : CommandParser, Looper {
+public:
+  AudioLatencyControl() : CommandParser(), Looper() {}
+  const char* name() override { return "AudioLatency"; }
+
+  void Set(AudioLatency mode) {
+    mode_ = mode == latency_low ? latency_low : latency_normal;
+    bool low = mode_ == latency_low;
+    audioLatency.stream = low ? AUDIO_LOW_LATENCY_STREAM : 0xFFFF;
+    audioLatency.chunk = low ? std::min(AUDIO_LOW_LATENCY_CHUNK, 512) : 512;
+#ifndef ARDUINO_ARCH_ESP32
+    dac.SetBlock(low ? AUDIO_LOW_LATENCY_BLOCK : AUDIO_BUFFER_SIZE);
+#endif
+    window_start_ = millis();
+    window_underflows_ = dynamic_mixer.underflow_count_.get();
+  }
+  AudioLatency mode() const { return mode_; }
+
+  // Underflows only happen while audio runs, which keeps the CPU awake anyway
+  uint32_t IdleMicros() override { return LOOPER_IDLE_FOREVER; }
+
+  void Loop() override {
+    if (mode_ != latency_low) return;
+    uint32_t underflows = dynamic_mixer.underflow_count_.get() - window_underflows_;
+    if (underflows > AUDIO_LATENCY_MAX_UNDERFLOWS) {
+      Set(latency_normal);
+  #if defined(DIAGNOSE_AUDIO)
+      STDOUT.print("Audio underflows: "); STDOUT.print(underflows);
+      STDOUT.println(", back to normal latency.");
+  #endif
+      return;
+    }
+    if (millis() - window_start_ > AUDIO_LATENCY_WINDOW) {
+      window_start_ = millis();
+      window_underflows_ += underflows;
+    }
+  }
+
+  bool Parse(const char* cmd, const char* arg) override {
+    if (strcmp(cmd, "latency")) return false;
+    if (arg && !strcmp(arg, "low")) Set(latency_low);
+    else if (arg && !strcmp(arg, "normal")) Set(latency_normal);
+    STDOUT.print("Audio latency: ");
+    STDOUT.print(mode_ == latency_low ? "low" : "normal");
+#ifndef ARDUINO_ARCH_ESP32
+    STDOUT.print(", DAC block "); STDOUT.print(dac.block());
+#endif
+    STDOUT.print(", stream "); STDOUT.print(audioLatency.stream);
+    STDOUT.print(", chunk "); STDOUT.println(audioLatency.chunk);
+    return true;
+  }
+
+  void Help() override {
+    #if defined(COMMANDS_HELP)
+    STDOUT.println(" latency [low|normal] - show / set the audio latency mode");
+    #endif
+  }
+
+private:
+  AudioLatency mode_ = latency_normal;
+  uint32_t window_start_ = 0;
+  uint32_t window_underflows_ = 0;    // mixer underflow count when the window started
+};
+
+AudioLatencyControl audio_latency;
+
+#endif
@@ -50,7 +50,7 @@ public:
   static void LockSD(bool locked) {
 //    scheduleFillBuffer();
     sd_locked.set(locked);
-    if (locked) MountSDCard();
+    if (locked) MountSDCardSync();    // callers open files right after locking
   }
 
   static void LockSD_nomount(bool locked) {
@@ -83,6 +83,7 @@ private:
       fill_buffers_pending_.set(false);
       return;
     }
+    TRACE(trc_audio, tr_refill, 0);
 #if 1
     // Yes, it's a selection sort, luckily there's not a lot of
     // AudioStreamWork instances.
@@ -104,6 +105,7 @@ private:
     }
 #endif
     fill_buffers_pending_.set(false);
+    TRACE(trc_audio, tr_refill | tr_end, 0);
   }
 
   static POAtomic<bool> sd_locked;
@@ -4,54 +4,91 @@
 #include "../common/circular_buffer.h"
 
 // Beeper class, used for warning beeps and such.
+//
+// Notes play from band-limited square wavetables: the table with the most
+// harmonics that stay below BEEPER_MAX_HARMONIC_HZ is picked per note.
+// Each note has a piecewise linear envelope (attack, sustain, release).
+// read() renders whole spans between note and envelope boundaries, which
+// fall on exact sample positions.
+
+#define BEEPER_TABLE_BITS       7
+#define BEEPER_TABLE_SIZE       (1 << BEEPER_TABLE_BITS)
+#define BEEPER_LEVELS           5       // tables with 1, 3, 7, 15 and 31 harmonics
+#define BEEPER_MAX_HARMONIC_HZ  18000
+#define BEEPER_AMPLITUDE        200     // peak, as loud as the old square wave
+#define BEEPER_RAMP             (AUDIO_RATE / 500)  // 2ms attack and release: no clicks
+
+enum BeepEnvelope : uint8_t {
+  beep_flat = 0,      // BEEPER_RAMP attack and release
+  beep_decay,         // fades out over the whole note
+  beep_swell          // fades in over the whole note
+};
+
+// One step of a note sequence for Beeper::Play()
+struct BeepNote {
+  uint16_t ms;        // 0 = end of sequence
+  uint16_t hz;        // 0 = silence
+  BeepEnvelope envelope;
+};
+
 class Beeper : public ProffieOSAudioStream {
 public:
-  Beeper() : ProffieOSAudioStream(), x_(0), value_(0) {}
+  Beeper() : ProffieOSAudioStream() {}
 
   int read(int16_t *data, int elements) override {
-    
     int e = elements;
-    while (beeps_.size()) {
-      int s = std::min(elements, beeps_.current().samples_);
-      if (x_.get() == 0) {
-        x_.set(beeps_.current().f_);
-	if (x_.get() == 0) {
-	  x_.set(beeps_.current().samples_);
-	  value_.set(0);
-	} else {
-	  if (value_.get() <= 0) {
-	    value_.set(200);
-	  } else {
-	    value_.set(-200);
-	  }
-	}
-      }
-      s = std::min<int>(s, (int)x_.get());
-      if (s <= 0) return e - elements;
-      for (int i = 0; i < s; i++) data[i] = value_.get();
+    while (beeps_.size() && elements) {
+      Note& note = beeps_.current();
+      if (pos_ == 0) StartNote(note);
+      // Span up to the next boundary: end of attack, start of release, end of note
+      int end = pos_ < note.attack_ ? note.attack_ :
+                pos_ < note.samples_ - note.release_ ? note.samples_ - note.release_ : note.samples_;
+      int s = std::min(elements, end - pos_);
+      if (note.inc_) RenderSpan(data, s, note);
+      else for (int i = 0; i < s; i++) data[i] = 0;
       data += s;
       elements -= s;
-      x_ -= s;
-      beeps_.current().samples_ -= s;
-      if (beeps_.current().samples_ == 0) {
-	beeps_.pop();
+      pos_ += s;
+      if (pos_ == end) {
+        if (pos_ >= note.samples_) {
+          beeps_.pop();
+          pos_ = 0;
+        } else {
+          NextSegment(note);
+        }
       }
     }
     return e - elements;
   }
 
-  void Beep(float length, float freq) {
+  void Beep(float length, float freq, BeepEnvelope envelope = beep_flat) {
     EnableAmplifier();
-    if (beeps_.space_available()) {
-      beeps_.next().f_ = freq == 0.0 ? 0 : AUDIO_RATE / freq / 2.0;
-      beeps_.next().samples_ = AUDIO_RATE * length;
-      beeps_.push();
+    if (!beeps_.space_available()) return;
+    BuildTables();
+    Note& note = beeps_.next();
+    note.samples_ = AUDIO_RATE * length;
+    note.inc_ = freq <= 0.0 ? 0 : freq * (4294967296.0 / AUDIO_RATE);
+    uint8_t level = 0;
+    while (level + 1 < BEEPER_LEVELS && Harmonics(level + 1) * freq < BEEPER_MAX_HARMONIC_HZ) level++;
+    note.table_ = level;
+    int ramp = std::min<int>(BEEPER_RAMP, note.samples_ / 2);
+    switch (envelope) {
+      case beep_decay: note.attack_ = ramp; note.release_ = note.samples_ - ramp; break;
+      case beep_swell: note.attack_ = note.samples_ - ramp; note.release_ = ramp; break;
+      default: note.attack_ = note.release_ = ramp; break;
     }
+    beeps_.push();
   }
   void Silence(float length) {
     Beep(length, 0.0);
   }
 
+  // Queue a sequence, up to the first note with ms = 0.
+  void Play(const BeepNote* notes) {
+    for (; notes->ms; notes++)
+      Beep(notes->ms / 1000.0f, notes->hz, notes->envelope);
+  }
+
   bool isPlaying() {
     return beeps_.size() > 0;
   }
@@ -61,13 +98,81 @@ public:
   }
 
 private:
-  struct Beep {
-    int f_ = 0;
+  struct Note {
     int samples_ = 0;
+    int attack_ = 0;      // samples fading in
+    int release_ = 0;     // samples fading out, at the end
+    uint32_t inc_ = 0;    // phase increment per sample, 0 = silence
+    uint8_t table_ = 0;
   };
-  CircularBuffer<struct Beep, 16> beeps_;
-  POAtomic<int> x_;
-  POAtomic<int> value_;
+
+  static int Harmonics(uint8_t level) { return (2 << level) - 1; }
+
+  // Band-limited squares, peak normalized to 32767. Built once, from the main loop.
+  static void BuildTables() {
+    if (tables_built_) return;
+    for (uint8_t level = 0; level < BEEPER_LEVELS; level++) {
+      float wave[BEEPER_TABLE_SIZE];
+      float peak = 0;
+      for (int i = 0; i < BEEPER_TABLE_SIZE; i++) {
+        float sum = 0;
+        for (int h = 1; h <= Harmonics(level); h += 2)
+          sum += sinf(2 * M_PI * h * i / BEEPER_TABLE_SIZE) / h;
+        wave[i] = sum;
+        peak = std::max(peak, fabsf(sum));
+      }
+      for (int i = 0; i < BEEPER_TABLE_SIZE; i++)
+        tables_[level][i] = wave[i] * 32767 / peak;
+    }
+    tables_built_ = true;
+  }
+
+  // Gain is BEEPER_AMPLITUDE << 16 at full level
+  void StartNote(const Note& note) {
+    phase_ = 0;
+    gain_ = 0;
+    step_ = note.attack_ ? (BEEPER_AMPLITUDE << 16) / note.attack_ : 0;
+    if (!note.attack_) NextSegment(note);
+  }
+
+  void NextSegment(const Note& note) {
+    if (pos_ < note.samples_ - note.release_) {     // sustain
+      gain_ = BEEPER_AMPLITUDE << 16;
+      step_ = 0;
+    } else {                                        // release
+      step_ = note.release_ ? -gain_ / note.release_ : 0;
+    }
+  }
+
+  void RenderSpan(int16_t* data, int n, const Note& note) {
+    const int16_t* table = tables_[note.table_];
+    uint32_t phase = phase_;
+    int32_t gain = gain_;
+    for (int i = 0; i < n; i++) {
+      uint32_t idx = phase >> (32 - BEEPER_TABLE_BITS);
+      int32_t frac = (phase >> (32 - BEEPER_TABLE_BITS - 15)) & 0x7FFF;
+      int32_t a = table[idx];
+      int32_t b = table[(idx + 1) & (BEEPER_TABLE_SIZE - 1)];
+      int32_t s = a + (((b - a) * frac) >> 15);
+      data[i] = (s * (gain >> 16)) >> 15;
+      phase += note.inc_;
+      gain += step_;
+    }
+    phase_ = phase;
+    gain_ = gain;
+  }
+
+  CircularBuffer<Note, 16> beeps_;
+  int pos_ = 0;           // samples played of the current note
+  uint32_t phase_ = 0;
+  int32_t gain_ = 0;
+  int32_t step_ = 0;      // gain change per sample
+
+  static int16_t tables_[BEEPER_LEVELS][BEEPER_TABLE_SIZE];
+  static bool tables_built_;
 };
 
+int16_t Beeper::tables_[BEEPER_LEVELS][BEEPER_TABLE_SIZE];
+bool Beeper::tables_built_ = false;
+
 #endif
@@ -72,7 +72,9 @@ public:
 private:
   size_t real_space_available() const {
     if (eof_.get() || !stream_.get()) return 0;
-    return N - buffered();
+    int limit = std::min<int>(N, audioLatency.stream);   // lower in low latency mode
+    int b = buffered();
+    return b < limit ? limit - b : 0;
   }
   bool FillBuffer() override {
     if (stream_.get())  {
@@ -70,49 +70,6 @@ public:
     return false;
   }
 
-// Looper task for repeating sounds at a time period longer than sound duration
-// TODO: scrap this whole mess and put a propper wav player instead
-class RepeatTask : public Looper {
-public: 
-  bool running;
-  uint32_t longRepeatTime;
-private: 
-  uint32_t lastRepeatTime;
-  BufferedWavPlayer* player;
-  Effect* effect;
-public:
-  RepeatTask () : Looper(1000) { running = false; }  // schedule by looper at 1 ms
-  
-  const char* name() override { return "WAV Repeat Task"; }
-
-  void Set(BufferedWavPlayer* player_, Effect* effect_, uint32_t repeatTime_) {
-    player = player_;
-    effect = effect_;
-    if (!repeatTime_) repeatTime_ = 1;
-    longRepeatTime = repeatTime_;
-    lastRepeatTime = millis();    // more or less...
-  }
-
-  void Start() {  running = true; }
-
-  void Stop() { running = false; }
-
-
-  void Loop() override { 
-    if (running) {
-      uint32_t timeNow = millis();
-      if (timeNow - lastRepeatTime >= longRepeatTime) {
-          lastRepeatTime = timeNow;
-          if (player)player->PlayOnce(effect);
-      }
-    }
-  };
-
-};
-
-    RepeatTask* repeater;
-
-
   void UpdateSaberBaseSoundInfo() {
     SaberBase::sound_length = length();
     SaberBase::sound_number = current_file_id().GetFileNum();
@@ -174,10 +131,13 @@ public:
   }
   
   bool isPlaying() const {
-    if (repeatingEff) return true;    // keep active if repeating
     return !pause_.get() && (wav.isPlaying() || buffered());
   }
 
+  bool OnSD() {
+    return !pause_.get() && wav.OnSD();
+  }
+
   BufferedWavPlayer() : VolumeOverlay(),  pause_(true) { SetStream(&wav);  }
   
 
@@ -253,20 +213,8 @@ bool PlayEffect(Effect* soundEffect, int soundID=-1, uint16_t repeat=0, float vo
     // 3. Set repeat
     if (repeat) repeatingEff = soundEffect;  // store repeating effect for any type of repeat, so we can change rate later
     else repeatingEff = 0;
-    if (repeater) repeater->Stop();           // stop long repeat task
-    wav.delayedRepeat = 0;                    // assume no repeat
-    wav.PlayNext(soundEffect);                // but assign an effect so SetRepeat knows what to work with
-    if (!repeat || repeat==1) {  // No repeat or loop: apply now
-        // if (repeater) repeater->Stop();        // stop repeat task, certainly not needed
-        wav.SetRepeat(repeat);
-    }
-    else { // Timed repeat: apply after start reading the file, so we can know its length
-        if (!repeater) repeater = new RepeatTask();       // prepare a repeat task now, just in case it's a long repeat  
-        repeater->Set(this, soundEffect, repeat);
-        soundEffect->SetFollowing(soundEffect);   // PlayOnce will set effect_ to soundEffect, the delayed SetRepeat will need it
-        wav.delayedRepeat = repeat;               // loop() will call SetRepeat later, triggered by ISR. delayedRepeat holds the requested repeat time
-        wav.longRepeat = &repeater->running;      // magic glue
-    }
+    wav.PlayNext(soundEffect);                // assign the effect so SetRepeat knows what to work with
+    wav.SetRepeat(repeat);                    // the period is counted in samples, no need to know the length first
     interrupts();
     // if (!pause_ && (wav.isPlaying() || buffered())) FadeAndPlay(soundEffect); 
     // else PlayOnce(soundEffect);
@@ -280,76 +228,18 @@ bool PlayEffect(Effect* soundEffect, int soundID=-1, uint16_t repeat=0, float vo
   // uint8_t Repeating() { return wav.Repeating(); }
 
   // 0: no repeat; 1: loop; >1: repeat at 'milli' milliseconds
+  // The wav player applies the new period to the repeat in progress, no restart needed.
   void ChangeRepeatTime(uint16_t milli) {
-    // 1. Stop
     if (!repeatingEff) return;          // nothing to do, no repeat active 
+    noInterrupts();
     if (!milli) {
-        // STDOUT.println("any repeat -> no repeat");
-        // if (repeater) repeater->Stop();
-        if (wav.longRepeat) *(wav.longRepeat) = 0;    //  stop repeater and prevent long repeat
-        wav.shortRepeatTime = 0;  // prevent short repeat
-        wav.effect_ = 0;          // prevent looping
-        wav.longRepeat = 0;       // signal no repeating
+        wav.repeat_samples_ = 0;  // prevent timed repeat
+        wav.effect_.set(nullptr); // prevent looping, let the current sound end
         repeatingEff = 0;         
-        return;
-    }
-    
-    
-    noInterrupts();
-    uint32_t soundDuration = 1000 * length();
-    // STDOUT.print("[ChangeRepeatTime] change to "); STDOUT.print(milli); STDOUT.print(", sound duration = "); STDOUT.print(soundDuration); STDOUT.print("[ms]: ");
-    if (*(wav.longRepeat)) { // currently on long repeat 
-        if (milli == 1 || milli == soundDuration) {
-            // STDOUT.println("long -> loop");
-            wav.effect_.set(repeatingEff);
-            wav.effect_.get()->SetFollowing(repeatingEff);
-            *(wav.longRepeat) = false ;    // stop RepeatTask
-            // repeater->Stop();
-        }
-        else if (milli > soundDuration) {
-            // STDOUT.println("long -> long");
-            repeater->longRepeatTime = milli;
-        }
-        else {
-            // STDOUT.println("long -> short");
-            PlayEffect(repeatingEff, 0, milli);  // TODO: smooth transition
-        }
-    }
-    else if (wav.shortRepeatTime) { // currently on short repeat
-        if (milli == 1 || milli == soundDuration) {
-            // STDOUT.println("short -> loop");
-            wav.shortRepeatTime = 0;
-        }
-        else if (milli > soundDuration) {
-            // STDOUT.println("short -> long");
-            wav.shortRepeatTime = 0;    // stop short
-            wav.effect_.get()->SetFollowing(0);
-            wav.effect_.set(nullptr);            // prevent looping 
-            if (!repeater) repeater = new RepeatTask();
-            else repeater->Stop();
-            repeater->Set(this, repeatingEff, milli);
-            wav.longRepeat = &repeater->running;      // magic glue
-            *(wav.longRepeat) = true;                 // also starts repeater
-            // repeater->Start();
-        }
-        else {
-            // STDOUT.println("short -> short");
-            wav.shortRepeatTime = milli+1;
-        }    
     }
-    else { // currently looping
-        if (milli == 1 || milli == soundDuration) {
-            // STDOUT.println("loop -> loop, do nothing");
-        }
-        else if (milli > soundDuration) {
-            // STDOUT.println("loop -> long");
-            PlayEffect(repeatingEff, 0, milli);
-
-        }
-        else {
-            // STDOUT.println("loop -> short");
-            PlayEffect(repeatingEff, 0, milli);
-        }
+    else {
+        wav.effect_.set(repeatingEff);
+        wav.SetRepeat(milli == 1 ? 1 : milli + 1);
     }
     interrupts();
   }
@@ -357,10 +247,7 @@ bool PlayEffect(Effect* soundEffect, int soundID=-1, uint16_t repeat=0, float vo
   // Fade out volume over 'milli' [ms], then stop 
   void FadeAndStop(uint16_t speed = 125) {
     noInterrupts();
-    if (repeater) repeater->Stop();
-    wav.shortRepeatTime = 0;
-    if(repeater)
-    *(wav.longRepeat) = false;
+    wav.repeat_samples_ = 0;
     wav.PlayNext(0);  
     repeatingEff = 0;  
     set_speed(speed);
@@ -37,6 +37,36 @@ void my_stm32l4_system_saiclk_configure_22579200()
 
 #define PDB_CONFIG (PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_CONT | PDB_SC_PDBIE | PDB_SC_DMAEN)
 
+// DMA half-buffer: AUDIO_BUFFER_SIZE samples at AUDIO_RATE (sound.h) per interrupt.
+// A larger AUDIO_BUFFER_SIZE means fewer interrupts and more latency. SetBlock()
+// runs the DMA on a shorter part of the buffer (low latency, see audio_latency.h).
+//
+// 12-bit DAC output (ULTRAPROFFIE_DAC):
+//  - DAC_OVERSAMPLE 2 or 4: the DAC runs at 2x / 4x AUDIO_RATE, the extra samples
+//    come from a 4-tap polyphase (cubic Lagrange) interpolator. At 4x the timer
+//    period rounds down: output is 0.1% fast.
+//  - DAC_DITHER: TPDF dither and first order noise shaping down to 12 bits, instead
+//    of truncating the 16-bit samples. Silent blocks are written undithered.
+#if defined(ULTRAPROFFIE_DAC) && defined(ARDUINO_ARCH_STM32L4)
+  #ifndef DAC_OVERSAMPLE
+  #define DAC_OVERSAMPLE 1
+  #endif
+  #if DAC_OVERSAMPLE != 1 && DAC_OVERSAMPLE != 2 && DAC_OVERSAMPLE != 4
+  #error DAC_OVERSAMPLE must be 1, 2 or 4
+  #endif
+  #define DAC_TIMER_PERIOD  (1814 / DAC_OVERSAMPLE)   // 80MHz / 1814 = 44.1kHz
+#else
+  #if defined(DAC_OVERSAMPLE) && DAC_OVERSAMPLE != 1
+  #error DAC_OVERSAMPLE needs ULTRAPROFFIE_DAC
+  #endif
+  #ifdef DAC_DITHER
+  #error DAC_DITHER needs ULTRAPROFFIE_DAC
+  #endif
+  #undef DAC_OVERSAMPLE
+  #define DAC_OVERSAMPLE 1
+#endif
+#define DAC_DMA_SAMPLES (AUDIO_BUFFER_SIZE * DAC_OVERSAMPLE)    // per half-buffer, per channel
+
 
 #if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4) // STM UltraProffies
 #include "stm32l4_timer.h"
@@ -71,12 +101,14 @@ public:
       STDOUT.println(" dac- "); 
     #endif
   }     
-  void Loop() override { if (SoundActive()) RequestPower(); }
+  void Loop() override { if (SoundActive()) RequestPower(); ApplyBlock(); }
+  uint32_t IdleMicros() override { return SoundActive() ? 0 : LOOPER_IDLE_FOREVER; }
 
 #else 
+bool AmplifierIsActive();   // defined later in amplifier.h
 class LS_DAC : CommandParser, Looper {
 public:
-  void Loop() override {}
+  void Loop() override { ApplyBlock(); }
 #endif 
 
   virtual const char* name() { return "DAC"; }
@@ -94,7 +126,7 @@ public:
     if(result && stm32l4_dac1Timer.state == TIMER_STATE_INIT) // if created OK proceed configureing it
     {
         timPeriphClock = stm32l4_timer_clock(&stm32l4_dac1Timer);  // get clock peripheral
-        result = stm32l4_timer_enable(&stm32l4_dac1Timer, 0, 1814, 0, NULL, NULL, TIMER_OPTION_COUNT_UP);  //  | TIMER_EVENT_PERIOD   // 1300 // 1814
+        result = stm32l4_timer_enable(&stm32l4_dac1Timer, 0, DAC_TIMER_PERIOD, 0, NULL, NULL, TIMER_OPTION_COUNT_UP);  //  | TIMER_EVENT_PERIOD   // 1300 // 1814
         stm32l4_dac1Timer.TIM->CR2 = 0X20; // The update event is selected as a trigger output (TRGO). 
         // stm32l4_timer_start(&stm32l4_dac1Timer, 0); // start the timer 
     } // end creation of TIMER6 for triggering DAC conversion 
@@ -143,6 +175,7 @@ public:
     if (on_) return;
     on_ = true;
     Setup();
+    block_ = next_block_;
 
     memset(dac_dma_buffer, 0, sizeof(dac_dma_buffer));
 #if defined(ENABLE_SPDIF_OUT) || defined(ENABLE_I2S_OUT)
@@ -151,14 +184,13 @@ public:
 #ifdef FILTER_CUTOFF_FREQUENCY
     filter_.clear();
 #endif
+#ifdef ULTRAPROFFIE_DAC
+    for (int i = 0; i < 4; i++) history_[i] = 0;
+    error_ = 0;
+#endif
 
   #if defined(ULTRAPROFFIE_DAC) && defined(ARDUINO_ARCH_STM32L4)  // STM UltraProffies
-  uint32_t dmaOption = 0;
-  dmaOption = DMA_OPTION_MEMORY_TO_PERIPHERAL | DMA_OPTION_PERIPHERAL_DATA_SIZE_16 | DMA_OPTION_PRIORITY_HIGH | DMA_OPTION_MEMORY_DATA_SIZE_16 \
-                  | DMA_OPTION_CIRCULAR | DMA_OPTION_MEMORY_DATA_INCREMENT;
-  dmaOption |= DMA_OPTION_EVENT_TRANSFER_HALF | DMA_OPTION_EVENT_TRANSFER_DONE | DMA_OPTION_EVENT_TRANSFER_ERROR;  // | DMA_OPTION_EVENT_TRANSFER_HALF
-
-  stm32l4_dma_start(&dma, ((uint32_t)(stm32l4_dac1.DACx))+12, (uint32_t)(dac_dma_buffer), AUDIO_BUFFER_SIZE * 2, dmaOption);  // was +8
+  stm32l4_dma_start(&dma, ((uint32_t)(stm32l4_dac1.DACx))+12, (uint32_t)(dac_dma_buffer), block_ * DAC_OVERSAMPLE * 2, kDmaOptions);  // was +8
   // DMA1->ISR |= DMA_ISR_GIF3 | DMA_ISR_TCIF3 | DMA_ISR_HTIF3;
   // stm32l4_dma_poll(&stm32l4_dac1DMA);
   stm32l4_timer_start(&stm32l4_dac1Timer, 0); // start the timer 
@@ -198,15 +230,7 @@ public:
       stm32l4_gpio_pin_configure(g_SAIPins.sck, (GPIO_PUPD_NONE | GPIO_OSPEED_HIGH | GPIO_OTYPE_PUSHPULL | GPIO_MODE_ALTERNATE));
       stm32l4_gpio_pin_configure(g_SAIPins.fs, (GPIO_PUPD_NONE | GPIO_OSPEED_HIGH | GPIO_OTYPE_PUSHPULL | GPIO_MODE_ALTERNATE));
       stm32l4_gpio_pin_configure(g_SAIPins.sd, (GPIO_PUPD_NONE | GPIO_OSPEED_HIGH | GPIO_OTYPE_PUSHPULL | GPIO_MODE_ALTERNATE));
-      stm32l4_dma_start(&dma, (uint32_t)&SAIx->DR, (uint32_t)dac_dma_buffer, AUDIO_BUFFER_SIZE * 2,
-                        DMA_OPTION_EVENT_TRANSFER_DONE |
-                        DMA_OPTION_EVENT_TRANSFER_HALF |
-                        DMA_OPTION_MEMORY_TO_PERIPHERAL |
-                        DMA_OPTION_PERIPHERAL_DATA_SIZE_32 |
-                        DMA_OPTION_MEMORY_DATA_SIZE_16 |
-                        DMA_OPTION_MEMORY_DATA_INCREMENT |
-                        DMA_OPTION_PRIORITY_HIGH |
-                        DMA_OPTION_CIRCULAR);
+      stm32l4_dma_start(&dma, (uint32_t)&SAIx->DR, (uint32_t)dac_dma_buffer, block_ * 2, kDmaOptions);
       SAIx->CR1 |= SAI_xCR1_DMAEN;
 
   #define SAIB_SCK g_SAIPins.sck
@@ -227,30 +251,14 @@ public:
 
       // aux/Button2 button pin is DATA
       stm32l4_gpio_pin_configure(SAIB_SD, (GPIO_PUPD_NONE | GPIO_OSPEED_HIGH | GPIO_OTYPE_PUSHPULL | GPIO_MODE_ALTERNATE));
-      stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, AUDIO_BUFFER_SIZE * 2,
-                        DMA_OPTION_EVENT_TRANSFER_DONE |
-                        DMA_OPTION_EVENT_TRANSFER_HALF |
-                        DMA_OPTION_MEMORY_TO_PERIPHERAL |
-                        DMA_OPTION_PERIPHERAL_DATA_SIZE_32 |
-                        DMA_OPTION_MEMORY_DATA_SIZE_16 |
-                        DMA_OPTION_MEMORY_DATA_INCREMENT |
-                        DMA_OPTION_PRIORITY_HIGH |
-                        DMA_OPTION_CIRCULAR);
+      stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, block_ * 2, kDmaOptions);
       SAI2->CR1 |= SAI_xCR1_DMAEN;
   #endif
 
   #ifdef ENABLE_SPDIF_OUT
       // aux button pin becomes S/PDIF out
       stm32l4_gpio_pin_configure(SAIB_SD, (GPIO_PUPD_NONE | GPIO_OSPEED_HIGH | GPIO_OTYPE_PUSHPULL | GPIO_MODE_ALTERNATE));
-      stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, AUDIO_BUFFER_SIZE * 2 * 2,
-                        DMA_OPTION_EVENT_TRANSFER_DONE |
-                        DMA_OPTION_EVENT_TRANSFER_HALF |
-                        DMA_OPTION_MEMORY_TO_PERIPHERAL |
-                        DMA_OPTION_PERIPHERAL_DATA_SIZE_32 |
-                        DMA_OPTION_MEMORY_DATA_SIZE_32 |
-                        DMA_OPTION_MEMORY_DATA_INCREMENT |
-                        DMA_OPTION_PRIORITY_HIGH |
-                        DMA_OPTION_CIRCULAR);
+      stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, block_ * 2 * 2, kSpdifDmaOptions);
       SAI2->CR1 |= SAI_xCR1_DMAEN;
   #endif
 
@@ -349,8 +357,17 @@ public:
     return false;
   }
 
+  // The mixer has active streams
+  static bool Playing() {
+#if defined(ULTRAPROFFIE) && defined(ARDUINO_ARCH_STM32L4)
+    return SoundActive();
+#else
+    return AmplifierIsActive();
+#endif
+  }
+
   bool isSilent() {
-     for (size_t i = 0; i < NELEM(dac_dma_buffer); i++)
+     for (size_t i = 0; i < block_ * DAC_OVERSAMPLE * 2 * CHANNELS; i++)
        if (dac_dma_buffer[i] != dac_dma_buffer[0])
          return false;
      return true;
@@ -367,7 +384,64 @@ public:
     stream_ = stream;
   }
 
+  // Samples per DMA interrupt: a multiple of 4, up to AUDIO_BUFFER_SIZE.
+  // The DMA restarts with it right away if the output is silent, otherwise
+  // once it is (or at the next power up). The output stays enabled.
+  void SetBlock(int samples) {
+    next_block_ = std::min(std::max(samples & ~3, 4), AUDIO_BUFFER_SIZE);
+    ApplyBlock();
+  }
+  int block() const { return block_; }
+
 private:
+#if defined(ULTRAPROFFIE_DAC) && defined(ARDUINO_ARCH_STM32L4)
+  static const uint32_t kDmaOptions = DMA_OPTION_MEMORY_TO_PERIPHERAL | DMA_OPTION_PERIPHERAL_DATA_SIZE_16 | DMA_OPTION_PRIORITY_HIGH
+                  | DMA_OPTION_MEMORY_DATA_SIZE_16 | DMA_OPTION_CIRCULAR | DMA_OPTION_MEMORY_DATA_INCREMENT
+                  | DMA_OPTION_EVENT_TRANSFER_HALF | DMA_OPTION_EVENT_TRANSFER_DONE | DMA_OPTION_EVENT_TRANSFER_ERROR;
+#else
+  static const uint32_t kDmaOptions = DMA_OPTION_EVENT_TRANSFER_DONE | DMA_OPTION_EVENT_TRANSFER_HALF
+                  | DMA_OPTION_MEMORY_TO_PERIPHERAL | DMA_OPTION_PERIPHERAL_DATA_SIZE_32 | DMA_OPTION_MEMORY_DATA_SIZE_16
+                  | DMA_OPTION_MEMORY_DATA_INCREMENT | DMA_OPTION_PRIORITY_HIGH | DMA_OPTION_CIRCULAR;
+  static const uint32_t kSpdifDmaOptions = (kDmaOptions & ~DMA_OPTION_MEMORY_DATA_SIZE_16) | DMA_OPTION_MEMORY_DATA_SIZE_32;
+#endif
+
+  // The buffer holds one level throughout, whatever its length: only the DMA
+  // restarts, the DAC / SAI keep running and hold that level meanwhile.
+  // Nothing is looked at while streams play: the buffer can't be silent then.
+  void ApplyBlock() {
+    if (next_block_ == block_ || !on_ || Playing()) return;
+    noInterrupts();
+    if (!isSilent()) {      // the mixer may have filled it meanwhile
+      interrupts();
+      return;
+    }
+    block_ = next_block_;
+#if defined(ULTRAPROFFIE_DAC) && defined(ARDUINO_ARCH_STM32L4)
+    stm32l4_timer_stop(&stm32l4_dac1Timer);     // no conversion requests, so no DMA underrun
+    stm32l4_dma_stop(&dma);
+    stm32l4_dma_start(&dma, ((uint32_t)(stm32l4_dac1.DACx))+12, (uint32_t)(dac_dma_buffer), block_ * DAC_OVERSAMPLE * 2, kDmaOptions);
+    stm32l4_timer_start(&stm32l4_dac1Timer, 0);
+#else
+    SAI_Block_TypeDef *SAIx = SAI1_Block_A;
+    SAIx->CR1 &= ~SAI_xCR1_DMAEN;
+    stm32l4_dma_stop(&dma);
+    stm32l4_dma_start(&dma, (uint32_t)&SAIx->DR, (uint32_t)dac_dma_buffer, block_ * 2, kDmaOptions);
+    SAIx->CR1 |= SAI_xCR1_DMAEN;
+  #if defined(ENABLE_I2S_OUT) || defined(ENABLE_SPDIF_OUT)
+    SAI_Block_TypeDef *SAI2 = SAI1_Block_B;
+    SAI2->CR1 &= ~SAI_xCR1_DMAEN;
+    stm32l4_dma_stop(&dma2);
+    #ifdef ENABLE_SPDIF_OUT
+    stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, block_ * 2 * 2, kSpdifDmaOptions);
+    #else
+    stm32l4_dma_start(&dma2, (uint32_t)&SAI2->DR, (uint32_t)dac_dma_buffer2, block_ * 2, kDmaOptions);
+    #endif
+    SAI2->CR1 |= SAI_xCR1_DMAEN;
+  #endif
+#endif
+    interrupts();
+  }
+
   static uint32_t current_position() {
   return (uint32_t)(dac_dma_buffer + stm32l4_dma_count(&dma));
   }
@@ -377,6 +451,7 @@ private:
 
   {
     ScopedCycleCounter cc(audio_dma_interrupt_cycles);
+    TRACE(trc_dma, tr_dacisr, 0);
     int16_t *dest;
     uint32_t saddr = current_position();
 #ifdef ENABLE_SPDIF_OUT
@@ -386,12 +461,13 @@ private:
     uint16_t *secondary;
 #endif
 
-    if (saddr < (uint32_t)dac_dma_buffer + sizeof(dac_dma_buffer) / 2) {
+    int block = block_;
+    if (saddr < (uint32_t)(dac_dma_buffer + block * DAC_OVERSAMPLE * CHANNELS)) {
       // DMA is transmitting the first half of the buffer
       // so we must fill the second half
-      dest = (int16_t *)&dac_dma_buffer[AUDIO_BUFFER_SIZE*CHANNELS];
+      dest = (int16_t *)&dac_dma_buffer[block * DAC_OVERSAMPLE * CHANNELS];
 #if defined(ENABLE_SPDIF_OUT) || defined(ENABLE_I2S_OUT)
-      secondary = dac_dma_buffer2 + AUDIO_BUFFER_SIZE * 2;
+      secondary = dac_dma_buffer2 + block * 2;
 #endif
     } else {
       // DMA is transmitting the second half of the buffer
@@ -421,12 +497,12 @@ private:
 #endif    
     int n = 0;
     if (stream_) {
-      n = dynamic_mixer.read(data, AUDIO_BUFFER_SIZE);
+      n = dynamic_mixer.read(data, block);
     }
-    while (n < AUDIO_BUFFER_SIZE) data[n++] = 0;
+    while (n < block) data[n++] = 0;
 
 #if defined(ENABLE_SPDIF_OUT) || defined(ENABLE_I2S_OUT)
-    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+    for (int i = 0; i < block; i++) {
 #ifdef ENABLE_I2S_OUT
       *(secondary++) = clamptoi16(data[i] * (LINE_OUT_VOLUME));
 #endif
@@ -441,11 +517,14 @@ private:
 #ifdef FILTER_CUTOFF_FREQUENCY
     // Run the filter
     static_assert(AUDIO_BUFFER_SIZE % 4 == 0);
-    for (int i = 0; i < AUDIO_BUFFER_SIZE; i+=4) {
+    for (int i = 0; i < block; i+=4) {
       filter_.Run4(data + i);
     }
 #endif    
-    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+#ifdef ULTRAPROFFIE_DAC
+    bool silent = true;
+#endif
+    for (int i = 0; i < block; i++) {
 #ifdef DAC_GET_FLOATS
       int16_t sample = clamptoi16(data[i] * dynamic_mixer.get_volume());
 #else   // GET_FLOATS
@@ -459,8 +538,8 @@ private:
         *(dest++) = sample;
   #endif
 #elif defined(ULTRAPROFFIE_DAC)
-
-    *(dest++) = (((uint16_t)sample) + 32768);   // was  32767
+      data[i] = sample;
+      if (sample) silent = false;
 
 #else // I2S
       // For Teensy DAC
@@ -468,16 +547,71 @@ private:
 #endif
     }
     
+#ifdef ULTRAPROFFIE_DAC
+    RenderDAC((uint16_t*)dest, data, block, silent);
+#endif
 #ifdef __IMXRT1062__
-    arm_dcache_flush_delete(clear_cache, sizeof(dac_dma_buffer)/2);
+    arm_dcache_flush_delete(clear_cache, block * DAC_OVERSAMPLE * CHANNELS * sizeof(dac_dma_buffer[0]));
 #endif
   }
 
+#ifdef ULTRAPROFFIE_DAC
+  // Oversample and quantize a block to the DAC's 12 bits, left aligned.
+  template<class T>
+  static void RenderDAC(uint16_t* dest, const T* data, int n, bool silent) {
+  #if DAC_OVERSAMPLE > 1
+    // Cubic Lagrange weights [Q15] of x[n-3..n] for output phases between x[n-2] and x[n-1]
+    static const int32_t taps[4][4] = {
+      {     0, 32768,     0,     0 },
+    #if DAC_OVERSAMPLE == 4
+      { -1792, 26880,  8960, -1280 },
+    #endif
+      { -2048, 18432, 18432, -2048 },
+    #if DAC_OVERSAMPLE == 4
+      { -1280,  8960, 26880, -1792 },
+    #endif
+    };
+  #endif
+    if (silent) error_ = 0;
+    for (int i = 0; i < n; i++) {
+  #if DAC_OVERSAMPLE > 1
+      history_[0] = history_[1]; history_[1] = history_[2]; history_[2] = history_[3];
+      history_[3] = data[i];
+      for (int p = 0; p < DAC_OVERSAMPLE; p++) {
+        int32_t y = (history_[0] * taps[p][0] + history_[1] * taps[p][1] +
+                     history_[2] * taps[p][2] + history_[3] * taps[p][3]) >> 15;
+        *(dest++) = Quantize(y, silent);
+      }
+  #else
+      *(dest++) = Quantize(data[i], silent);
+  #endif
+    }
+  }
+
+  static inline uint16_t Quantize(int32_t y, bool silent) {
+  #ifdef DAC_DITHER
+    if (!silent) {
+      // u = y - e[n-1], q = Q(u + d), e[n] = q - u: error spectrum shaped by (1 - z^-1)
+      static uint32_t rnd = 22222;
+      rnd = rnd * 1664525 + 1013904223;
+      int32_t d = (int32_t)((rnd >> 28) + ((rnd >> 12) & 15)) - 15;    // TPDF, +/- 1 LSB of 12 bits
+      int32_t u = clamptoi16(y - error_);
+      int32_t q = clamptoi16(u + d + 8) & ~15;
+      error_ = q - u;
+      return (uint16_t)(q + 32768);
+    }
+  #endif
+    return ((uint16_t)clamptoi16(y)) + 32768;   // was  32767
+  }
+#endif
+
   static void isr2(void* arg, unsigned long int event) {}
 
   bool on_ = false;
   bool needs_setup_ = true;
-  DMAMEM static uint16_t dac_dma_buffer[AUDIO_BUFFER_SIZE*2*CHANNELS];
+  uint16_t next_block_ = AUDIO_BUFFER_SIZE;
+  static volatile uint16_t block_;      // samples per interrupt, set when the DMA starts
+  DMAMEM static uint16_t dac_dma_buffer[DAC_DMA_SAMPLES*2*CHANNELS];
 #ifdef ENABLE_SPDIF_OUT
   DMAMEM static uint32_t dac_dma_buffer2[AUDIO_BUFFER_SIZE*2*2];
 #endif
@@ -489,6 +623,10 @@ private:
 #if defined(ENABLE_I2S_OUT) || defined(ENABLE_SPDIF_OUT)
   static DMAChannel dma2;
 #endif
+#ifdef ULTRAPROFFIE_DAC
+  static int32_t history_[4];     // last input samples, for the interpolator
+  static int32_t error_;          // quantization error fed back by the noise shaper
+#endif
 #ifdef FILTER_CUTOFF_FREQUENCY
   static Filter::Biquad<
     Filter::Bilinear<
@@ -506,7 +644,12 @@ DMAChannel LS_DAC::dma2;
 
 
 ProffieOSAudioStream * volatile LS_DAC::stream_ = nullptr;
-DMAMEM __attribute__((aligned(32))) uint16_t LS_DAC::dac_dma_buffer[AUDIO_BUFFER_SIZE*2*CHANNELS];
+volatile uint16_t LS_DAC::block_ = AUDIO_BUFFER_SIZE;
+#ifdef ULTRAPROFFIE_DAC
+int32_t LS_DAC::history_[4];
+int32_t LS_DAC::error_ = 0;
+#endif
+DMAMEM __attribute__((aligned(32))) uint16_t LS_DAC::dac_dma_buffer[DAC_DMA_SAMPLES*2*CHANNELS];
 #ifdef ENABLE_SPDIF_OUT
 DMAMEM __attribute__((aligned(32))) uint32_t LS_DAC::dac_dma_buffer2[AUDIO_BUFFER_SIZE*2*2];
 #endif
@@ -34,6 +34,7 @@ class LS_DAC : CommandParser, Looper, public PowerSubscriber {
         #endif
       }     
       void Loop() override { if (SoundActive()) RequestPower(); }
+      uint32_t IdleMicros() override { return SoundActive() ? 0 : LOOPER_IDLE_FOREVER; }
 
       virtual const char* name() { return "DAC"; }
 
@@ -11,8 +11,19 @@ public:
   AudioDynamicMixer() : underflow_count_(0) {
     for (int i = 0; i < N; i++) {
       streams_[i] = nullptr;
+      last_in_[i] = 0;
+      tail_[i] = tail_step_[i] = 0;
     }
   }
+
+  // Input 'i' is cut off (a stolen voice): instead of a step, its last sample
+  // ramps down to 0 over 'samples'. Call with interrupts disabled, before the
+  // stream stops.
+  void Release(int i, int samples) {
+    tail_[i] = (int32_t)last_in_[i] << 8;     // 8 fractional bits
+    tail_step_[i] = tail_[i] / std::max(samples, 1);
+    if (!tail_step_[i]) tail_[i] = 0;
+  }
 // #endif
 
   const char* name() override { return "AudioDynamicMixer"; }
@@ -76,6 +87,8 @@ public:
         for (int j = 0; j < e; j++) {
           sum[j] += data[j];
         }
+        if (e) last_in_[i] = data[e - 1];
+        if (tail_[i]) AddTail(i, sum, to_do);
       }
 
       for (int i = 0; i < to_do; i++) {
@@ -96,8 +109,19 @@ public:
     }
     last_sample_ = v2;
     last_sum_ = v;
-    
-//    STDOUT.println(vol_);
+#ifdef X_BROADCAST
+    struct {
+      int32_t vol;            // envelope
+      int32_t peak_sum;       // peak before compression, since last packet
+      int32_t peak;           // peak after compression, since last packet
+      uint32_t underflows;
+    } ch;
+    ch.vol = vol_;
+    ch.peak_sum = peak_sum_;
+    ch.peak = peak_;
+    ch.underflows = underflow_count_.get();
+    if (TELEMETRY_PUBLISH(tm_mixer, &ch, sizeof(ch))) peak_sum_ = peak_ = 0;
+#endif
     return ret;
   }
 
@@ -121,6 +145,8 @@ public:
         for (int j = 0; j < e; j++) {
           sum[j] += tmp[j];
         }
+        if (e) last_in_[i] = tmp[e - 1];
+        if (tail_[i]) AddTail(i, sum, to_do);
       }
 
       for (int i = 0; i < to_do; i++) {
@@ -137,6 +163,21 @@ public:
     return ret;
   }
 
+  // Ramp of a released input, until it reaches 0
+  void AddTail(int i, int32_t* sum, int n) {
+    int32_t tail = tail_[i], step = tail_step_[i];
+    for (int j = 0; j < n; j++) {
+      sum[j] += tail >> 8;
+      tail -= step;
+      if ((tail ^ tail_[i]) < 0) { tail = 0; break; }     // crossed 0
+    }
+    tail_[i] = tail;
+  }
+
+  uint32_t IdleMicros() override {
+    return underflow_count_.get() != last_underflow_count_ ? LOOPER_IDLE_POLL : LOOPER_IDLE_FOREVER;
+  }
+
   void Loop() override {
     uint32_t underflows = underflow_count_.get();
     if (underflows != last_underflow_count_) {
@@ -177,6 +218,9 @@ public:
   int32_t get_volume() const { return volume_; }
 
   ProffieOSAudioStream* streams_[N];
+  int16_t last_in_[N];          // last sample read from each input
+  int32_t tail_[N];             // ramp of a released input, 8 fractional bits
+  int32_t tail_step_[N];
   int32_t vol_ = 0;
   int32_t last_sample_ = 0;
   int32_t last_sum_ = 0;
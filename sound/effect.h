@@ -139,6 +139,61 @@ class Effect {
   }
 
   void SetPersistence(bool persistent) { persistent_ = persistent; }
+  bool persistent() const { return persistent_; }
+
+  // Scan results and font settings, to switch fonts without scanning again (see FontPrefetch)
+  struct ScanState {
+    int16_t max_file;
+    int16_t num_files;
+    const char* directory;  // directory_ when outside the search path list
+    int16_t offset;         // offset of directory_ in the search path list, -1 = outside
+    int16_t selected;
+    int8_t min_file;
+    int8_t digits;
+    uint8_t sub_files;
+    uint8_t volume;
+    bool unnumbered_file_found;
+    bool found_in_alt_dir;
+    bool paired;
+    FilePattern file_pattern;
+    Extension ext;
+  };
+
+  // 'paths' is the search path list the effect was scanned with; persistent
+  // effects keep directories of their own, those are saved as they are.
+  void SaveState(ScanState* state, const char* paths) const {
+    state->max_file = max_file_;
+    state->num_files = num_files_;
+    bool inPaths = directory_ >= paths && directory_ < paths + sizeof(current_directory);
+    state->directory = inPaths ? nullptr : directory_;
+    state->offset = inPaths ? directory_ - paths : -1;
+    state->min_file = min_file_;
+    state->digits = digits_;
+    state->sub_files = sub_files_;
+    state->selected = selected_;
+    state->volume = volume_;
+    state->paired = paired_;
+    state->unnumbered_file_found = unnumbered_file_found_;
+    state->found_in_alt_dir = found_in_alt_dir_;
+    state->file_pattern = file_pattern_;
+    state->ext = ext_;
+  }
+
+  void LoadState(const ScanState& state, const char* paths) {
+    max_file_ = state.max_file;
+    num_files_ = state.num_files;
+    directory_ = state.offset >= 0 ? paths + state.offset : state.directory;
+    min_file_ = state.min_file;
+    digits_ = state.digits;
+    sub_files_ = state.sub_files;
+    selected_ = state.selected;
+    volume_ = state.volume;
+    paired_ = state.paired;
+    unnumbered_file_found_ = state.unnumbered_file_found;
+    found_in_alt_dir_ = state.found_in_alt_dir;
+    file_pattern_ = state.file_pattern;
+    ext_ = state.ext;
+  }
 
   void reset() {
     min_file_ = 127;
@@ -543,18 +598,21 @@ class Effect {
 	*fend = '/';
 	fend++;
       }
-      for (; iter; ++iter) {
-	// fprintf(stderr, "N: %s\n", iter.name());
-	if (iter.name()[0] == '.') continue;
-	strcpy(fend, iter.name());
-	if (iter.isdir()) {
-	  if (ShouldScan(iter.name())) {
-	    LSFS::Iterator i2(iter);
-	    ScanIterator(i2);
-	  }
-	} else {
-	  ScanAll(font_path_ptr, fname);
+      for (; iter; ++iter) ScanEntry(iter, fend);
+    }
+
+    // 'fend' is where the entry name goes in fname
+    void ScanEntry(LSFS::Iterator& iter, char* fend) {
+      // fprintf(stderr, "N: %s\n", iter.name());
+      if (iter.name()[0] == '.') return;
+      strcpy(fend, iter.name());
+      if (iter.isdir()) {
+	if (ShouldScan(iter.name())) {
+	  LSFS::Iterator i2(iter);
+	  ScanIterator(i2);
 	}
+      } else {
+	ScanAll(font_path_ptr, fname);
       }
     }
 
@@ -565,18 +623,24 @@ class Effect {
       LSFS::Iterator i(dir);
       ScanIterator(i);
     }
+
+    // Top level entries of 'dir' from where 'i' is, at least one, until 'slice'
+    // us have passed. Returns true once 'i' is at the end.
+    bool ScanFrom(const char* dir, LSFS::Iterator& i, uint32_t slice) {
+      font_path_ptr = dir;
+      uint32_t start = micros();
+      for (bool first = true; i; ++i, first = false) {
+	if (!first && micros() - start > slice) return false;
+	fname[0] = 0;
+	ScanEntry(i, fname);
+      }
+      return true;
+    }
   };
 #endif
 
-  static void ScanOneDirectory(const char* dir) {
-      #if defined(DIAGNOSE_PRESETS) 
-        STDOUT.print("Scanning sound font: ");
-        STDOUT.print(dir);
-      #endif
-
-
+  static void ScanSerialFlash(const char* dir) {
 #ifdef ENABLE_SERIALFLASH
-    // Scan serial flash.
     SerialFlashChip::opendir();
     uint32_t size;
     char filename[128];
@@ -587,6 +651,15 @@ class Effect {
       ScanAll(f + 1, dir);
     }
 #endif
+  }
+
+  static void ScanOneDirectory(const char* dir) {
+      #if defined(DIAGNOSE_PRESETS) 
+        STDOUT.print("Scanning sound font: ");
+        STDOUT.print(dir);
+      #endif
+
+    ScanSerialFlash(dir);
 
 #ifdef ENABLE_SD
     if (LSFS::Exists(dir)) {
@@ -604,18 +677,49 @@ class Effect {
 #endif   // ENABLE_SD
   }
 
-  static void ScanCurrentDirectory() {
-    LOCK_SD(true);
-    current_alternative = 0;
-    num_alternatives = 0;
-    for (Effect* e = all_effects; e; e = e->next_) {
-        if (!e->persistent_) e->reset();    // don't reset persistent effects
+  // ScanOneDirectory() a part at a time, for background scans: Start(), then
+  // Next() until it returns true. The directory stays open in between, so each
+  // part goes on where the last one stopped. 'dir' must exist and stay put until done.
+  class PartScan {
+  public:
+    ~PartScan() { Stop(); }
+    bool Running() const { return dir_ != nullptr; }
+    void Start(const char* dir) {
+      Stop();
+      dir_ = dir;
+      ScanSerialFlash(dir);
+#ifdef ENABLE_SD
+      iter_ = new LSFS::Iterator(dir);
+#endif
     }
-
-    for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
-      ScanOneDirectory(dir);
+    // Scan for 'slice' us at least one more entry. Returns true once done.
+    bool Next(uint32_t slice) {
+      bool done = true;
+#ifdef ENABLE_SD
+      if (iter_) {
+        Scanner scanner;
+        done = scanner.ScanFrom(dir_, *iter_, slice);
+      }
+#endif
+      if (done) Stop();
+      return done;
     }
+    void Stop() {
+#ifdef ENABLE_SD
+      delete iter_;
+      iter_ = nullptr;
+#endif
+      dir_ = nullptr;
+    }
+  private:
+    const char* dir_ = nullptr;
+#ifdef ENABLE_SD
+    LSFS::Iterator* iter_ = nullptr;
+#endif
+  };
 
+  // Warn about effects missing files in the current font, scanned or prefetched
+  static void CheckFiles() {
     bool warned = false;
     for (Effect* e = all_effects; e; e = e->next_) {
       if (!e->persistent_ && e->expected_files() != (size_t)(e->num_files_)) {
@@ -630,6 +734,21 @@ class Effect {
 	        e->Show();
       }
     }
+  }
+
+  static void ScanCurrentDirectory() {
+    LOCK_SD(true);
+    current_alternative = 0;
+    num_alternatives = 0;
+    for (Effect* e = all_effects; e; e = e->next_) {
+        if (!e->persistent_) e->reset();    // don't reset persistent effects
+    }
+
+    for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
+      ScanOneDirectory(dir);
+    }
+
+    CheckFiles();
     LOCK_SD(false);
   }
 
@@ -643,18 +762,7 @@ class Effect {
       STDOUT.print(dir);
     #endif
 
-#ifdef ENABLE_SERIALFLASH
-      // Scan serial flash.
-      SerialFlashChip::opendir();
-      uint32_t size;
-      char filename[128];
-      while (SerialFlashChip::readdir(filename, sizeof(filename), size)) {
-        const char* f = startswith(dir, filename);
-        if (!f) continue;
-        if (*f != '/') continue;
-        ScanAll(f + 1, dir);
-      }
-#endif
+      ScanSerialFlash(dir);
 
 #ifdef ENABLE_SD
       if (LSFS::Exists(dir)) {
@@ -858,4 +966,182 @@ private:
   char filename_[128];
 };
 
+#ifndef FONT_PREFETCH_SLOTS
+#define FONT_PREFETCH_SLOTS 3       // previous font + both neighbours
+#endif
+#define FONT_PREFETCH_BYTES 512     // read from the first hum, font and out files
+#define FONT_PREFETCH_KEY   32      // longer font strings are not prefetched
+#define FONT_PREFETCH_SLICE 2000    // [us] scan time per Prefetch() call
+
+// Effect indexes of fonts other than the current one. Built in the background
+// (PropBase prefetches the fonts of the neighbouring presets), so chdir() can
+// copy an index in instead of scanning the font directories.
+class FontPrefetch {
+public:
+  // Index 'font' (a preset font string) a slice at a time, unless already done;
+  // then read the head of its first hum, font and out files so their directory
+  // entries are cached. Call again until it returns true. Borrows the effects
+  // during each call: only call while no sound plays.
+  bool Prefetch(const char* font) {
+    if (Has(font)) return true;
+    if (pending_ && strcmp(pendingFont_, font)) Cancel();    // another font wanted now
+    if (!pending_ && !Start(font)) return false;
+
+    Save(&saved_, current_directory);   // borrow the effects
+    LOCK_SD(true);
+    if (dir_ == paths_ && !scan_.Running()) {
+      current_alternative = 0;
+      num_alternatives = 0;
+      for (Effect* e = all_effects; e; e = e->next_)
+        if (!e->persistent()) e->reset();
+    } else {
+      Load(*pending_, paths_, true);
+    }
+    bool done = !dir_;
+    if (done) Warm();
+    else {
+      if (!scan_.Running()) scan_.Start(dir_);
+      if (scan_.Next(FONT_PREFETCH_SLICE)) dir_ = next_current_directory(dir_);
+    }
+    Save(pending_, paths_);
+    Load(saved_, current_directory, true);    // give the effects back, all of them
+    LOCK_SD(false);
+    if (!done) return false;
+    strcpy(pending_->font, font);
+    pending_ = nullptr;
+    return true;
+  }
+
+  // Nothing to do for 'font': current or prefetched
+  bool Has(const char* font) {
+    return !strcmp(font, current_) || Find(font);
+  }
+
+  // Called by chdir() once current_directory holds 'font': keeps the index of the
+  // font we leave, then copies in the one of 'font'. Returns false if it must be scanned.
+  bool Switch(const char* font) {
+    if (current_[0] && strcmp(current_, font) && !Find(current_)) {
+      Slot& slot = Oldest();
+      Save(&slot, current_directory);   // directory offsets still fit that font
+      strcpy(slot.font, current_);
+    }
+    current_[0] = 0;
+    Slot* slot = Find(font);
+    if (!slot) return false;
+    Load(*slot, current_directory, false);
+    current_alternative = 0;
+    strcpy(current_, font);
+    return true;
+  }
+
+  // chdir() scanned 'font' itself
+  void Scanned(const char* font) {
+    if (strlen(font) < FONT_PREFETCH_KEY) strcpy(current_, font);
+    else current_[0] = 0;
+  }
+
+  // Storage changed: forget everything
+  void Clear() {
+    for (Slot& slot : slots_) slot.font[0] = 0;
+    current_[0] = 0;
+    failed_[0] = 0;
+    Cancel();
+  }
+
+private:
+  struct Slot {
+    char font[FONT_PREFETCH_KEY] = "";
+    uint32_t used = 0;
+    int alternatives = 0;
+    int alternative = 0;
+    vector<Effect::ScanState> states;
+  };
+
+  // New prefetch of 'font': checks its directories and takes a slot for it
+  bool Start(const char* font) {
+    if (strlen(font) >= FONT_PREFETCH_KEY || !strcmp(font, failed_)) return false;
+    split_directories(paths_, font);
+    for (const char* dir = paths_; dir; dir = next_current_directory(dir))
+      if (!LSFS::Exists(dir)) {     // leave errors to chdir()
+        strcpy(failed_, font);
+        return false;
+      }
+    pending_ = &Oldest();
+    strcpy(pendingFont_, font);
+    dir_ = paths_;
+    scan_.Stop();
+    return true;
+  }
+
+  void Cancel() {
+    pending_ = nullptr;
+    scan_.Stop();
+  }
+
+  void Warm() {
+    Effect* warm[] = { &SFX_hum, &SFX_font, &SFX_out };
+    for (Effect* e : warm) {
+      if (!e->files_found()) continue;
+      char filename[128];
+      uint8_t head[FONT_PREFETCH_BYTES];
+      FileReader f;
+      Effect::FileID(e, 0, 0).GetName(filename);
+      if (f.OpenFast(filename)) f.Read(head, sizeof(head));
+      f.Close();
+    }
+  }
+
+  Slot* Find(const char* font) {
+    for (Slot& slot : slots_)
+      if (slot.font[0] && !strcmp(slot.font, font)) {
+        slot.used = ++clock_;
+        return &slot;
+      }
+    return nullptr;
+  }
+
+  Slot& Oldest() {
+    Slot* oldest = slots_;
+    for (Slot& slot : slots_)
+      if (slot.used < oldest->used) oldest = &slot;
+    if (oldest == pending_) Cancel();     // taken over: that prefetch starts again
+    oldest->font[0] = 0;
+    oldest->used = ++clock_;
+    return *oldest;
+  }
+
+  // Effects -> slot, 'paths' being the search path list they were scanned with
+  void Save(Slot* slot, const char* paths) {
+    uint16_t n = 0;
+    for (Effect* e = all_effects; e; e = e->next_) n++;
+    slot->states.resize(n);
+    Effect::ScanState* state = slot->states.data();
+    for (Effect* e = all_effects; e; e = e->next_) e->SaveState(state++, paths);
+    slot->alternatives = num_alternatives;
+    slot->alternative = current_alternative;
+  }
+
+  // Slot -> effects. Persistent effects keep their own index unless 'all'.
+  void Load(const Slot& slot, const char* paths, bool all) {
+    const Effect::ScanState* state = slot.states.data();
+    for (Effect* e = all_effects; e; e = e->next_, state++)
+      if (all || !e->persistent()) e->LoadState(*state, paths);
+    current_alternative = slot.alternative;
+    num_alternatives = slot.alternatives;
+  }
+
+  Slot slots_[FONT_PREFETCH_SLOTS];
+  Slot saved_;                          // effects of the current font while prefetching another
+  Slot* pending_ = nullptr;             // slot of the prefetch in progress
+  char pendingFont_[FONT_PREFETCH_KEY] = "";
+  char paths_[sizeof(current_directory)];   // search path list of the pending font, scan results point here
+  const char* dir_ = nullptr;           // directory scanned next, nullptr = scan done
+  Effect::PartScan scan_;               // dir_, scanned so far
+  char current_[FONT_PREFETCH_KEY] = "";
+  char failed_[FONT_PREFETCH_KEY] = "";    // last font that couldn't be prefetched
+  uint32_t clock_ = 0;
+};
+
+FontPrefetch font_prefetch;
+
 #endif
@@ -60,6 +60,69 @@ public:
       op->run(name, &var2);
     }
   }
+
+  // The per-effect settings aren't plain variables, so they aren't in the
+  // ConfigFile index: ProffieOS.SFX.<effect>.paired/volume are set through
+  // an index of the effects by name hash instead of a scan of all variables.
+  void SetVariable(const char* variable, float v) override {
+    if (!SetEffectVariable(variable, v)) ConfigFile::SetVariable(variable, v);
+  }
+
+  struct EffectEntry {
+    uint32_t hash;
+    Effect* effect;
+  };
+
+  void BuildEffectIndex() {
+    uint16_t n = 0;
+    for (Effect* e = all_effects; e; e = e->next_) n++;
+    effects_ = new EffectEntry[n ? n : 1];
+    if (!effects_) return;
+    numEffects_ = 0;
+    for (Effect* e = all_effects; e; e = e->next_) {
+      EffectEntry x = { NameHash(e->GetName()), e };
+      uint16_t j = numEffects_++;
+      for (; j && effects_[j-1].hash > x.hash; j--) effects_[j] = effects_[j-1];
+      effects_[j] = x;
+    }
+  }
+
+  // Returns false if 'variable' isn't an effect setting (unknown effect, or
+  // no memory for the index): ConfigFile::SetVariable() handles it then.
+  bool SetEffectVariable(const char* variable, float v) {
+    static const char prefix[] = "ProffieOS.SFX.";
+    if (strncasecmp(variable, prefix, sizeof(prefix) - 1)) return false;
+    const char* name = variable + sizeof(prefix) - 1;
+    const char* kind = strrchr(name, '.');
+    char effect[32];
+    if (!kind || kind - name >= (int)sizeof(effect)) return false;
+    memcpy(effect, name, kind - name);
+    effect[kind - name] = 0;
+    kind++;
+    bool paired = !strcasecmp(kind, "paired");
+    if (!paired && strcasecmp(kind, "volume")) return false;
+    if (!effects_) BuildEffectIndex();
+    if (!effects_) return false;
+    uint32_t h = NameHash(effect);
+    uint16_t lo = 0, hi = numEffects_;
+    while (lo < hi) {
+      uint16_t mid = (lo + hi) / 2;
+      if (effects_[mid].hash < h) lo = mid + 1;
+      else hi = mid;
+    }
+    bool found = false;
+    for (; lo < numEffects_ && effects_[lo].hash == h; lo++) {
+      Effect* e = effects_[lo].effect;
+      if (strcasecmp(e->GetName(), effect)) continue;
+      if (paired) e->SetPaired(v > 0.5);
+      else e->SetVolume(v);
+      found = true;
+    }
+    return found;
+  }
+
+  EffectEntry* effects_ = nullptr;
+  uint16_t numEffects_ = 0;
   // Igniter compat
   // This specifies how many milliseconds before the end of the
   // "out" sound the hum starts to fade in.
@@ -239,7 +302,7 @@ public:
   void PlayMonophonic(Effect* f, Effect* loop)  {
     EnableAmplifier();
     if (!next_hum_player_) {
-      next_hum_player_ = GetFreeWavPlayer();
+      next_hum_player_ = GetFreeWavPlayer(wp_hum);
       if (!next_hum_player_) {
         STDOUT.println("Out of WAV players!");
         return;
@@ -262,10 +325,10 @@ public:
     if (loop) hum_player_->PlayLoop(loop);
   }
 
-  RefPtr<BufferedWavPlayer> PlayPolyphonic(Effect* f)  {
+  RefPtr<BufferedWavPlayer> PlayPolyphonic(Effect* f, WavPriority priority = wp_clash)  {
     EnableAmplifier();
     if (!f->files_found()) return RefPtr<BufferedWavPlayer>(nullptr);
-    RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer();
+    RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer(priority);
     if (player) {
       player->set_volume_now(font_config.volEff / 16.0f);
       player->PlayOnce(f);
@@ -274,11 +337,11 @@ public:
     return player;
   }
 
-  void Play(Effect* monophonic, Effect* polyphonic) {
+  void Play(Effect* monophonic, Effect* polyphonic, WavPriority priority = wp_clash) {
     if (polyphonic->files_found()) {
-      PlayPolyphonic(polyphonic);
+      PlayPolyphonic(polyphonic, priority);
     } else if (SFX_humm) {
-      PlayPolyphonic(monophonic);
+      PlayPolyphonic(monophonic, priority);
     } else {
       PlayMonophonic(monophonic, &SFX_hum);
     }
@@ -329,13 +392,13 @@ public:
               float s = (rss - font_config.ProffieOSMinSwingAcceleration) / font_config.ProffieOSMaxSwingAcceleration;
 	      effect->SelectFloat(s);
             }
-            swing_player_ = PlayPolyphonic(effect);
+            swing_player_ = PlayPolyphonic(effect, wp_hum);
             swinging_ = true;
           } else {
 #ifdef ENABLE_SPINS
             if (angle_ > font_config.ProffieOSSpinDegrees) {
               if (SFX_spin) {
-                swing_player_ = PlayPolyphonic(&SFX_spin);
+                swing_player_ = PlayPolyphonic(&SFX_spin, wp_hum);
               }
               angle_ -= font_config.ProffieOSSpinDegrees;
             }
@@ -400,7 +463,7 @@ public:
     if (SFX_preon) {
       SFX_preon.SetFollowing(getOut());
       // PlayCommon(&SFX_preon);
-      RefPtr<BufferedWavPlayer> tmp = PlayPolyphonic(&SFX_preon);
+      RefPtr<BufferedWavPlayer> tmp = PlayPolyphonic(&SFX_preon, wp_hum);
       
       if (monophonic_hum_) {
 	getOut()->SetFollowing(getHum());
@@ -442,7 +505,7 @@ public:
     } else {
       state_ = STATE_OUT;
       if (!hum_player_) {
-	hum_player_ = GetFreeWavPlayer();
+	hum_player_ = GetFreeWavPlayer(wp_hum);
 	if (hum_player_) {
 	  hum_player_->set_volume_now(0);
 	  hum_player_->PlayOnce(SFX_humm ? &SFX_humm : &SFX_hum);
@@ -460,7 +523,7 @@ public:
 	  SaberBase::ClearSoundInfo();
 	}
       } else {
-	tmp = PlayPolyphonic(getOut());
+	tmp = PlayPolyphonic(getOut(), wp_hum);
       }
       hum_fade_in_ = 0.2;
       if (SFX_humm && tmp) {
@@ -528,7 +591,7 @@ public:
           }
         } else {
           state_ = STATE_HUM_FADE_OUT;
-          PlayPolyphonic(&SFX_in);
+          PlayPolyphonic(&SFX_in, wp_hum);
 	  hum_fade_out_ = 0.2;
         }
 	check_postoff_ = !!SFX_pstoff;
@@ -556,7 +619,7 @@ public:
 	// If no stab sounds are found, fall through to clash
       case EFFECT_CLASH: Play(&SFX_clash, &SFX_clsh); return;
       case EFFECT_FORCE: PlayCommon(&SFX_force); return;
-      case EFFECT_BLAST: Play(&SFX_blaster, &SFX_blst); return;      
+      case EFFECT_BLAST: Play(&SFX_blaster, &SFX_blst, wp_blast); return;      
       case EFFECT_BOOT: emojiSounds.Select(emojiSounds_id::boot-1); PlayPolyphonic(&emojiSounds); return;
       case EFFECT_NEWFONT: SB_NewFont(); return;
       case EFFECT_LOCKUP_BEGIN: SB_BeginLockup(); return;
@@ -690,7 +753,7 @@ public:
   void SetHumVolume(float vol) override {
     if (!monophonic_hum_) {
       if (active_state() && !hum_player_) {
-        hum_player_ = GetFreeWavPlayer();
+        hum_player_ = GetFreeWavPlayer(wp_hum);
         if (hum_player_) {
           hum_player_->set_volume_now(0);
           hum_player_->PlayOnce(SFX_humm ? &SFX_humm : &SFX_hum);
@@ -68,10 +68,22 @@
 
 
 
+#ifndef PLAYWAV_PREOPEN_MS
+#define PLAYWAV_PREOPEN_MS 50     // open the file that follows this long before the current one ends
+#endif
+#define PLAYWAV_PREOPEN_SAMPLES (PLAYWAV_PREOPEN_MS * AUDIO_RATE / 1000)
+
+
 // PlayWav reads a file from serialflash or SD and converts
 // it into a stream of samples. Note that because it can
 // spend some time reading data between samples, the
 // reader must have enough buffers to provide smooth playback.
+//
+// What plays next is sequenced here, in samples: the file that follows
+// (loop, effect chain, timed repeat) is opened and its header parsed ahead
+// of time into the second file reader, so the switch happens between two
+// samples of the same read(). Timed repeats count output samples: a period
+// shorter than the file cuts it, a longer one pads it with silence.
 class PlayWav : StateMachine, public ProffieOSAudioStream {
 public:
 
@@ -116,67 +128,40 @@ public:
     run_.set(false);
     state_machine_.reset_state_machine();
     written_ = num_samples_ = 0;
+    next_effect_ = nullptr;
+    next_open_ = false;
     interrupts();
-
+    files_[cur_ ^ 1].Close();       // the following file won't play now
   }
   void Stop() override {
     noInterrupts();
     effect_.set(nullptr);
-    shortRepeatTime = 0;
-    if (longRepeat) *longRepeat = false;
-    longRepeat = 0;
+    repeat_samples_ = 0;
     Reset();
     // interrupts();    // released by Reset()
   }
 
 
   // 0: no repeat; 1: loop; >1: repeat at 'msm1'-1 milliseconds
-  // Return false for long repeat (needs additional action from BufferedWavPlayer )
+  // Works on the assigned effect, returns false if there is none.
   bool SetRepeat(uint16_t msm1) {
-    // Stop repeat
-    // STDOUT.print("[SetRepeat] effect_ = "); STDOUT.print((uint32_t)effect_); STDOUT.print(", len [ms] = "); STDOUT.println((uint16_t)(1000*length()));
-    if (msm1 && !effect_.get()) {
+    Effect* effect = effect_.get();
+    if (msm1 && !effect) {
         // STDOUT.println("[PlayWav.SetRepeat] Cannot repeat, effect not assigned");
         return false;     
     }
-    effect_.get()->SetFollowing(0);   // nothing follows
-    shortRepeatTime = 0;
-    lastRepeatTime = millis();    
-    if (longRepeat)*longRepeat = false;
-    // repeating = msm1;
-    if (msm1) {  
-      if (msm1 == 1) { // loop at sound's duration
-        effect_.get()->SetFollowing(effect_.get()); 
-      }
-      else { // repeat at fixed period
-        uint32_t soundLen = 1000*length();
-        // STDOUT.println(1000*length());
-        if (msm1-1 < soundLen) { // short repeat (before sound end, by loop)
-            effect_.get()->SetFollowing(effect_.get()); 
-            shortRepeatTime = msm1-1;  
-        }
-        else if (msm1-1 == soundLen) { // loop
-          effect_.get()->SetFollowing(effect_.get()); 
-        }
-        else { // long repeat (by RepeatTask)
-          if (longRepeat)*longRepeat = true;  // this starts the RepeatTask, since longRepeat points to its .running
-          effect_.set(nullptr);         // unassign effect to prevent looping
-          // repeater->Start(msm1-1);
-        }    
-      }
-    } 
-    else effect_.set(nullptr);   // prevent double play
-
+    repeat_samples_ = msm1 > 1 ? (uint32_t)(msm1 - 1) * AUDIO_RATE / 1000 : 0;
+    if (effect) effect->SetFollowing(msm1 ? effect : nullptr);
+    if (!msm1) effect_.set(nullptr);   // prevent double play
     return true;
   }
 
   // 0 = not repeating, 1 = short repeat, 2 = loop, 3 = long repeat
   uint8_t GetRepeat() {
-    if (*longRepeat) return 3;    
-    if (shortRepeatTime) return 1;
-    if (effect_.get())
-      if (effect_.get() == effect_.get()->GetFollowing()) return 2;   
-    return 0;
+    Effect* effect = effect_.get();
+    if (!effect || effect->GetFollowing() != effect) return 0;
+    if (!repeat_samples_) return 2;
+    return repeat_samples_ < length() * AUDIO_RATE ? 1 : 3;
   }
   
 
@@ -187,7 +172,21 @@ public:
     return run_.get();
   }
 
+  // Streaming from the SD card (not from a serial flash copy)
+  bool OnSD() {
+    return isPlaying() && file().OnSD();
+  }
+
 private:
+  // Sample format and data location of a file, found by ReadFormat()
+  struct WavFormat {
+    uint32_t rate;
+    uint32_t data_start;      // file offset of the first sample
+    uint32_t data_bytes;
+    uint8_t channels;
+    uint8_t bits;
+  };
+
   void Emit1(uint16_t sample) {
     samples_[num_samples_++] = sample;
   }
@@ -195,10 +194,6 @@ private:
   UPSAMPLE_FUNC(Emit4, Emit2);
   DOWNSAMPLE_FUNC(Emit05, Emit1);
 
-  uint32_t header(int n) const {
-    return ((uint32_t *)buffer)[n+2];
-  }
-
   template<int bits> int16_t read2() {
     if (bits == 8) return (*(ptr_++) << 8) - 32768;
     ptr_ += bits / 8 - 2;
@@ -269,146 +264,183 @@ private:
     else AbortDecodeBytes("Unsupported sample size.");
   }
 
+  FileReader& file() { return files_[cur_]; }
+
   int ReadFile(int n) {
     
-    return file_.Read(buffer + 8, n);
+    return file().Read(buffer + 8, n);
   }
 
-  void loop() {
+  static bool FormatError(const char* why) {
+    #if defined(DIAGNOSE_AUDIO)
+      default_output->println(why);
+    #endif
+    return false;
+  }
 
-    // auto-repeat at fixed intervals 'shortRepeatTime' [ms], if smaller than file duration. If longer, state machine will stop so repeating is handled by PlayWavLooper
-    if (effect_.get() && shortRepeatTime && !(*longRepeat)) {
-      uint32_t timeNow = millis();
-      if (timeNow - lastRepeatTime >= shortRepeatTime) {
-        file_.Rewind();   // start over
-        state_machine_.next_state_ = switchwavs_state;    // hack into the state machine!
-        lastRepeatTime = timeNow;
-      }
+  // Parse the header of a file opened at its start and leave it at the first sample.
+  // Anything but .wav is raw 44.1kHz, 16 bit mono.
+  static bool ReadFormat(FileReader* f, const char* filename, WavFormat* fmt) {
+    if (!endswith(".wav", filename)) {
+      fmt->channels = 1;
+      fmt->rate = 44100;
+      fmt->bits = 16;
+      fmt->data_start = f->Tell();
+      fmt->data_bytes = f->FileSize() - fmt->data_start;
+      return true;
     }
-    STATE_MACHINE_BEGIN();
+    uint32_t h[4];
+    if (f->Read((uint8_t*)h, 12) != 12) return FormatError("Failed to read 12 bytes.");
+    if (h[0] != 0x46464952 || h[2] != 0x45564157) return FormatError("Not RIFF WAVE.");
+
+    // Look for FMT header.
     while (true) {
-      while (!run_.get() && !effect_.get()) YIELD();      
+      if (f->Read((uint8_t*)h, 8) != 8) return FormatError("Failed to read 8 bytes.");
+      if (h[0] == 0x20746D66) break;    // 'fmt '
+      f->Skip(h[1]);
+    }
+    uint32_t len = h[1];
+    if (len < 16) return FormatError("FMT header is wrong size..");
+    if (f->Read((uint8_t*)h, 16) != 16) return FormatError("Read failed.");
+    if (len > 16) f->Skip(len - 16);
+    if ((h[0] & 0xffff) != 1) return FormatError("Wrong format.");
+    fmt->channels = h[0] >> 16;
+    fmt->rate = h[1];
+    fmt->bits = h[3] >> 16;
+
+    // Samples start at the first data chunk; what comes after it is not played.
+    while (true) {
+      if (f->Read((uint8_t*)h, 8) != 8) return FormatError("No data.");
+      if (h[0] == 0x61746164) break;    // 'data'
+      f->Skip(h[1]);
+    }
+    fmt->data_start = f->Tell();
+    fmt->data_bytes = h[1];
+    return true;
+  }
 
-      // if (!shortRepeatTime) { 
-        if (!run_.get()) {  
-          new_file_id_ = old_file_id_.GetFollowing(effect_.get());  // Random()
-          if (!new_file_id_) goto fail;
-          new_file_id_.GetName(filename_);
-          run_.set(true);
-          effect_.set(effect_.get()->GetFollowing());
-        }
-        if (new_file_id_ && new_file_id_ == old_file_id_) file_.Rewind();
-        else {
-          if (!file_.OpenFast(filename_)) {
-            #if defined(DIAGNOSE_AUDIO) 
-              default_output->print("File ");            
-              default_output->print(filename_);
-              default_output->println(" not found.");
-            #endif
-            goto fail;
-          }
-          switchwavs_state = __LINE__ + 1;    // while repeating we'll inject into the state machine on the next YIELD
-          YIELD();
-          old_file_id_ = new_file_id_;
-        }
-      // }
-  
+  // Start decoding the current file, positioned at its first sample
+  void Begin(const WavFormat& fmt) {
+    rate_ = fmt.rate;
+    channels_ = fmt.channels;
+    bits_ = fmt.bits;
+    data_start_ = fmt.data_start;
+    len_ = fmt.data_bytes;
+    sample_bytes_.set(len_);
+    preopen_bytes_ = PLAYWAV_PREOPEN_MS * rate_ / 1000 * channels_ * bits_ / 8;
+    ptr_ = buffer + 8;
+    end_ = buffer + 8;
+    written_ = num_samples_ = 0;
+    cycle_samples_ = 0;
+    next_effect_ = nullptr;
+  }
 
+  // Open the file named by Play() / PlayOnce()
+  bool OpenFile() {
+    if (new_file_id_ && new_file_id_ == old_file_id_) file().Rewind();
+    else {
+      if (!file().OpenFast(filename_)) {
+        #if defined(DIAGNOSE_AUDIO) 
+          default_output->print("File ");            
+          default_output->print(filename_);
+          default_output->println(" not found.");
+        #endif
+        return false;
+      }
+      old_file_id_ = new_file_id_;
+    }
+    WavFormat fmt;
+    if (!ReadFormat(&file(), filename_, &fmt)) return false;
+    Begin(fmt);
+    if (start_ != 0.0) {
+      int samples = Fmod(start_, length()) * rate_;
+      int bytes_to_skip = samples * channels_ * bits_ / 8;
+      file().Skip(bytes_to_skip);
+      len_ -= bytes_to_skip;
+      start_ = 0.0;
+    }
+    return true;
+  }
 
-      wav_ = endswith(".wav", filename_);
-      if (wav_) {
-        if (ReadFile(12) != 12) {
-          #if defined(DIAGNOSE_AUDIO)
-            default_output->println("Failed to read 12 bytes.");
-          #endif
-          goto fail;
-        }
-        if (header(0) != 0x46464952 || header(2) != 0x45564157) {
-          #if defined(DIAGNOSE_AUDIO) 
-            default_output->println("Not RIFF WAVE.");
-          #endif
-          YIELD();
-          goto fail;
-        }
+  // Choose the file that follows from effect_ and get it ready to play:
+  // opened in the spare reader and positioned at its first sample,
+  // or just remembered if it's the file already playing.
+  void PrepareNext() {
+    Effect* effect = effect_.get();
+    next_effect_ = nullptr;
+    if (!effect || SDCardMountPending()) return;
+    next_effect_ = effect;
+    next_open_ = false;
+    next_file_id_ = old_file_id_.GetFollowing(effect);
+    if (!next_file_id_) return;
+    next_same_ = next_file_id_ == old_file_id_;
+    if (next_same_) {
+      next_fmt_.rate = rate_;
+      next_fmt_.channels = channels_;
+      next_fmt_.bits = bits_;
+      next_fmt_.data_start = data_start_;
+      next_fmt_.data_bytes = sample_bytes_.get();
+      next_open_ = true;
+      return;
+    }
+    char filename[128];
+    next_file_id_.GetName(filename);
+    FileReader* f = &files_[cur_ ^ 1];
+    if (!f->OpenFast(filename)) {
+      #if defined(DIAGNOSE_AUDIO) 
+        default_output->print("File ");            
+        default_output->print(filename);
+        default_output->println(" not found.");
+      #endif
+      return;
+    }
+    next_open_ = ReadFormat(f, filename, &next_fmt_);
+  }
 
-        // Look for FMT header.
-        while (true) {
-          if (ReadFile(8) != 8) {
-            #if defined(DIAGNOSE_AUDIO) 
-              default_output->println("Failed to read 8 bytes.");
-            #endif
-            goto fail;
-          }
+  // Switch to the file that follows. Prepared ahead if possible,
+  // again if effect_ has changed since.
+  bool StartNext() {
+    if (!next_effect_ || next_effect_ != effect_.get()) PrepareNext();
+    if (!next_effect_ || !next_open_) return false;
+    Effect* effect = next_effect_;
+    if (next_same_) file().Seek(next_fmt_.data_start);
+    else {
+      file().Close();
+      cur_ ^= 1;
+    }
+    old_file_id_ = new_file_id_ = next_file_id_;
+    new_file_id_.GetName(filename_);
+    effect_.set(effect->GetFollowing());
+    Begin(next_fmt_);
+    return true;
+  }
 
-          len_ = header(1);
-          if (header(0) != 0x20746D66) {  // 'fmt '
-            file_.Skip(len_);
-            continue;
-          }
-          if (len_ < 16) {
-            #if defined(DIAGNOSE_AUDIO) 
-              default_output->println("FMT header is wrong size..");
-            #endif
-            goto fail;
-          }
-          break;
-        }
-        
-        if (16 != ReadFile(16)) {
-          #if defined(DIAGNOSE_AUDIO) 
-            default_output->println("Read failed.");
-          #endif
-          goto fail;
-        }
-        if (len_ > 16) file_.Skip(len_ - 16);
-        if ((header(0) & 0xffff) != 1) {
-          #if defined(DIAGNOSE_AUDIO) 
-            default_output->println("Wrong format.");
-          #endif
-          goto fail;
-        }
-        channels_ = header(0) >> 16;
-        rate_ = header(1);
-        bits_ = header(3) >> 16;
+  // Repeating at a fixed period, counted in samples from the start of each file
+  bool TimedRepeat() const {
+    return repeat_samples_ && effect_.get();
+  }
+
+  void loop() {
+    STATE_MACHINE_BEGIN();
+    while (true) {
+      while (!run_.get() && !effect_.get()) YIELD();      
+      while (SDCardMountPending()) YIELD();   // storage is being mounted in the background
+
+      if (run_.get()) {
+        if (!OpenFile()) goto fail;
       } else {
-         channels_ = 1;
-         rate_ = 44100;
-         bits_ = 16;
+        if (!StartNext()) goto fail;
+        run_.set(true);
       }
 
-      ptr_ = buffer + 8;
-      end_ = buffer + 8;
-      
       while (true) {
-        if (wav_) {
-          if (ReadFile(8) != 8) break;
-          len_ = header(1);
-          if (header(0) != 0x61746164) {
-            file_.Skip(len_);
-            continue;
-          }
-        } else {
-          if (file_.Tell() >= file_.FileSize()) break;
-          len_ = file_.FileSize() - file_.Tell();
-        }
-        sample_bytes_.set(len_);
-
-        if (delayedRepeat) {
-            SetRepeat(delayedRepeat);   // set repeat now, it was delayed for not knowing length
-            delayedRepeat = 0;
-        }
-
-        if (start_ != 0.0) {
-          int samples = Fmod(start_, length()) * rate_;
-          int bytes_to_skip = samples * channels_ * bits_ / 8;
-          file_.Skip(bytes_to_skip);
-          len_ -= bytes_to_skip;
-          start_ = 0.0;
-        }
-
         while (len_) {
+          if (!next_effect_ && effect_.get() &&
+              (len_ <= preopen_bytes_ ||
+               (TimedRepeat() && cycle_samples_ + PLAYWAV_PREOPEN_SAMPLES >= repeat_samples_)))
+            PrepareNext();    // the end is near
           {
-            int bytes_read = ReadFile(file_.AlignRead(std::min<size_t>(len_, 512u)));
+            int bytes_read = ReadFile(file().AlignRead(std::min<size_t>(len_, audioLatency.chunk)));
             if (bytes_read <= 0)
               break;
             len_ -= bytes_read;
@@ -422,10 +454,15 @@ private:
               while (to_read_ == 0) YIELD();
 
               int n = std::min<int>(num_samples_ - written_, to_read_);
+              if (TimedRepeat()) {
+                if (cycle_samples_ >= repeat_samples_) goto next;   // period over, cut the file here
+                n = std::min<int>(n, repeat_samples_ - cycle_samples_);
+              }
               memcpy(dest_, samples_ + written_, n * 2);
               dest_ += n;
               written_ += n;
               to_read_ -= n;
+              cycle_samples_ += n;
             }
             written_ = num_samples_ = 0;
           }
@@ -436,10 +473,24 @@ private:
           }
           ptr_ = buffer + 8 - (end_ - ptr_);
         }
-        YIELD();
+
+        // EOF; a timed repeat longer than the file is padded with silence
+        while (TimedRepeat() && cycle_samples_ < repeat_samples_) {
+          if (!next_effect_ && cycle_samples_ + PLAYWAV_PREOPEN_SAMPLES >= repeat_samples_) PrepareNext();
+          while (to_read_ == 0) YIELD();
+          int n = std::min<int>(repeat_samples_ - cycle_samples_, to_read_);
+          memset(dest_, 0, n * 2);
+          dest_ += n;
+          to_read_ -= n;
+          cycle_samples_ += n;
+        }
+
+  next:
+        if (!effect_.get()) break;      // nothing follows
+        while (SDCardMountPending()) YIELD();
+        if (!StartNext()) goto fail;
       }
 
-      // EOF;
       run_.set(false);
       continue;
 
@@ -479,7 +530,9 @@ public:
   }
 
   void Close() {
-    file_.Close();
+    files_[0].Close();
+    files_[1].Close();
+    next_effect_ = nullptr;
     old_file_id_ = new_file_id_ = Effect::FileID();
   }
 
@@ -496,6 +549,7 @@ public:
 	   << " filename=" << filename()
 	   << " pos=" << pos()
 	   << " len=" << length()
+	   << " next=" << (next_effect_ && next_open_)
 	   << "\n";
   }
 
@@ -508,17 +562,17 @@ private:
   char filename_[128];
   int16_t* dest_ = nullptr;
   int to_read_ = 0;
-  int tmp_;
   float start_ = 0.0;
   int rate_;
   uint8_t channels_;
   uint8_t bits_;
 
-  bool wav_;
-
-  FileReader file_;
+  FileReader files_[2];           // playing and following
+  uint8_t cur_ = 0;               // index of the playing one
 
   size_t len_ = 0;
+  uint32_t data_start_ = 0;
+  uint32_t preopen_bytes_ = 0;
   POAtomic<size_t> sample_bytes_;
   unsigned char* ptr_;
   unsigned char* end_;
@@ -532,15 +586,15 @@ private:
   int num_samples_ = 0;
   int16_t samples_[32];
 
+  // What follows, prepared by PrepareNext()
+  Effect* next_effect_ = nullptr;   // effect it was chosen from, nullptr = not prepared
+  Effect::FileID next_file_id_;
+  WavFormat next_fmt_;
+  bool next_open_ = false;
+  bool next_same_ = false;          // same file again: seek back, no open
 
-// private:
-    uint16_t switchwavs_state;    // state machine's state which swithces wiches
-    uint32_t shortRepeatTime;          // auto-repeat period [ms]
-    uint32_t lastRepeatTime;          // millis() when repeated last time
-    bool* longRepeat;              // pointer to .running of the RepeatTask assigned
-    uint16_t delayedRepeat;
-
-
+  uint32_t repeat_samples_ = 0;     // timed repeat period, 0 = no timed repeat
+  uint32_t cycle_samples_ = 0;      // samples sent since the current file started
 };
 
 
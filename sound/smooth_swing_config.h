@@ -1,6 +1,10 @@
 #ifndef SOUND_SMOOTH_SWING_CONFIG_H
 #define SOUND_SMOOTH_SWING_CONFIG_H
 
+#ifndef SMOOTHSWING_CURVE_STEPS
+#define SMOOTHSWING_CURVE_STEPS 32    // segments of the tabulated gain curves
+#endif
+
 class SmoothSwingConfigFile : public ConfigFile {
 public:
   void iterateVariables(VariableOP *op) override {
@@ -50,9 +54,37 @@ public:
         MaxSwingVolume = MaxSwingVolume_ * sensitivity->MaxSwingVolume_multiplier; // STDOUT.print("[smooth_swing_config] Applied MaxSwingVolume = "); STDOUT.println(MaxSwingVolume);
 
       }
+      BuildGainCurves();
+  }
 
+  // Swing & hum volumes over swing strength, tabulated from the current parameters
+  // so the motion path only needs a lookup. Called by ApplySensitivity(), after every load.
+  void BuildGainCurves() {
+      strengthPerDps = SwingSensitivity > 0 ? 1.0f / SwingSensitivity : 0;
+      for (uint8_t i = 0; i <= SMOOTHSWING_CURVE_STEPS; i++) {
+        float mix = powf((float)i / SMOOTHSWING_CURVE_STEPS, SwingSharpness);
+        swingGain[i] = mix * MaxSwingVolume;
+        humGain[i] = 1.0f - mix * MaximumHumDucking / 100.0f;
+      }
   }
 
+  // Swing strength [0...1] at 'speed' [deg/s], with its swing and hum volumes
+  float Gains(float speed, float* swingVolume, float* humVolume) const {
+      // No sensitivity: always full strength, as speed / SwingSensitivity used to clamp to
+      float strength = strengthPerDps > 0 ? std::min<float>(1.0f, speed * strengthPerDps) : 1.0f;
+      float x = strength * SMOOTHSWING_CURVE_STEPS;
+      uint8_t i = std::min<int>((int)x, SMOOTHSWING_CURVE_STEPS - 1);
+      float f = x - i;
+      *swingVolume = swingGain[i] + (swingGain[i + 1] - swingGain[i]) * f;
+      *humVolume = humGain[i] + (humGain[i + 1] - humGain[i]) * f;
+      return strength;
+  }
+
+private:
+  float strengthPerDps = 0;         // 0: SwingSensitivity <= 0
+  float swingGain[SMOOTHSWING_CURVE_STEPS + 1] = { 0 };
+  float humGain[SMOOTHSWING_CURVE_STEPS + 1] = { 0 };
+
 
 };
 
@@ -165,33 +165,25 @@ public:
           smooth_swing_config.AccentSlashAccelerationThreshold);
         }
         if (speed >= smooth_swing_config.SwingStrengthThreshold * 0.9) {
-          float swing_strength =
-            std::min<float>(1.0, speed / smooth_swing_config.SwingSensitivity);
-          A.rotate(-speed * delta / 1000000.0);
+          float mixhum;
+          float swing_strength = smooth_swing_config.Gains(speed, &mixhum, &hum_volume);
+          A.rotate(-speed * delta * 1e-6f);
           // If the current transition is done, switch A & B,
           // and set the next transition to be 180 degrees from the one
           // that is done.
-          while (A.end() < 0.0) {
+          while (A.end() < 0.0f) {
             B.midpoint = A.midpoint + 180.0;
 	    Swap();
           }
-          float mixab = 0.0;
-          if (A.begin() < 0.0)
-            mixab = clamp(- A.begin() / A.width, 0.0, 1.0);
-
-          float mixhum =
-            powf(swing_strength, smooth_swing_config.SwingSharpness);
-
-          hum_volume =
-            1.0 - mixhum * smooth_swing_config.MaximumHumDucking / 100.0;
-
-          mixhum *= smooth_swing_config.MaxSwingVolume;
+          float mixab = 0.0f;
+          if (A.begin() < 0.0f)
+            mixab = std::min<float>(1.0f, -A.begin() / A.width);
 
           if (on_) {
             // We need to stop setting the volume when off, or playback may never stop.
             mixhum = delegate_->SetSwingVolume(swing_strength, mixhum);
             A.set_volume(mixhum * mixab);
-            B.set_volume(mixhum * (1.0 - mixab));
+            B.set_volume(mixhum * (1.0f - mixab));
           }
           break;
         }
@@ -214,7 +206,7 @@ private:
     }
     void Play(Effect* effect, float start = 0.0) {
       if (!player) {
-	player = GetFreeWavPlayer();
+	player = GetFreeWavPlayer(wp_hum);
 	if (!player) return;
       }
       player->set_volume(0.0f);
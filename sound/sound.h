@@ -1,13 +1,18 @@
 #ifdef ENABLE_AUDIO
 
-// DMA-driven audio output.
+// DMA-driven audio output. AUDIO_BUFFER_SIZE = samples rendered per DMA interrupt.
+#ifndef AUDIO_BUFFER_SIZE
 #ifdef ARDUINO_ARCH_ESP32   // ESP architecture
 #define AUDIO_BUFFER_SIZE 128	
 #else
 #define AUDIO_BUFFER_SIZE 44
 #endif
+#endif
+static_assert(AUDIO_BUFFER_SIZE % 4 == 0, "AUDIO_BUFFER_SIZE must be a multiple of 4");
 #define AUDIO_RATE 44100
-#define NUM_WAV_PLAYERS 8
+#ifndef NUM_WAV_PLAYERS
+#define NUM_WAV_PLAYERS 8     // voices; each costs a BufferedWavPlayer of RAM and a mixer input
+#endif
 
 
 
@@ -25,6 +30,7 @@
 #else
 #include "dac.h"
 #endif
+#include "audio_latency.h"
 #include "beeper.h"
 
 
@@ -43,15 +49,11 @@ size_t WhatUnit(class BufferedWavPlayer* player);
 BufferedWavPlayer wav_players[NUM_WAV_PLAYERS];
 RefPtr<BufferedWavPlayer> track_player_;
 
-RefPtr<BufferedWavPlayer> GetFreeWavPlayer()  {
-  // Find a free wave playback unit.
-  for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
-    if (wav_players[unit].Available()) {
-      wav_players[unit].reset_volume();
-      return RefPtr<BufferedWavPlayer>(wav_players + unit);
-    }
-  }
-  return RefPtr<BufferedWavPlayer>();
+#include "wav_player_pool.h"
+
+// Get a free wave playback unit, or steal one playing something less important.
+RefPtr<BufferedWavPlayer> GetFreeWavPlayer(WavPriority priority = wp_clash)  {
+  return wav_pool.Get(priority);
 }
 
 RefPtr<BufferedWavPlayer> GetWavPlayerPlaying(Effect* effect) {
@@ -66,7 +68,7 @@ RefPtr<BufferedWavPlayer> GetWavPlayerPlaying(Effect* effect) {
 
 RefPtr<BufferedWavPlayer> RequireFreeWavPlayer()  {
   while (true) {
-    RefPtr<BufferedWavPlayer> ret = GetFreeWavPlayer();
+    RefPtr<BufferedWavPlayer> ret = GetFreeWavPlayer(wp_hum);
     if (ret) return ret;
     STDOUT.println("Failed to get hum player, trying again!");
     delay(100);
@@ -136,6 +138,16 @@ uint8_t GetNrOFPlayingPlayers(bool excludeTrack = false)
   } 
   const auto AmplifierIsActive = SoundActive;   
 
+#ifdef ENABLE_FLASH_CACHE
+  // Some player streams from SD. Sounds cached in serial flash don't need the card.
+  bool SoundFromSD() {
+    for (size_t i = 0; i < NELEM(wav_players); i++)
+      if (wav_players[i].OnSD())
+        return true;
+    return false;
+  }
+#endif
+
   // Stubs (for backward compatibility only)
   void EnableBooster() {}
   void SilentEnableBooster(bool on) {}
@@ -10,6 +10,7 @@
 #define MAX_SCALE_BITS          6
 #define MAX_SCALE               (1<<MAX_SCALE_BITS)
 #define MAX_CHIRP_SIZE          52
+#define TALKIE_BLOCK            64      // 44kHz samples rendered per pass
 
 struct tms5100_coeffs
 {
@@ -668,6 +669,8 @@ public:
 
   Talkie() {
     for (int i = 0; i < 10; i++) x[i] = 0;
+    for (int i = 0; i < 10; i++) silent_frame_.k[i] = 0;
+    silent_frame_.energy = silent_frame_.period = 0;
   }
 
   bool Empty() { return num_words == 0; }
@@ -841,65 +844,95 @@ public:
     }
   }
   
-  int16_t Get8kHz() {
-    if (count_++ >= rate_) {
-      ReadFrame();
-      count_ = 0;
+  // Per frame decision, made when a frame is read: interpolate between
+  // old_frame and new_frame, or hold one of them for the whole frame.
+  void StartFrame() {
+    if (!old_frame.inited) {
+      hold_ = &silent_frame_;
+    } else if (old_frame.voiced() != new_frame.voiced() || !new_frame.inited) {
+      hold_ = &old_frame;
+    } else {
+      // A*a + B*b == A*16384 + (B-A)*b, so Frame::lerp() gives A + ((B-A)*b >> 14)
+      hold_ = nullptr;
+      delta_.energy = new_frame.energy - old_frame.energy;
+      delta_.period = new_frame.period - old_frame.period;
+      for (int i = 0; i < 10; i++) delta_.k[i] = new_frame.k[i] - old_frame.k[i];
     }
+  }
 
+  // Render 'n' samples at 8kHz.
+  void Render8kHz(int16_t* out, int n) {
     Frame f;
-    f.lerp(old_frame, new_frame, count_, rate_);
-
-    
-    int32_t u[11];
-
-    if (f.period) {
-      // Voiced source
-      if (periodCounter < f.period) {
-        periodCounter++;
-      } else {
-        periodCounter = 0;
+    for (int s = 0; s < n; s++) {
+      if (count_++ >= rate_) {
+        ReadFrame();
+        count_ = 0;
+        StartFrame();
       }
-      if (periodCounter < MAX_CHIRP_SIZE) {
-        u[10] = ((coeffs_->chirptable[periodCounter]) * f.energy) >> 3;
+      const Frame* fp = hold_;
+      if (!fp) {
+        int32_t b = count_ * 16384 / rate_;     // rate_ may change between blocks (Say)
+        f.energy = old_frame.energy + ((delta_.energy * b) >> 14);
+        f.period = old_frame.period + ((delta_.period * b) >> 14);
+        for (int i = 0; i < 10; i++) f.k[i] = old_frame.k[i] + ((delta_.k[i] * b) >> 14);
+        fp = &f;
+      }
+      const int32_t* k = fp->k;
+
+      int32_t u[11];
+      if (fp->period) {
+        // Voiced source
+        if (periodCounter < fp->period) {
+          periodCounter++;
+        } else {
+          periodCounter = 0;
+        }
+        if (periodCounter < MAX_CHIRP_SIZE) {
+          u[10] = ((coeffs_->chirptable[periodCounter]) * fp->energy) >> 3;
+        } else {
+          u[10] = 0;
+        }
       } else {
-        u[10] = 0;
+        // Unvoiced source
+        synthRand = (synthRand >> 1) ^ ((synthRand & 1) ? 0xB800 : 0);
+        u[10] = ((synthRand & 1) ? fp->energy : -fp->energy) << 3;
       }
-    } else {
-      // Unvoiced source
-      static uint16_t synthRand = 1;
-      synthRand = (synthRand >> 1) ^ ((synthRand & 1) ? 0xB800 : 0);
-      u[10] = ((synthRand & 1) ? f.energy : -f.energy) << 3;
-    }
 
 #define matrix_multiply(X, Y) (((X)*(Y)) >> 9)
-    u[9] = u[10] - matrix_multiply(f.k[9], x[9]);
-    u[8] = u[9] - matrix_multiply(f.k[8], x[8]);
-    u[7] = u[8] - matrix_multiply(f.k[7], x[7]);
-    u[6] = u[7] - matrix_multiply(f.k[6], x[6]);
-    u[5] = u[6] - matrix_multiply(f.k[5], x[5]);
-    u[4] = u[5] - matrix_multiply(f.k[4], x[4]);
-    u[3] = u[4] - matrix_multiply(f.k[3], x[3]);
-    u[2] = u[3] - matrix_multiply(f.k[2], x[2]);
-    u[1] = u[2] - matrix_multiply(f.k[1], x[1]);
-    u[0] = u[1] - matrix_multiply(f.k[0], x[0]);
+      u[9] = u[10] - matrix_multiply(k[9], x[9]);
+      u[8] = u[9] - matrix_multiply(k[8], x[8]);
+      u[7] = u[8] - matrix_multiply(k[7], x[7]);
+      u[6] = u[7] - matrix_multiply(k[6], x[6]);
+      u[5] = u[6] - matrix_multiply(k[5], x[5]);
+      u[4] = u[5] - matrix_multiply(k[4], x[4]);
+      u[3] = u[4] - matrix_multiply(k[3], x[3]);
+      u[2] = u[3] - matrix_multiply(k[2], x[2]);
+      u[1] = u[2] - matrix_multiply(k[1], x[1]);
+      u[0] = u[1] - matrix_multiply(k[0], x[0]);
 
-    // Output clamp
-    if (u[0] > 511) u[0] = 511;
-    if (u[0] < -512) u[0] = -512;
+      // Output clamp
+      if (u[0] > 511) u[0] = 511;
+      if (u[0] < -512) u[0] = -512;
 
-    x[9] = x[8] + matrix_multiply(f.k[8], u[8]);
-    x[8] = x[7] + matrix_multiply(f.k[7], u[7]);
-    x[7] = x[6] + matrix_multiply(f.k[6], u[6]);
-    x[6] = x[5] + matrix_multiply(f.k[5], u[5]);
-    x[5] = x[4] + matrix_multiply(f.k[4], u[4]);
-    x[4] = x[3] + matrix_multiply(f.k[3], u[3]);
-    x[3] = x[2] + matrix_multiply(f.k[2], u[2]);
-    x[2] = x[1] + matrix_multiply(f.k[1], u[1]);
-    x[1] = x[0] + matrix_multiply(f.k[0], u[0]);
-    x[0] = u[0];
+      x[9] = x[8] + matrix_multiply(k[8], u[8]);
+      x[8] = x[7] + matrix_multiply(k[7], u[7]);
+      x[7] = x[6] + matrix_multiply(k[6], u[6]);
+      x[6] = x[5] + matrix_multiply(k[5], u[5]);
+      x[5] = x[4] + matrix_multiply(k[4], u[4]);
+      x[4] = x[3] + matrix_multiply(k[3], u[3]);
+      x[3] = x[2] + matrix_multiply(k[2], u[2]);
+      x[2] = x[1] + matrix_multiply(k[1], u[1]);
+      x[1] = x[0] + matrix_multiply(k[0], u[0]);
+      x[0] = u[0];
+
+      out[s] = u[0] << 5;
+    }
+  }
 
-    return u[0] << 5;
+  int16_t Get8kHz() {
+    int16_t sample;
+    Render8kHz(&sample, 1);
+    return sample;
   }
 
 #if 1
@@ -923,6 +956,33 @@ public:
   bool eof() const override {
     return ptrAddr == NULL && !A && !B && !C && !D;
   }
+
+  // Same as calling Get44kHz() 'elements' times: the 8kHz samples a block
+  // consumes are rendered first, in one go.
+  int read(int16_t* data, int elements) override {
+    if (eof()) return 0;
+    int16_t in[(10 + 2 * TALKIE_BLOCK) / 11];
+    for (int done = 0; done < elements; done += TALKIE_BLOCK) {
+      int n = std::min(elements - done, TALKIE_BLOCK);
+      Render8kHz(in, (l_pos_ + 2 * n) / 11);
+      int16_t* next = in;
+      for (int i = 0; i < n; i++) {
+        int32_t sum =
+          A * lanc2_11[l_pos_] +
+          B * lanc2_11[l_pos_ + 11] +
+          C * lanc2_11[l_pos_ + 22] +
+          D * lanc2_11[l_pos_ + 33];
+        l_pos_ += 2;
+        if (l_pos_ >= 11) {
+          l_pos_ -= 11;
+          D = C; C = B; B = A;
+          A = *(next++);
+        }
+        data[done + i] = clamptoi16(sum >> 14);
+      }
+    }
+    return elements;
+  }
 #else
   // Very very stupid upsamler, slightly better than
   // just repeating samples.
@@ -941,8 +1001,7 @@ public:
   bool eof() const override {
     return ptrAddr == NULL && tmp == 0;
   }
-#endif
-  
+
   int read(int16_t* data, int elements) override {
     if (eof()) return 0;
     for (int i = 0; i < elements; i++) {
@@ -950,6 +1009,8 @@ public:
     }
     return elements;
   }
+#endif
+
   bool isPlaying() const {
     return !eof();
   }
@@ -1048,9 +1109,14 @@ private:
   const tms5100_coeffs* coeffs_;
   Frame new_frame, old_frame;
 
+  Frame delta_;                     // new_frame - old_frame, when interpolating
+  const Frame* hold_ = &silent_frame_;  // frame used as is until the next one, nullptr = interpolate
+  Frame silent_frame_;
+
   uint8_t count_ = 0;
   uint8_t pos_ = 0;
   uint8_t periodCounter;
+  uint16_t synthRand = 1;
   int32_t x[10];
 };
 
@@ -0,0 +1,89 @@
+// Host check: renders the same phrases through two versions of sound/talkie.h
+// (namespaces O and N, see talkie_compare.sh) and compares them sample by sample:
+// random block sizes, queued phrases, words said while talking, mixed rates.
+// Then times both rendering 44 samples at a time, as the DAC asks for them
+// (best of a few runs, taking turns).
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define NELEM(x) (sizeof(x) / sizeof((x)[0]))
+static inline int16_t clamptoi16(int32_t x) { return x > 32767 ? 32767 : x < -32768 ? -32768 : x; }
+struct ProffieOSAudioStream {
+  virtual int read(int16_t* data, int elements) = 0;
+  virtual bool eof() const = 0;
+  virtual void Stop() {}
+};
+void EnableAmplifier() {}
+void noInterrupts() {}
+void interrupts() {}
+
+#include "voice_data.h"
+namespace O {
+#include "talkie_old.h"
+}
+namespace N {
+#include "talkie_new.h"
+}
+
+O::Talkie old_talkie;
+N::Talkie new_talkie;
+
+static const uint8_t* const phrases[] = {
+  spZERO, spONE, spTWO, spSEVEN, spNINE, spTHOUSAND,
+  talkie_low_battery_15, talkie_error_in_15, talkie_font_directory_15,
+  talkie_sd_card_15, talkie_not_found_15
+};
+
+static void Say(int p, int rate) {
+  old_talkie.Say(phrases[p], rate);
+  new_talkie.Say(phrases[p], rate);
+}
+
+template<class T> double Time(T& talkie) {
+  auto start = std::chrono::steady_clock::now();
+  int16_t data[44];
+  for (int round = 0; round < 300; round++) {
+    talkie.Say(talkie_low_battery_15, 15);
+    talkie.Say(spTHOUSAND);
+    while (talkie.read(data, NELEM(data))) ;
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+  srand(1);
+  long total = 0, bad = 0;
+  for (int round = 0; round < 200; round++) {
+    int queued = 1 + rand() % 3;
+    for (int i = 0; i < queued; i++) {
+      int p = rand() % NELEM(phrases);
+      Say(p, p >= 6 ? 15 : (rand() % 2 ? 25 : 12));   // the _15 phrases are for rate 15
+    }
+    int more = rand() % 3;      // phrases said while talking
+    while (true) {
+      int16_t a[256], b[256];
+      int n = 1 + rand() % 200;
+      int na = old_talkie.read(a, n), nb = new_talkie.read(b, n);
+      if (na != nb) { bad++; printf("length mismatch in round %d\n", round); break; }
+      if (!na) break;
+      total += na;
+      for (int i = 0; i < na; i++) if (a[i] != b[i]) bad++;
+      if (more && rand() % 50 == 0) { more--; Say(rand() % NELEM(phrases), 25); }
+    }
+  }
+  printf("%ld samples, %ld different\n", total, bad);
+  double old_time = 1e9, new_time = 1e9;
+  for (int run = 0; run < 7; run++) {
+    old_time = std::min(old_time, Time(old_talkie));
+    new_time = std::min(new_time, Time(new_talkie));
+  }
+  printf("time: old %.3fs, new %.3fs\n", old_time, new_time);
+  return bad != 0;
+}
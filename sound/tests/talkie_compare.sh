@@ -0,0 +1,23 @@
+#!/bin/sh
+# Checks that sound/talkie.h renders the same samples as the one in git revision
+# $1 (default HEAD, i.e. uncommitted changes), and compares their speed.
+#   sound/tests/talkie_compare.sh 481f59c    block renderer vs. the per-sample one
+# Needs a host C++ compiler ($CXX, default c++).
+set -e
+root=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+rev=${1:-HEAD}
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# Both versions go in one program: drop the includes, own include guard,
+# and every macro undefined before it's defined again.
+prepare() {
+  sed -e '/^#include/d' \
+      -e "s/SOUND_TALKIE_H/TALKIE_$1_H/" \
+      -e 's/^#define[ \t]\{1,\}\([A-Za-z_0-9]*\)/#undef \1\n&/'
+}
+git -C "$root" show "$rev:sound/talkie.h" | prepare old > "$tmp/talkie_old.h"
+prepare new < "$root/sound/talkie.h" > "$tmp/talkie_new.h"
+
+${CXX:-c++} -O2 -w -I"$tmp" -I"$root/sound" "$root/sound/tests/talkie_compare.cpp" -o "$tmp/talkie_compare"
+"$tmp/talkie_compare"
@@ -52,13 +52,14 @@ public:
         }
       }
     } 
-    else { // volume not at target
+    else if (elements) { // volume not at target: one step per block, ramped linearly across it
+      int32_t mult = (int32_t)volume_.value() << 8;     // 8 fractional bits
+      volume_.advance();
+      int32_t step = (((int32_t)volume_.value() << 8) - mult) / elements;
       for (int i = 0; i < elements; i++) {
-        int32_t v = data[i] * (int16_t)volume_.value();
-        v >>= kVolumeShift;
-        data[i] = clamptoi16(v);
+        mult += step;
+        data[i] = clamptoi16((data[i] * (mult >> 8)) >> kVolumeShift);
       }
-        volume_.advance();    
     }
     return elements;
   }
@@ -0,0 +1,120 @@
+#ifndef SOUND_WAV_PLAYER_POOL_H
+#define SOUND_WAV_PLAYER_POOL_H
+
+/********************************************************************
+ *  WAV PLAYER POOL - hands out wav_players by priority             *
+ *  (C) RSX Engineering. Licensed under GNU GPL.                    *
+ ********************************************************************
+ *  - free units sit on a stack: Get() pops one in O(1); finished   *
+ *    players are put back by the Looper, every WAV_POOL_RECLAIM_US *
+ *  - when none is free, the least important voice nobody holds a   *
+ *    reference to is reused at once: lowest priority first, then   *
+ *    the quietest, then the oldest. The mixer ramps its last       *
+ *    sample to 0 in WAV_STEAL_FADE_MS, so the cut doesn't click    *
+ *  - referenced players (hum, swings, track...) are never stolen   *
+ ********************************************************************/
+
+#ifndef WAV_POOL_RECLAIM_US
+#define WAV_POOL_RECLAIM_US 2000
+#endif
+#ifndef WAV_STEAL_FADE_MS
+#define WAV_STEAL_FADE_MS   2
+#endif
+
+// Voice priority classes, a request can only steal from its own class or below
+enum WavPriority : uint8_t {
+    wp_background = 0,  // music track, menu backgrounds
+    wp_blast,           // blaster deflects
+    wp_clash,           // clash, stab, force and other effects
+    wp_hum              // hum, swings, ignition & retraction
+};
+
+class WavPlayerPool : Looper {
+public:
+    WavPlayerPool() : Looper(WAV_POOL_RECLAIM_US) {
+        for (uint8_t unit = 0; unit < NUM_WAV_PLAYERS; unit++) {
+            free_[unit] = NUM_WAV_PLAYERS - 1 - unit;   // unit 0 on top
+            listed_[unit] = true;
+            priority_[unit] = wp_background;
+            started_[unit] = 0;
+        }
+        nFree_ = NUM_WAV_PLAYERS;
+    }
+    const char* name() override { return "WavPlayerPool"; }
+
+    RefPtr<BufferedWavPlayer> Get(WavPriority priority) {
+        int unit = Pop();
+        if (unit < 0) {     // players that just finished may not be back yet
+            Reclaim();
+            unit = Pop();
+        }
+        if (unit < 0) unit = Steal(priority);
+        if (unit < 0) return RefPtr<BufferedWavPlayer>();
+        priority_[unit] = priority;
+        started_[unit] = millis();
+        wav_players[unit].reset_volume();
+        TRACE(trc_audio, tr_wavplay, unit);
+        return RefPtr<BufferedWavPlayer>(wav_players + unit);
+    }
+
+    void Loop() override { Reclaim(); }
+
+private:
+    // Top of the free stack. Units that got busy while listed
+    // (used directly, not through the pool) are dropped, Reclaim() lists them again.
+    int Pop() {
+        while (nFree_) {
+            uint8_t unit = free_[--nFree_];
+            listed_[unit] = false;
+            if (wav_players[unit].Available()) return unit;
+        }
+        return -1;
+    }
+
+    void Reclaim() {
+        for (uint8_t unit = 0; unit < NUM_WAV_PLAYERS; unit++)
+            if (!listed_[unit] && wav_players[unit].Available()) {
+                listed_[unit] = true;
+                free_[nFree_++] = unit;
+            }
+    }
+
+    // Cut the least important unreferenced voice, not above 'priority', and take its player.
+    int Steal(WavPriority priority) {
+        int victim = -1;
+        for (uint8_t unit = 0; unit < NUM_WAV_PLAYERS; unit++) {
+            if (wav_players[unit].refs() || priority_[unit] > priority) continue;
+            if (victim >= 0) {
+                if (priority_[unit] > priority_[victim]) continue;
+                if (priority_[unit] == priority_[victim]) {
+                    float vol = wav_players[unit].volume();
+                    float victimVol = wav_players[victim].volume();
+                    if (vol > victimVol) continue;
+                    if (vol == victimVol && (int32_t)(started_[unit] - started_[victim]) >= 0) continue;
+                }
+            }
+            victim = unit;
+        }
+        if (victim < 0) return -1;
+        BufferedWavPlayer& player = wav_players[victim];
+        noInterrupts();
+        dynamic_mixer.Release(victim, WAV_STEAL_FADE_MS * AUDIO_RATE / 1000);   // mixer input = unit
+        player.set_volume_now(0);       // whatever is still buffered stays silent
+        player.Stop();                  // enables interrupts
+        interrupts();
+        #ifdef DIAGNOSE_AUDIO
+            STDOUT.print("Stole WAV player "); STDOUT.println(victim);
+        #endif
+        return victim;
+    }
+
+    uint8_t free_[NUM_WAV_PLAYERS];     // stack of free units
+    uint8_t nFree_;
+    bool listed_[NUM_WAV_PLAYERS];      // unit is on the free stack
+    uint8_t priority_[NUM_WAV_PLAYERS]; // WavPriority of the last Get()
+    uint32_t started_[NUM_WAV_PLAYERS]; // millis() of the last Get()
+};
+
+WavPlayerPool wav_pool;
+
+#endif // SOUND_WAV_PLAYER_POOL_H